@@ -173,11 +173,14 @@ HEADERS += src/database/board.h \
   src/database/abk.h \
   src/database/analysis.h \
   src/database/annotation.h \
+  src/database/archivedatabase.h \
   src/database/arenabook.h \
   src/database/bitboard.h \
   src/database/bitfind.h \
   src/database/circularbuffer.h \
   src/database/clipboarddatabase.h \
+  src/database/commentindex.h \
+  src/database/commentsearch.h \
   src/database/ctg.h \
   src/database/ctgbookwriter.h \
   src/database/ctgdatabase.h \
@@ -203,16 +206,24 @@ HEADERS += src/database/board.h \
   src/database/filtermodel.h \
   src/database/filteroperator.h \
   src/database/filtersearch.h \
+  src/database/fingerprint.h \
   src/database/gamecursor.h \
+  src/database/gamedelta.h \
+  src/database/gamesignature.h \
   src/database/gameid.h \
+  src/database/gametransformer.h \
   src/database/gameundocommand.h \
   src/database/gamex.h \
+  src/database/guessservice.h \
   src/database/historylist.h \
+  src/database/inflatedevice.h \
   src/database/index.h \
   src/database/indexitem.h \
   src/database/lichessopening.h \
   src/database/lichessopeningdatabase.h \
   src/database/lichesstransfer.h \
+  src/database/mappedarray.h \
+  src/database/materialsearch.h \
   src/database/memorydatabase.h \
   src/database/move.h \
   src/database/movedata.h \
@@ -360,10 +371,13 @@ HEADERS += src/database/board.h \
 SOURCES += \
   src/database/analysis.cpp \
   src/database/annotation.cpp \
+  src/database/archivedatabase.cpp \
   src/database/arenabook.cpp \
   src/database/bitboard.cpp \
   src/database/board.cpp \
   src/database/clipboarddatabase.cpp \
+  src/database/commentindex.cpp \
+  src/database/commentsearch.cpp \
   src/database/ctgbookwriter.cpp \
   src/database/ctgdatabase.cpp \
   src/database/database.cpp \
@@ -387,13 +401,17 @@ SOURCES += \
   src/database/filtermodel.cpp \
   src/database/filtersearch.cpp \
   src/database/gamecursor.cpp \
+  src/database/gamesignature.cpp \
+  src/database/gametransformer.cpp \
   src/database/gamex.cpp \
+  src/database/guessservice.cpp \
   src/database/historylist.cpp \
+  src/database/inflatedevice.cpp \
   src/database/index.cpp \
-  src/database/indexitem.cpp \
   src/database/lichessopening.cpp \
   src/database/lichessopeningdatabase.cpp \
   src/database/lichesstransfer.cpp \
+  src/database/materialsearch.cpp \
   src/database/memorydatabase.cpp \
   src/database/movedata.cpp \
   src/database/nag.cpp \
@@ -18,12 +18,12 @@ win32:CONFIG(release, debug|release) {
 
 SOURCES += \
     ../../src/database/annotation.cpp \
+    ../../src/database/commentindex.cpp \
     ../../src/database/database.cpp \
     ../../src/database/filter.cpp \
     ../../src/database/gamecursor.cpp \
     ../../src/database/gamex.cpp \
     ../../src/database/index.cpp \
-    ../../src/database/indexitem.cpp \
     ../../src/database/memorydatabase.cpp \
     ../../src/database/nag.cpp \
     ../../src/database/output.cpp \
@@ -39,13 +39,16 @@ SOURCES += \
 
 HEADERS += \
     ../../src/database/annotation.h \
+    ../../src/database/commentindex.h \
     ../../src/database/database.h \
     ../../src/database/filter.h \
+    ../../src/database/fingerprint.h \
     ../../src/database/gamecursor.h \
     ../../src/database/gameid.h \
     ../../src/database/gamex.h \
     ../../src/database/index.h \
     ../../src/database/indexitem.h \
+    ../../src/database/mappedarray.h \
     ../../src/database/memorydatabase.h \
     ../../src/database/nag.h \
     ../../src/database/output.h \
@@ -37,5 +37,48 @@ void Annotation::removeOne(const QRegularExpression& re)
     annotation = l.join(',');
 }
 
+AnnotationCommands::AnnotationCommands(const QString& text) :
+    m_text(text),
+    m_hasEvaluation(false),
+    m_evaluation(0)
+{
+    if (!text.contains("[%"))
+    {
+        return;
+    }
 
+    static const QRegularExpression squares = SquareAnnotation().filter();
+    static const QRegularExpression arrows = ArrowAnnotation().filter();
+    static const QRegularExpression eval = EvalAnnotation().filter();
+    static const QRegularExpression time = TimeAnnotation().filter();
 
+    QRegularExpressionMatch match = squares.match(text);
+    if (match.hasMatch())
+    {
+        m_squares = match.captured(2);
+        m_specAnnotations += match.captured(0);
+    }
+    match = arrows.match(text);
+    if (match.hasMatch())
+    {
+        m_arrows = match.captured(2);
+        m_specAnnotations += match.captured(0);
+    }
+    match = eval.match(text);
+    if (match.hasMatch())
+    {
+        m_specAnnotations += match.captured(0);
+        bool ok;
+        double score = match.captured(2).toDouble(&ok);
+        if (ok)
+        {
+            m_hasEvaluation = true;
+            m_evaluation = qRound(score * 100);
+        }
+    }
+    match = time.match(text);
+    if (match.hasMatch())
+    {
+        m_time = match.captured(2).trimmed();
+    }
+}
@@ -84,4 +84,37 @@ public:
     virtual QString asAnnotation() const { return annotation.isEmpty() ? QString() : QString("[%eval %1]").arg(annotation); };
 };
 
+/** The commands embedded in one comment ([%csl], [%cal], [%eval] and the times),
+    parsed once and kept together with the text they were parsed from. */
+class AnnotationCommands
+{
+public:
+    AnnotationCommands() : m_hasEvaluation(false), m_evaluation(0) {}
+    explicit AnnotationCommands(const QString& text);
+
+    /** @return the comment the commands were parsed from */
+    const QString& text() const { return m_text; }
+    /** @return the colored squares of the first [%csl] command */
+    QString squares() const { return m_squares; }
+    /** @return the arrows of the first [%cal] command */
+    QString arrows() const { return m_arrows; }
+    /** @return the time of the first [%clk], [%emt] or [%egt] command */
+    QString time() const { return m_time; }
+    /** @return true if there is an [%eval] command with a numeric score */
+    bool hasEvaluation() const { return m_hasEvaluation; }
+    /** @return the score of the [%eval] command in centipawns */
+    int evaluation() const { return m_evaluation; }
+    /** @return the [%csl], [%cal] and [%eval] commands as written in the comment */
+    QString specAnnotations() const { return m_specAnnotations; }
+
+private:
+    QString m_text;
+    QString m_squares;
+    QString m_arrows;
+    QString m_time;
+    bool m_hasEvaluation;
+    int m_evaluation;
+    QString m_specAnnotations;
+};
+
 #endif // ANNOTATION_H
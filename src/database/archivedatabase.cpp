@@ -0,0 +1,279 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <QDir>
+#include <QFileInfo>
+#include <QtEndian>
+#include <QVector>
+
+#include "archivedatabase.h"
+#include "inflatedevice.h"
+#include "settings.h"
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+#define DEBUG_NEW new( _NORMAL_BLOCK, __FILE__, __LINE__ )
+#define new DEBUG_NEW
+#endif // _MSC_VER
+
+namespace {
+
+const quint32 ZipCentralHeaderSignature = 0x02014b50;
+const quint32 ZipLocalHeaderSignature = 0x04034b50;
+const quint32 ZipEndSignature = 0x06054b50;
+const quint32 Zip64EndSignature = 0x06064b50;
+const quint32 Zip64LocatorSignature = 0x07064b50;
+const quint16 Zip64ExtraFieldId = 0x0001;
+const quint32 Zip64Marker = 0xFFFFFFFF;
+const quint16 ZipStored = 0;
+const quint16 ZipDeflated = 8;
+
+/** An entry of the central directory of a zip archive */
+struct ZipEntry
+{
+    QByteArray name;
+    quint16 flags;
+    quint16 method;
+    quint64 uncompressedSize;
+    quint64 compressedSize;
+    quint64 localHeader;
+};
+
+bool readBytes(QFile& file, qint64 pos, uchar* data, qint64 size)
+{
+    return file.seek(pos) && file.read(reinterpret_cast<char*>(data), size) == size;
+}
+
+/** @return the position of the end of central directory record, -1 if there is none */
+qint64 findZipEnd(QFile& file)
+{
+    // The record is the last thing in the file, followed by a comment of at most 64 KB
+    qint64 size = file.size();
+    qint64 start = qMax(qint64(0), size - 22 - 0xFFFF);
+    if (size < 22 || !file.seek(start))
+    {
+        return -1;
+    }
+    QByteArray tail = file.read(size - start);
+    const uchar* data = reinterpret_cast<const uchar*>(tail.constData());
+    for (int i = tail.size() - 22; i >= 0; --i)
+    {
+        if (qFromLittleEndian<quint32>(data + i) == ZipEndSignature &&
+            i + 22 + qFromLittleEndian<quint16>(data + i + 20) <= tail.size())
+        {
+            return start + i;
+        }
+    }
+    return -1;
+}
+
+/** Read the entries of the central directory with their 64 bit sizes and offsets */
+bool readZipEntries(QFile& file, QVector<ZipEntry>& entries)
+{
+    qint64 end = findZipEnd(file);
+    uchar record[56];
+    if (end < 0 || !readBytes(file, end, record, 22))
+    {
+        return false;
+    }
+    quint64 count = qFromLittleEndian<quint16>(record + 10);
+    quint64 pos = qFromLittleEndian<quint32>(record + 16);
+    if (count == 0xFFFF || pos == Zip64Marker)
+    {
+        // Zip64 archives keep the real values in a record found through the locator before this one
+        if (end < 20 || !readBytes(file, end - 20, record, 20) || qFromLittleEndian<quint32>(record) != Zip64LocatorSignature)
+        {
+            return false;
+        }
+        qint64 zip64End = qint64(qFromLittleEndian<quint64>(record + 8));
+        if (!readBytes(file, zip64End, record, 56) || qFromLittleEndian<quint32>(record) != Zip64EndSignature)
+        {
+            return false;
+        }
+        count = qFromLittleEndian<quint64>(record + 32);
+        pos = qFromLittleEndian<quint64>(record + 48);
+    }
+
+    uchar header[46];
+    for (quint64 i = 0; i < count; ++i)
+    {
+        if (!readBytes(file, qint64(pos), header, 46) || qFromLittleEndian<quint32>(header) != ZipCentralHeaderSignature)
+        {
+            return false;
+        }
+        quint16 nameLength = qFromLittleEndian<quint16>(header + 28);
+        quint16 extraLength = qFromLittleEndian<quint16>(header + 30);
+        quint16 commentLength = qFromLittleEndian<quint16>(header + 32);
+        QByteArray variable(nameLength + extraLength, 0);
+        if (!readBytes(file, qint64(pos) + 46, reinterpret_cast<uchar*>(variable.data()), variable.size()))
+        {
+            return false;
+        }
+
+        ZipEntry entry;
+        entry.name = variable.left(nameLength);
+        entry.flags = qFromLittleEndian<quint16>(header + 8);
+        entry.method = qFromLittleEndian<quint16>(header + 10);
+        quint64* values[3] = { &entry.uncompressedSize, &entry.compressedSize, &entry.localHeader };
+        *values[0] = qFromLittleEndian<quint32>(header + 24);
+        *values[1] = qFromLittleEndian<quint32>(header + 20);
+        *values[2] = qFromLittleEndian<quint32>(header + 42);
+        if (*values[0] == Zip64Marker || *values[1] == Zip64Marker || *values[2] == Zip64Marker)
+        {
+            // Zip64 entries keep the values which do not fit in an extra field, in this order
+            const uchar* p = reinterpret_cast<const uchar*>(variable.constData()) + nameLength;
+            const uchar* extraEnd = p + extraLength;
+            while (extraEnd - p >= 4 && qFromLittleEndian<quint16>(p) != Zip64ExtraFieldId)
+            {
+                p += 4 + qFromLittleEndian<quint16>(p + 2);
+            }
+            if (extraEnd - p < 4)
+            {
+                return false;
+            }
+            const uchar* field = p + 4;
+            const uchar* fieldEnd = qMin(extraEnd, field + qFromLittleEndian<quint16>(p + 2));
+            for (quint64* value : values)
+            {
+                if (*value == Zip64Marker)
+                {
+                    if (fieldEnd - field < 8)
+                    {
+                        return false;
+                    }
+                    *value = qFromLittleEndian<quint64>(field);
+                    field += 8;
+                }
+            }
+        }
+        entries.append(entry);
+        pos += 46 + nameLength + extraLength + commentLength;
+    }
+    return true;
+}
+
+} // namespace
+
+ArchiveDatabase::ArchiveDatabase() : PgnDatabase()
+{
+    // Uncompressed sizes are not known before the archive has been read
+    set64bit(true);
+}
+
+bool ArchiveDatabase::canOpen(const QString& filename)
+{
+    InflateDevice* device = createDevice(filename);
+    bool supported = (device != nullptr);
+    delete device;
+    return supported;
+}
+
+InflateDevice* ArchiveDatabase::createDevice(const QString& filename)
+{
+    QFile file(filename);
+    uchar magic[4];
+    if (!file.open(QIODevice::ReadOnly) || !readBytes(file, 0, magic, 4))
+    {
+        return nullptr;
+    }
+
+    if (magic[0] == 0x1f && magic[1] == 0x8b)
+    {
+        // The gzip trailer holds the uncompressed size modulo 4 GB, good enough as a hint
+        uchar trailer[4];
+        qint64 sizeHint = -1;
+        if (file.size() > 18 && readBytes(file, file.size() - 4, trailer, 4))
+        {
+            sizeHint = qFromLittleEndian<quint32>(trailer);
+        }
+        return new InflateDevice(filename, InflateDevice::Gzip, 0, -1, sizeHint);
+    }
+
+    if (qFromLittleEndian<quint32>(magic) != ZipLocalHeaderSignature)
+    {
+        return nullptr;
+    }
+
+    // The central directory is read here rather than through QuaZip, whose
+    // offsets are 32 bit values and which does not know zip64 archives
+    QVector<ZipEntry> entries;
+    if (!readZipEntries(file, entries))
+    {
+        return nullptr;
+    }
+    int pgnEntries = 0;
+    ZipEntry info;
+    foreach (const ZipEntry& entry, entries)
+    {
+        if (entry.name.toLower().endsWith(".pgn"))
+        {
+            ++pgnEntries;
+            info = entry;
+        }
+    }
+
+    // Archives with several PGN files are still extracted, encrypted or otherwise compressed entries as well
+    if (pgnEntries != 1 || (info.flags & 1) || (info.method != ZipStored && info.method != ZipDeflated))
+    {
+        return nullptr;
+    }
+
+    // The entry data follows its local header
+    uchar header[30];
+    qint64 localHeader = qint64(info.localHeader);
+    if (!readBytes(file, localHeader, header, 30) || qFromLittleEndian<quint32>(header) != ZipLocalHeaderSignature)
+    {
+        return nullptr;
+    }
+    qint64 dataStart = localHeader + 30 + qFromLittleEndian<quint16>(header + 26) + qFromLittleEndian<quint16>(header + 28);
+
+    return new InflateDevice(filename, info.method == ZipDeflated ? InflateDevice::RawDeflate : InflateDevice::Stored,
+                             dataStart, qint64(info.compressedSize), qint64(info.uncompressedSize));
+}
+
+bool ArchiveDatabase::openFile(const QString& filename)
+{
+    InflateDevice* device = createDevice(filename);
+    if (!device || !device->open(QIODevice::ReadOnly))
+    {
+        delete device;
+        return false;
+    }
+    m_file = device;
+    return true;
+}
+
+QString ArchiveDatabase::offsetFilename(const QString& filename) const
+{
+    // Keep the suffix, a plain PGN file with the same base name has its own index
+    QFileInfo fi = QFileInfo(filename);
+    return AppSettings->indexPath() + QDir::separator() + fi.fileName() + ".cxi";
+}
+
+bool ArchiveDatabase::readIndexFile(QDataStream& in, const QSharedPointer<const FileMapping>& mapping, volatile bool* breakFlag, short version)
+{
+    if (!PgnDatabase::readIndexFile(in, mapping, breakFlag, version))
+    {
+        return false;
+    }
+    // Without access points every game is inflated from the start of the archive, which is slow but correct
+    InflateDevice* device = qobject_cast<InflateDevice*>(m_file.data());
+    return device && device->readAccessPoints(in);
+}
+
+bool ArchiveDatabase::writeIndexFile(QDataStream& out) const
+{
+    if (!PgnDatabase::writeIndexFile(out))
+    {
+        return false;
+    }
+    InflateDevice* device = qobject_cast<InflateDevice*>(m_file.data());
+    if (device)
+    {
+        device->writeAccessPoints(out);
+    }
+    return device != nullptr;
+}
@@ -0,0 +1,43 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef ARCHIVEDATABASE_H
+#define ARCHIVEDATABASE_H
+
+#include "pgndatabase.h"
+
+class InflateDevice;
+
+/** @ingroup Database
+   The ArchiveDatabase class provides read only access to a PGN file which is
+   gzipped or the single PGN entry of a zip archive, without extracting it.
+   Game offsets refer to the uncompressed data, which is read through an
+   InflateDevice. Its access points are kept in the index file, so loading
+   a game inflates only from the closest access point.
+*/
+class ArchiveDatabase : public PgnDatabase
+{
+    Q_OBJECT
+public:
+    ArchiveDatabase();
+    /** @return true if @p filename is a gzip file or a zip archive holding one PGN file */
+    static bool canOpen(const QString& filename);
+
+protected:
+    virtual bool openFile(const QString& filename);
+    virtual QString offsetFilename(const QString& filename) const;
+    /** Offsets are positions in the uncompressed data, growing compressed data cannot be checked */
+    virtual bool canIndexAppendedGames() const { return false; }
+    virtual bool readIndexFile(QDataStream& in, const QSharedPointer<const FileMapping>& mapping, volatile bool *breakFlag, short version);
+    virtual bool writeIndexFile(QDataStream& out) const;
+
+private:
+    /** Create a device for the compressed PGN data in @p filename, nullptr if not supported */
+    static InflateDevice* createDevice(const QString& filename);
+};
+
+#endif // ARCHIVEDATABASE_H
@@ -16,6 +16,8 @@
 
 #ifdef _MSC_VER
 #include <intrin.h>
+#elif defined(BITBOARD_HAVE_PEXT)
+#include <cpuid.h>
 #endif
 
 #include <QtCore>
@@ -32,17 +34,13 @@ quint64 bb_PawnF2[2][64];
 quint64 bb_PawnALL[2][64];
 quint64 bb_PromotionRank[2];
 quint64 bb_KnightAttacks[64];
-quint64 bb_R45Attacks[64][64];
-quint64 bb_L45Attacks[64][64];
 quint64 bb_KingAttacks[64];
-quint64 bb_RankAttacks[64][64];
-quint64 bb_FileAttacks[64][64];
+SliderAttacks bb_RookAttacks[64];
+SliderAttacks bb_BishopAttacks[64];
+bool bb_UsePext;
 quint64 bb_fileMask[8];
 quint64 bb_rankMask[8];
 quint64 bb_Mask[64];
-quint64 bb_MaskL90[64];
-quint64 bb_MaskL45[64];
-quint64 bb_MaskR45[64];
 
 using namespace chessx;
 
@@ -67,42 +65,6 @@ const quint64 A6 = H5 << 1, B6 = A6 << 1, C6 = B6 << 1, D6 = C6 << 1, E6 = D6 <<
 const quint64 A7 = H6 << 1, B7 = A7 << 1, C7 = B7 << 1, D7 = C7 << 1, E7 = D7 << 1, F7 = E7 << 1, G7 = F7 << 1, H7 = G7 << 1;
 const quint64 A8 = H7 << 1, B8 = A8 << 1, C8 = B8 << 1, D8 = C8 << 1, E8 = D8 << 1, F8 = E8 << 1, G8 = F8 << 1, H8 = G8 << 1;
 
-const unsigned int RotateL90[64] =
-{
-    h1, h2, h3, h4, h5, h6, h7, h8,
-    g1, g2, g3, g4, g5, g6, g7, g8,
-    f1, f2, f3, f4, f5, f6, f7, f8,
-    e1, e2, e3, e4, e5, e6, e7, e8,
-    d1, d2, d3, d4, d5, d6, d7, d8,
-    c1, c2, c3, c4, c5, c6, c7, c8,
-    b1, b2, b3, b4, b5, b6, b7, b8,
-    a1, a2, a3, a4, a5, a6, a7, a8,
-};
-
-const unsigned int RotateR45[64] =
-{
-    a1, b8, c7, d6, e5, f4, g3, h2,
-    a2, b1, c8, d7, e6, f5, g4, h3,
-    a3, b2, c1, d8, e7, f6, g5, h4,
-    a4, b3, c2, d1, e8, f7, g6, h5,
-    a5, b4, c3, d2, e1, f8, g7, h6,
-    a6, b5, c4, d3, e2, f1, g8, h7,
-    a7, b6, c5, d4, e3, f2, g1, h8,
-    a8, b7, c6, d5, e4, f3, g2, h1
-};
-
-const unsigned int RotateL45[64] =
-{
-    a2, b3, c4, d5, e6, f7, g8, h1,
-    a3, b4, c5, d6, e7, f8, g1, h2,
-    a4, b5, c6, d7, e8, f1, g2, h3,
-    a5, b6, c7, d8, e1, f2, g3, h4,
-    a6, b7, c8, d1, e2, f3, g4, h5,
-    a7, b8, c1, d2, e3, f4, g5, h6,
-    a8, b1, c2, d3, e4, f5, g6, h7,
-    a1, b2, c3, d4, e5, f6, g7, h8
-};
-
 const unsigned char Castle[64] =
 {
     0xFB, 255, 255, 255, 0xFA, 255, 255, 0xFE,
@@ -126,9 +88,6 @@ const quint64 fileNotH    = ~ fileH;
 const quint64 fileNotAB   = ~(fileA | fileB);
 const quint64 fileNotGH   = ~(fileG | fileH);
 
-#define SetBitL90(s)      (bb_MaskL90[s])
-#define SetBitL45(s)      (bb_MaskL45[s])
-#define SetBitR45(s)      (bb_MaskR45[s])
 #define ShiftDown(b)      ((b)>>8)
 #define Shift2Down(b)     ((b)>>16)
 #define ShiftUp(b)        ((b)<<8)
@@ -229,6 +188,33 @@ bool BitBoard::isStalemate() const
     return !isCheck();
 }
 
+quint64 BitBoard::perft(int depth) const
+{
+    if(depth <= 0)
+    {
+        return 1;
+    }
+    BitBoard board(*this);
+    Move::List moves(generateMoves());
+    quint64 nodes = 0;
+    for(int i = 0; i < moves.size(); ++i)
+    {
+        if(isIntoCheck(moves[i]))
+        {
+            continue;
+        }
+        if(depth == 1)
+        {
+            ++nodes;
+            continue;
+        }
+        board.doMove(moves[i]);
+        nodes += board.perft(depth - 1);
+        board.undoMove(moves[i]);
+    }
+    return nodes;
+}
+
 void BitBoard::removeIllegal(const Move& move, quint64& b) const
 {
     quint64 mask = 1;
@@ -523,9 +509,6 @@ void BitBoard::setAt(const Square s, const Piece p)
     m_piece[s] = pt;
     m_occupied ^= bit;
     m_occupied_co[_color] ^= bit;
-    m_occupied_l90 ^= SetBitL90(s);
-    m_occupied_l45 ^= SetBitL45(s);
-    m_occupied_r45 ^= SetBitR45(s);
 }
 
 void BitBoard::removeAt(const Square s)
@@ -580,9 +563,6 @@ void BitBoard::removeAt(const Square s)
     m_piece[s] = Empty;
     m_occupied ^= bit;
     m_occupied_co[_color] ^= bit;
-    m_occupied_l90 ^= SetBitL90(s);
-    m_occupied_l45 ^= SetBitL45(s);
-    m_occupied_r45 ^= SetBitR45(s);
 }
 
 bool BitBoard::isValidFen(const QString& fen) const
@@ -988,15 +968,6 @@ bool BitBoard::fromGoodFen(const QString& qfen, bool chess960)
 
     // Set remainder of bitboard data appropriately
     m_occupied = m_occupied_co[White] + m_occupied_co[Black];
-    for(int i = 0; i < 64; ++i)
-    {
-        if(SetBit(i)&m_occupied)
-        {
-            m_occupied_l90 |= SetBitL90(i);
-            m_occupied_l45 |= SetBitL45(i);
-            m_occupied_r45 |= SetBitR45(i);
-        }
-    }
 
     // Side to move
     c = fen[++i];
@@ -1827,9 +1798,29 @@ Move BitBoard::dummyMove() const
     return m;
 }
 
-static int strncmpi(QByteArray a, QByteArray b, int n)
+/** Return true if the @p length bytes at @p s start with @p prefix, ignoring case */
+static bool startsWithNoCase(const char* s, size_t length, const char* prefix)
+{
+    size_t n = strlen(prefix);
+    if(length < n)
+    {
+        return false;
+    }
+    for(size_t i = 0; i < n; ++i)
+    {
+        if(tolower(static_cast<unsigned char>(s[i])) != prefix[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/** Return true if the @p length bytes at @p s start with @p prefix */
+static bool startsWith(const char* s, size_t length, const char* prefix)
 {
-    return strncmp(a.toLower(), b.toLower(), n);
+    size_t n = strlen(prefix);
+    return length >= n && strncmp(s, prefix, n) == 0;
 }
 
 Move BitBoard::createCastlingK() const
@@ -1848,10 +1839,17 @@ Move BitBoard::createCastlingQ() const
 
 Move BitBoard::parseMove(const QString& algebraic) const
 {
-    const QByteArray& bs(algebraic.toLatin1());
-    const char *san = bs.constData();
+    const QByteArray bs(algebraic.toLatin1());
+    return parseMove(bs.constData(), size_t(bs.size()));
+}
+
+Move BitBoard::parseMove(const char* san, size_t length) const
+{
     const char* s = san;
-    char c = *(s++);
+    const char* end = san + length;
+    // Reading past the token yields 0, as for a zero terminated string
+    auto next = [&s, end]() -> char { return s < end ? *(s++) : '\0'; };
+    char c = next();
     quint64 match;
     Square fromSquare = InvalidSquare;
     Square toSquare = InvalidSquare;
@@ -1860,37 +1858,37 @@ Move BitBoard::parseMove(const QString& algebraic) const
     Move move;
     unsigned int type;
 
-    if (algebraic=="none")
+    if (length == 4 && strncmp(san, "none", 4) == 0)
         return move;
 
     // Castling
     if(c == 'o' || c == 'O' || c == '0')
     {
-        if (strlen(san)>=5)
+        if (length>=5)
         {
-            if(strncmpi(san, "o-o-o", 5) == 0 || strncmp(san, "0-0-0", 5)  == 0)
+            if(startsWithNoCase(san, length, "o-o-o") || startsWith(san, length, "0-0-0"))
             {
                 return createCastlingQ();
             }
         }
-        else if (strlen(san)==3)
+        else if (length==3)
         {
-            if(strncmpi(san, "o-o", 3) == 0 || strncmp(san, "0-0", 3)  == 0)
+            if(startsWithNoCase(san, length, "o-o") || startsWith(san, length, "0-0"))
             {
                 return createCastlingK();
             }
-            else if(strncmp(san, "000", 3) == 0)
+            else if(startsWith(san, length, "000"))
             {
                 return createCastlingQ();
             }
         }
-        else if (strlen(san)==2)
+        else if (length==2)
         {
-            if ((strncmp(san, "00", 2) == 0) || (strncmpi(san, "0K", 2) == 0))
+            if (startsWith(san, length, "00") || startsWithNoCase(san, length, "0k"))
             {
                 return createCastlingK();
             }
-            else if (strncmpi(san, "0Q", 2) == 0)
+            else if (startsWithNoCase(san, length, "0q"))
             {
                 return createCastlingQ();
             }
@@ -1901,21 +1899,21 @@ Move BitBoard::parseMove(const QString& algebraic) const
     // Null Move
     if(c == '-')
     {
-        if(strncmp(san, "--", 2) == 0)
+        if(startsWith(san, length, "--"))
         {
             return nullMove();
         }
     }
     else if (c == 'Z')
     {
-        if(strncmp(san, "Z0", 2) == 0)
+        if(startsWith(san, length, "Z0"))
         {
             return nullMove();
         }
     }
     else if (c == 'n')
     {
-        if(strncmp(san, "null", 4) == 0)
+        if(startsWith(san, length, "null"))
         {
             return nullMove();
         }
@@ -1926,26 +1924,26 @@ Move BitBoard::parseMove(const QString& algebraic) const
     {
     case 'Q':
         type = Queen;
-        c = *(s++);
+        c = next();
         break;
     case 'R':
         type = Rook;
-        c = *(s++);
+        c = next();
         break;
     case 'B':
         type = Bishop;
-        c = *(s++);
+        c = next();
         break;
     case 'N':
         type = Knight;
-        c = *(s++);
+        c = next();
         break;
     case 'K':
         type = King;
-        c = *(s++);
+        c = next();
         break;
     case 'P':
-        c = *(s++); // Fall through
+        c = next(); // Fall through
         type = Pawn;
         break;
     default:
@@ -1957,37 +1955,37 @@ Move BitBoard::parseMove(const QString& algebraic) const
     if(isFile(c))
     {
         fromFile = c - 'a';
-        c = *(s++);
+        c = next();
         if(isRank(c))
         {
             fromSquare = Square((c - '1') * 8 + fromFile);
             fromFile = -1;
-            c = *(s++);
+            c = next();
         }
     }
     else if(isRank(c))
     {
         fromRank = c - '1';
-        c = *(s++);
+        c = next();
     }
 
     // Capture indicator (or dash in the case of a LAN move)
     if(c == 'x' || c == '-' || c == ':')
     {
-        c = *(s++);
+        c = next();
     }
 
     // Destination square
     if(isFile(c))
     {
         int f = c - 'a';
-        c = *(s++);
+        c = next();
         if(!isRank(c))
         {
             return move;
         }
         toSquare = Square((c - '1') * 8 + f);
-        c = *(s++);
+        c = next();
     }
     else
     {
@@ -2022,13 +2020,13 @@ Move BitBoard::parseMove(const QString& algebraic) const
         PieceType promotePiece = None;
 
         // Promotion as in bxc8=Q or bxc8(Q) or bxc8(Q)
-        if(c == '=' || c == '(' || QString("QRBN").indexOf((char)toupper(c))>=0)
+        if(c == '=' || c == '(' || (c && strchr("QRBN", toupper(static_cast<unsigned char>(c)))))
         {
             if(c == '=' || c == '(')
             {
-                c = *(s++);
+                c = next();
             }
-            switch(toupper(c))
+            switch(toupper(static_cast<unsigned char>(c)))
             {
             case 'Q':
                 promotePiece = Queen;
@@ -2270,9 +2268,6 @@ bool BitBoard::doMove(const Move& m)
             m_piece[rook_to] = Rook;
             m_rooks ^= SetBit(rook_from) ^ SetBit(rook_to);
             m_occupied_co[m_stm] ^= SetBit(rook_from) ^ SetBit(rook_to);
-            m_occupied_l90 ^= SetBitL90(rook_from) ^ SetBitL90(rook_to);
-            m_occupied_l45 ^= SetBitL45(rook_from) ^ SetBitL45(rook_to);
-            m_occupied_r45 ^= SetBitR45(rook_from) ^ SetBitR45(rook_to);
         }
         break;
     case Move::TWOFORWARD:
@@ -2312,12 +2307,6 @@ bool BitBoard::doMove(const Move& m)
     switch(m.removal())
     {
     case Empty:
-        if (to != from)
-        {
-            m_occupied_l90 ^= SetBitL90(to);     // extra cleanup needed for non-captures
-            m_occupied_l45 ^= SetBitL45(to);
-            m_occupied_r45 ^= SetBitR45(to);
-        }
         break;
     case Pawn:
         --m_pieceCount[sntm];
@@ -2360,9 +2349,6 @@ bool BitBoard::doMove(const Move& m)
         m_piece[epsq] = Empty;
         m_pawns ^= SetBit(epsq);
         m_occupied_co[sntm] ^= SetBit(epsq);
-        m_occupied_l90 ^= SetBitL90(to) ^ SetBitL90(epsq);
-        m_occupied_l45 ^= SetBitL45(to) ^ SetBitL45(epsq);
-        m_occupied_r45 ^= SetBitR45(to) ^ SetBitR45(epsq);
         break;
     }  // ...no I did not forget the king :)
 
@@ -2372,13 +2358,7 @@ bool BitBoard::doMove(const Move& m)
         {
             m_piece[from] = Empty;
         }
-        if (bb_from != bb_to)
-        {
-            m_occupied_co[m_stm] ^= bb_from ^ bb_to;
-            m_occupied_l90 ^= SetBitL90(from);
-            m_occupied_l45 ^= SetBitL45(from);
-            m_occupied_r45 ^= SetBitR45(from);
-        }
+        m_occupied_co[m_stm] ^= bb_from ^ bb_to;
         m_occupied = m_occupied_co[White] + m_occupied_co[Black];
     }
 
@@ -2498,9 +2478,6 @@ void BitBoard::undoMove(const Move& m)
             m_piece[rook_from] = Rook;
             m_rooks ^= SetBit(rook_from) ^ SetBit(rook_to);
             m_occupied_co[sntm] ^= SetBit(rook_from) ^ SetBit(rook_to);
-            m_occupied_l90 ^= SetBitL90(rook_from) ^ SetBitL90(rook_to);
-            m_occupied_l45 ^= SetBitL45(rook_from) ^ SetBitL45(rook_to);
-            m_occupied_r45 ^= SetBitR45(rook_from) ^ SetBitR45(rook_to);
         }
         break;
     case Move::PROMOTE:
@@ -2530,12 +2507,6 @@ void BitBoard::undoMove(const Move& m)
     switch(m.removal())     // Reverse captures
     {
     case Empty:
-        if (to != from)
-        {
-            m_occupied_l90 ^= SetBitL90(to);     // extra cleanup needed for non-captures
-            m_occupied_l45 ^= SetBitL45(to);
-            m_occupied_r45 ^= SetBitR45(to);
-        }
         break;
     case Pawn:
         ++m_pieceCount[m_stm];
@@ -2569,9 +2540,6 @@ void BitBoard::undoMove(const Move& m)
         m_piece[epsq] = Pawn;
         m_pawns ^= SetBit(epsq);
         m_occupied_co[m_stm] ^= SetBit(epsq);
-        m_occupied_l90 ^= SetBitL90(to) ^ SetBitL90(epsq);
-        m_occupied_l45 ^= SetBitL45(to) ^ SetBitL45(epsq);
-        m_occupied_r45 ^= SetBitR45(to) ^ SetBitR45(epsq);
         break;
     }  // ...no I did not forget the king :)
 
@@ -2581,13 +2549,7 @@ void BitBoard::undoMove(const Move& m)
         {
             m_piece[to] = replace;
         }
-        if (bb_from != bb_to)
-        {
-            m_occupied_co[sntm] ^= bb_from ^ bb_to;
-            m_occupied_l90 ^= SetBitL90(from);
-            m_occupied_l45 ^= SetBitL45(from);
-            m_occupied_r45 ^= SetBitR45(from);
-        }
+        m_occupied_co[sntm] ^= bb_from ^ bb_to;
         m_occupied = m_occupied_co[White] + m_occupied_co[Black];
     }
 
@@ -2989,6 +2951,58 @@ bool BitBoard::canBeReachedFrom(const BitBoard& target) const
     return true;
 }
 
+quint64 BitBoard::materialSignature() const
+{
+    const quint64 pieces[] = { m_queens, m_rooks, m_bishops, m_knights, m_pawns };
+    const int types = sizeof(pieces) / sizeof(pieces[0]);
+    quint64 signature = 0;
+    for (int color = White; color <= Black; ++color)
+    {
+        for (int i = 0; i < types; ++i)
+        {
+            quint64 count = qMin(countSetBits(pieces[i] & m_occupied_co[color]), 15u);
+            signature |= count << (4 * (types * color + i));
+        }
+    }
+    return signature;
+}
+
+quint16 BitBoard::homePawns() const
+{
+    quint64 white = ((m_pawns & m_occupied_co[White]) >> 8) & 0xFF;
+    quint64 black = ((m_pawns & m_occupied_co[Black]) >> 48) & 0xFF;
+    return quint16(white | (black << 8));
+}
+
+quint64 BitBoard::pieceMask(Piece piece) const
+{
+    quint64 pieces;
+    switch(pieceType(piece))
+    {
+    case King:
+        pieces = m_kings;
+        break;
+    case Queen:
+        pieces = m_queens;
+        break;
+    case Rook:
+        pieces = m_rooks;
+        break;
+    case Bishop:
+        pieces = m_bishops;
+        break;
+    case Knight:
+        pieces = m_knights;
+        break;
+    case Pawn:
+        pieces = m_pawns;
+        break;
+    default:
+        return ~m_occupied;
+    }
+    return pieces & m_occupied_co[pieceColor(piece)];
+}
+
 bool BitBoard::insufficientMaterial() const
 {
     if (m_pawns==0)
@@ -3255,11 +3269,160 @@ QString BitBoard::toHumanFen() const
     return fen;
 }
 
+// Multipliers for the fancy magic lookup, one per square, found by trial
+// with sparse random numbers. Each maps every relevant occupancy of its
+// square into a (1 << popcount(mask)) sized slice without a harmful collision.
+const quint64 RookMagic[64] =
+{
+    0x0a80004000801220ULL, 0x8040004010002008ULL, 0x2080200010008008ULL, 0x1100100008210004ULL,
+    0xc200209084020008ULL, 0x2100010004000208ULL, 0x0400081000822421ULL, 0x0200010422048844ULL,
+    0x0800800080400024ULL, 0x0001402000401000ULL, 0x3000801000802001ULL, 0x4400800800100083ULL,
+    0x0904802402480080ULL, 0x4040800400020080ULL, 0x0018808042000100ULL, 0x4040800080004100ULL,
+    0x8020208000401080ULL, 0x0090024001200042ULL, 0x8800110045002000ULL, 0x0811010010000820ULL,
+    0x1012020020100804ULL, 0x2066008080040002ULL, 0x0800808001000200ULL, 0x0400220004451084ULL,
+    0x0202010200208042ULL, 0x0540100020080023ULL, 0x8210040120016800ULL, 0x4240100080800800ULL,
+    0x0009001100040800ULL, 0x4002100801042040ULL, 0x8400900400110852ULL, 0x5000110200244084ULL,
+    0x1880002000c00040ULL, 0x0090002000404008ULL, 0x0028420082001422ULL, 0x4800800800801000ULL,
+    0x4858080080800400ULL, 0x3800040080800200ULL, 0x1105a11004000842ULL, 0x1000008042002104ULL,
+    0x0050c00027808008ULL, 0x0010004020004000ULL, 0x1020402082020010ULL, 0x0010010080080800ULL,
+    0x2004008040080800ULL, 0x1100040002008080ULL, 0x8001000200010004ULL, 0x02d1140040820001ULL,
+    0x0400410028820200ULL, 0x0400410028820200ULL, 0x0d00801000200080ULL, 0x11d0008050080180ULL,
+    0x088d002040801002ULL, 0xd002810400020080ULL, 0x18a0021001080400ULL, 0x0800410884014600ULL,
+    0x1542c0d504218001ULL, 0x2040002014410381ULL, 0xc80100100d6000c1ULL, 0x010e00201004400aULL,
+    0x90a2006088110402ULL, 0x0001000802040001ULL, 0x0002004108142082ULL, 0x4400041080450822ULL
+};
+
+const quint64 BishopMagic[64] =
+{
+    0x40106000a1160020ULL, 0x0020010250810120ULL, 0x2010010220280081ULL, 0x002806004050c040ULL,
+    0x0002021018000000ULL, 0x2001112010000400ULL, 0x0881010120218080ULL, 0x1030820110010500ULL,
+    0x0000120222042400ULL, 0x2000020404040044ULL, 0x8000480094208000ULL, 0x0003422a02000001ULL,
+    0x000a220210100040ULL, 0x8004820202226000ULL, 0x0018234854100800ULL, 0x0100004042101040ULL,
+    0x2050040460880106ULL, 0xa2202022a4241880ULL, 0x4804108802441600ULL, 0x0000808802004114ULL,
+    0x0204008200a20120ULL, 0x0041000280600211ULL, 0x0010404124100400ULL, 0x8088808020941002ULL,
+    0x01042520a0201c00ULL, 0x0210108002020244ULL, 0x8000820140440100ULL, 0x1040040020820880ULL,
+    0x0001001201004002ULL, 0x8120a90002004200ULL, 0x0040922405080200ULL, 0x8120a90002004200ULL,
+    0x12a1282001421400ULL, 0x12a1282001421400ULL, 0x3803080200070408ULL, 0x0008400809038200ULL,
+    0x2420004040c40102ULL, 0x0010120600a02280ULL, 0x000a941c000b0880ULL, 0x0028010222010a90ULL,
+    0x4008882012000800ULL, 0x0402161002000d00ULL, 0xe500a28120801000ULL, 0x0030c84200800800ULL,
+    0x0c60405009060880ULL, 0x42100a0a41000812ULL, 0x00088b0902050420ULL, 0x0204082882200100ULL,
+    0x0006020120a90000ULL, 0x0200208208200060ULL, 0x1820102084100604ULL, 0x0030080020881009ULL,
+    0x2120c01042020910ULL, 0x2004081001420810ULL, 0x2004081001420810ULL, 0x2002100101011812ULL,
+    0x0001004110211049ULL, 0x0040004044100938ULL, 0x2022800600b40408ULL, 0x0408400a00840400ULL,
+    0x0000000008030400ULL, 0x2805008821082080ULL, 0x0000202210050130ULL, 0x40400800c4084040ULL
+};
+
+const int RookDirections[4][2] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } };
+const int BishopDirections[4][2] = { { 1, 1 }, { -1, 1 }, { 1, -1 }, { -1, -1 } };
+
+quint64 bb_RookTable[0x19000];
+quint64 bb_BishopTable[0x1480];
+
+/** Walk the rays from square @p s until the board edge or the first occupied square */
+static quint64 slidingAttacks(int s, quint64 occupied, const int directions[4][2])
+{
+    quint64 attacks = 0;
+    for(int d = 0; d < 4; ++d)
+    {
+        int file = File(s) + directions[d][0];
+        int rank = Rank(s) + directions[d][1];
+        while(file >= 0 && file < 8 && rank >= 0 && rank < 8)
+        {
+            quint64 bit = SetBit(rank * 8 + file);
+            attacks |= bit;
+            if(occupied & bit)
+            {
+                break;
+            }
+            file += directions[d][0];
+            rank += directions[d][1];
+        }
+    }
+    return attacks;
+}
+
+/** Return true if the CPU executes PEXT in hardware at full speed.
+    Zen 1 and Zen 2 implement it in microcode, there the multiplication wins. */
+static bool cpuHasFastPext()
+{
+#if defined(BITBOARD_HAVE_PEXT) && defined(_MSC_VER)
+    int regs[4];
+    __cpuid(regs, 0);
+    bool amd = regs[1] == 0x68747541; // "Auth"enticAMD
+    __cpuid(regs, 1);
+    int family = ((regs[0] >> 8) & 0xf) + ((regs[0] >> 20) & 0xff);
+    __cpuidex(regs, 7, 0);
+    return (regs[1] & (1 << 8)) && !(amd && family < 0x19);
+#elif defined(BITBOARD_HAVE_PEXT)
+    unsigned int eax, ebx, ecx, edx;
+    if(!__get_cpuid(0, &eax, &ebx, &ecx, &edx))
+    {
+        return false;
+    }
+    bool amd = ebx == 0x68747541; // "Auth"enticAMD
+    __get_cpuid(1, &eax, &ebx, &ecx, &edx);
+    unsigned int family = ((eax >> 8) & 0xf) + ((eax >> 20) & 0xff);
+    if(!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+    {
+        return false;
+    }
+    return (ebx & (1 << 8)) && !(amd && family < 0x19);
+#else
+    return false;
+#endif
+}
+
+/** Fill the attack table slices of one slider type */
+static void initSliderAttacks(SliderAttacks* sliders, quint64* table, const quint64* magics,
+                              const int directions[4][2])
+{
+    quint64* attacks = table;
+    for(int s = 0; s < 64; ++s)
+    {
+        // The outermost square of a ray is attacked whether it is occupied or not
+        quint64 edges = ((bb_rankMask[0] | bb_rankMask[7]) & ~bb_rankMask[Rank(s)]) |
+                        ((bb_fileMask[0] | bb_fileMask[7]) & ~bb_fileMask[File(s)]);
+        SliderAttacks& slider = sliders[s];
+        slider.mask = slidingAttacks(s, 0, directions) & ~edges;
+        slider.magic = magics[s];
+        slider.attacks = attacks;
+        unsigned int bits = 0;
+        for(quint64 m = slider.mask; m; m &= m - 1)
+        {
+            ++bits;
+        }
+        slider.shift = 64 - bits;
+
+        // Enumerate all subsets of the mask (Carry-Rippler)
+        quint64 occupied = 0;
+        do
+        {
+            quint64& entry = attacks[slider.index(occupied)];
+            quint64 reference = slidingAttacks(s, occupied, directions);
+            Q_ASSERT(!entry || entry == reference);
+            entry = reference;
+            occupied = (occupied - slider.mask) & slider.mask;
+        }
+        while(occupied);
+        attacks += quint64(1) << bits;
+    }
+}
+
+/** Build the rook and bishop lookups, choosing PEXT indexing when it pays off */
+static void initSliderAttacks()
+{
+    bb_UsePext = cpuHasFastPext();
+    memset(bb_RookTable, 0, sizeof(bb_RookTable));
+    memset(bb_BishopTable, 0, sizeof(bb_BishopTable));
+    initSliderAttacks(bb_RookAttacks, bb_RookTable, RookMagic, RookDirections);
+    initSliderAttacks(bb_BishopAttacks, bb_BishopTable, BishopMagic, BishopDirections);
+}
+
 /** Calculate global bit board values before starting */
 void bitBoardInit()
 {
     bitBoardInitRun = true;
-    int i, q;
+    int i;
     quint64 mask;
 
     // Square masks
@@ -3268,12 +3431,6 @@ void bitBoardInit()
     {
         bb_Mask[i] = mask << i;
     }
-    for(i = 0; i < 64; ++i)
-    {
-        bb_MaskL90[i] = SetBit(RotateL90[i]);
-        bb_MaskL45[i] = SetBit(RotateL45[i]);
-        bb_MaskR45[i] = SetBit(RotateR45[i]);
-    }
 
     // Pawn moves and attacks
     for(i = 0; i < 64; ++i)
@@ -3314,114 +3471,6 @@ void bitBoardInit()
         bb_KnightAttacks[i] |= Shift2Right(ShiftDown(mask));
     }
 
-    // Diagonal attacks
-    for(int s = 0; s < 64; ++s)
-    {
-        for(int b = 0; b < 64; ++b)
-        {
-            mask = 0;
-            q = s;
-            while(File(q) > 0 && Rank(q) < 7)
-            {
-                q += 7;
-                mask |= SetBit(q);
-                if(b & (SetBit(RotateL45[q]) >> bb_ShiftL45[s]))
-                {
-                    break;
-                }
-            }
-            q = s;
-            while(File(q) < 7 && Rank(q) > 0)
-            {
-                q -= 7;
-                mask |= SetBit(q);
-                if(b & (SetBit(RotateL45[q]) >> bb_ShiftL45[s]))
-                {
-                    break;
-                }
-            }
-            bb_L45Attacks[s][b] = mask;
-
-            mask = 0;
-            q = s;
-            while(File(q) < 7 && Rank(q) < 7)
-            {
-                q += 9;
-                mask |= SetBit(q);
-                if(b & (SetBit(RotateR45[q]) >> bb_ShiftR45[s]))
-                {
-                    break;
-                }
-            }
-            q = s;
-            while(File(q) > 0 && Rank(q) > 0)
-            {
-                q -= 9;
-                mask |= SetBit(q);
-                if(b & (SetBit(RotateR45[q]) >> bb_ShiftR45[s]))
-                {
-                    break;
-                }
-            }
-            bb_R45Attacks[s][b] = mask;
-        }
-    }
-
-    // Rank and File attacks
-    memset(bb_RankAttacks, 0, sizeof(bb_RankAttacks));
-    memset(bb_FileAttacks, 0, sizeof(bb_FileAttacks));
-    int file, rank;
-    for(int sq = 0; sq < 64; ++sq)
-    {
-        for(int bitrow = 0; bitrow < 64; ++bitrow)
-        {
-            file = File(sq);
-            q = sq + 1;
-            while(++file < 8)
-            {
-                bb_RankAttacks[sq][bitrow] |= SetBit(q);
-                if((1 << file) & (bitrow << 1))
-                {
-                    break;
-                }
-                ++q;
-            }
-            file = File(sq);
-            q = sq - 1;
-            while(--file >= 0)
-            {
-                bb_RankAttacks[sq][bitrow] |= SetBit(q);
-                if((1 << file) & (bitrow << 1))
-                {
-                    break;
-                }
-                --q;
-            }
-            rank = Rank(sq);
-            q = sq + 8;
-            while(++rank < 8)
-            {
-                bb_FileAttacks[sq][bitrow] |= SetBit(q);
-                if((1 << (7 - rank)) & (bitrow << 1))
-                {
-                    break;
-                }
-                q += 8;
-            }
-            rank = Rank(sq);
-            q = sq - 8;
-            while(--rank >= 0)
-            {
-                bb_FileAttacks[sq][bitrow] |= SetBit(q);
-                if((1 << (7 - rank)) & (bitrow << 1))
-                {
-                    break;
-                }
-                q -= 8;
-            }
-        }
-    }
-
     // King:
     for(i = 0; i < 64; ++i)
     {
@@ -3451,6 +3500,9 @@ void bitBoardInit()
     bb_PromotionRank[White] = bb_rankMask[7];
     bb_PromotionRank[Black] = bb_rankMask[0];
 
+    // Sliding attacks, needs the file and rank masks
+    initSliderAttacks();
+
     // Now that global data has been calculated, we can create a start position
     standardPosition.fromFen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
 }
@@ -14,6 +14,15 @@
 #ifndef BITBOARD_H_INCLUDED
 #define BITBOARD_H_INCLUDED
 
+// PEXT indexing is chosen at compile time: it is only built when the compiler
+// targets BMI2 (e.g. -mbmi2 or -march=haswell), default builds always use the
+// magic multiplication. A BMI2 build still falls back to the multiplication
+// on CPUs with a microcoded PEXT (see bb_UsePext).
+#if (defined(__BMI2__) || (defined(_MSC_VER) && defined(__AVX2__))) && (defined(__x86_64__) || defined(_M_X64))
+#include <immintrin.h>
+#define BITBOARD_HAVE_PEXT
+#endif
+
 namespace chessx {
 
 enum BoardStatus
@@ -85,6 +94,8 @@ public:
 
     /** parse SAN or LAN representation of move, and return proper Move() object */
     Move parseMove(const QString& algebraic) const;
+    /** parse SAN or LAN from @p length bytes at @p san, which need not be zero terminated */
+    Move parseMove(const char* san, size_t length) const;
     /** Return a proper Move() object given only a from-to move specification */
     Move prepareMove(const chessx::Square& from, const chessx::Square& to) const;
 
@@ -114,6 +125,12 @@ public:
     bool whiteToMove() const;
     /** @return true if its possible for this position to follow target position */
     bool canBeReachedFrom(const BitBoard& target) const;
+    /** Number of queens, rooks, bishops, knights and pawns of each side, 4 bits each, white in the low bits */
+    quint64 materialSignature() const;
+    /** Pawns on their initial squares, a2-h2 in bits 0-7 and a7-h7 in bits 8-15 */
+    quint16 homePawns() const;
+    /** Squares occupied by @p piece, the empty squares for Empty */
+    quint64 pieceMask(Piece piece) const;
     /** @return true if position is same, but don't consider Move # in determination */
     bool positionIsSame(const BitBoard& target) const;
     /** @return true if neither side can win the game */
@@ -212,6 +229,8 @@ public:
     int numAttackedBy(const unsigned int color, chessx::Square square) const;
     /** Generate all possible moves in a given position */
     Move::List generateMoves() const;
+    /** Count the leaf nodes of the legal move tree to the given depth (move generator check) */
+    quint64 perft(int depth) const;
     /** Calculate a material evaluation */
     int score() const;
     bool compare(const BitBoard& b) const; //!< Return true if same pieces and castling rights, false otherwise
@@ -277,9 +296,6 @@ private:
     quint64 m_pawns, m_knights, m_bishops, m_rooks, m_castlingRooks, m_queens, m_kings;
     quint64 m_occupied_co[2];     // Square mask of those occupied by each color
     quint64 m_occupied;           // Square is empty or holds a piece
-    quint64 m_occupied_l90;       // rotated counter clockwise 90 deg
-    quint64 m_occupied_l45;       // an odd transformation, to straighten out diagonals
-    quint64 m_occupied_r45;       // the opposite odd transformation, just as messy
 
     // Extra state data
     unsigned char m_piece[64];             // type of piece on this square
@@ -344,37 +360,36 @@ enum Char64Relation
 
 } // namespace chessx
 
+/** Sliding attack lookup for one square. The occupied squares that can block
+    the slider are mapped to an index into a shared attack table, by a magic
+    multiplication or, where the CPU has a fast one, a PEXT instruction. */
+struct SliderAttacks
+{
+    quint64 mask;          // squares that can block, the board edges excluded
+    quint64 magic;
+    quint64* attacks;
+    unsigned int shift;
+
+    unsigned int index(quint64 occupied) const;
+};
+
 extern quint64 bb_PawnAttacks[2][64];
 extern quint64 bb_KnightAttacks[64];
-extern quint64 bb_R45Attacks[64][64];
-extern quint64 bb_L45Attacks[64][64];
 extern quint64 bb_KingAttacks[64];
-extern quint64 bb_RankAttacks[64][64];
-extern quint64 bb_FileAttacks[64][64];
-
-const unsigned int bb_ShiftR45[64] =
-{
-    1, 58, 51, 44, 37, 30, 23, 16,
-    9, 1, 58, 51, 44, 37, 30, 23,
-    17, 9, 1, 58, 51, 44, 37, 30,
-    25, 17, 9, 1, 58, 51, 44, 37,
-    33, 25, 17, 9, 1, 58, 51, 44,
-    41, 33, 25, 17, 9, 1, 58, 51,
-    49, 41, 33, 25, 17, 9, 1, 58,
-    57, 49, 41, 33, 25, 17, 9, 1
-};
+extern SliderAttacks bb_RookAttacks[64];
+extern SliderAttacks bb_BishopAttacks[64];
+extern bool bb_UsePext;
 
-const unsigned int bb_ShiftL45[64] =
+inline unsigned int SliderAttacks::index(quint64 occupied) const
 {
-    9, 17, 25, 33, 41, 49, 57, 1,
-    17, 25, 33, 41, 49, 57, 1, 10,
-    25, 33, 41, 49, 57, 1, 10, 19,
-    33, 41, 49, 57, 1, 10, 19, 28,
-    41, 49, 57, 1, 10, 19, 28, 37,
-    49, 57, 1, 10, 19, 28, 37, 46,
-    57, 1, 10, 19, 28, 37, 46, 55,
-    1, 10, 19, 28, 37, 46, 55, 64
-};
+#ifdef BITBOARD_HAVE_PEXT
+    if(bb_UsePext)
+    {
+        return static_cast<unsigned int>(_pext_u64(occupied, mask));
+    }
+#endif
+    return static_cast<unsigned int>(((occupied & mask) * magic) >> shift);
+}
 
 inline bool BitBoard::isAttackedBy(const unsigned int color, chessx::Square square) const
 {
@@ -455,14 +470,14 @@ inline quint64 BitBoard::knightAttacksFrom(const chessx::Square s) const
 
 inline quint64 BitBoard::bishopAttacksFrom(const chessx::Square s) const
 {
-    return bb_R45Attacks[s][(m_occupied_r45 >> bb_ShiftR45[s]) & 63] |
-           bb_L45Attacks[s][(m_occupied_l45 >> bb_ShiftL45[s]) & 63];
+    const SliderAttacks& slider = bb_BishopAttacks[s];
+    return slider.attacks[slider.index(m_occupied)];
 }
 
 inline quint64 BitBoard::rookAttacksFrom(const chessx::Square s) const
 {
-    return bb_RankAttacks[s][(m_occupied >> ((s & ~7) + 1)) & 63] |
-           bb_FileAttacks[s][(m_occupied_l90 >> (((s & 7) << 3) + 1)) & 63];
+    const SliderAttacks& slider = bb_RookAttacks[s];
+    return slider.attacks[slider.index(m_occupied)];
 }
 
 inline quint64 BitBoard::queenAttacksFrom(const chessx::Square s) const
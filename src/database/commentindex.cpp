@@ -0,0 +1,315 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <algorithm>
+#include <tuple>
+
+#include <QRegularExpression>
+
+#include "commentindex.h"
+#include "gamex.h"
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+#define DEBUG_NEW new( _NORMAL_BLOCK, __FILE__, __LINE__ )
+#define new DEBUG_NEW
+#endif // _MSC_VER
+
+namespace {
+
+const quint32 CommentIndexMagic = 0x43494458;
+
+void writeNumber(QByteArray& data, quint32 value)
+{
+    while (value >= 0x80)
+    {
+        data.append(char((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    data.append(char(value));
+}
+
+quint32 readNumber(const uchar*& p, const uchar* end)
+{
+    quint32 value = 0;
+    int shift = 0;
+    while (p != end && shift < 32)
+    {
+        uchar byte = *p++;
+        value |= quint32(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+        {
+            break;
+        }
+        shift += 7;
+    }
+    return value;
+}
+
+} // namespace
+
+CommentIndex::CommentIndex() : m_gameCount(0)
+{
+}
+
+void CommentIndex::clear()
+{
+    m_words.clear();
+    m_gameCount = 0;
+}
+
+QStringList CommentIndex::words(const QString& text)
+{
+    QStringList list;
+    int start = -1;
+    for (int i = 0; i <= text.length(); ++i)
+    {
+        QChar c = (i < text.length()) ? text.at(i) : QChar();
+        if (c.isLetterOrNumber())
+        {
+            if (start < 0)
+            {
+                start = i;
+            }
+            continue;
+        }
+        if (start >= 0)
+        {
+            list.append(text.mid(start, i - start).toCaseFolded());
+            start = -1;
+        }
+        if (c == '[' && i + 1 < text.length() && text.at(i + 1) == '%')
+        {
+            // Skip embedded commands like clock times and arrows
+            int end = text.indexOf(']', i);
+            if (end < 0)
+            {
+                break;
+            }
+            i = end;
+        }
+    }
+    return list;
+}
+
+void CommentIndex::addGame(const GameX& game)
+{
+    QMap<quint32, QString> comments;
+    foreach (MoveId moveId, game.annotatedMoves(GameX::BeforeMove))
+    {
+        comments.insert(quint32(moveId) * 2, game.annotation(moveId, GameX::BeforeMove));
+    }
+    foreach (MoveId moveId, game.annotatedMoves(GameX::AfterMove))
+    {
+        comments.insert(quint32(moveId) * 2 + 1, game.annotation(moveId, GameX::AfterMove));
+    }
+
+    // Comments in ascending order keep each posting list sorted
+    for (auto it = comments.constBegin(); it != comments.constEnd(); ++it)
+    {
+        QStringList list = words(it.value());
+        for (int position = 0; position < list.count(); ++position)
+        {
+            addWord(list[position], m_gameCount, it.key(), quint32(position));
+        }
+    }
+    ++m_gameCount;
+}
+
+void CommentIndex::addWord(const QString& word, GameId game, quint32 comment, quint32 position)
+{
+    // Differences to the previous entry, which starts as (0, 0, 0)
+    PostingList& list = m_words[word];
+    quint32 gameDelta = game - list.lastGame;
+    quint32 commentValue = gameDelta ? comment : comment - list.lastComment;
+    quint32 positionValue = (gameDelta || commentValue) ? position : position - list.lastPosition;
+    writeNumber(list.data, gameDelta);
+    writeNumber(list.data, commentValue);
+    writeNumber(list.data, positionValue);
+    list.lastGame = game;
+    list.lastComment = comment;
+    list.lastPosition = position;
+}
+
+QVector<CommentIndex::Posting> CommentIndex::postings(const QString& word, bool prefix) const
+{
+    QVector<Posting> result;
+    auto it = prefix ? m_words.lowerBound(word) : m_words.find(word);
+    for (; it != m_words.constEnd(); ++it)
+    {
+        if (prefix && !it.key().startsWith(word))
+        {
+            break;
+        }
+        const QByteArray& data = it.value().data;
+        const uchar* p = reinterpret_cast<const uchar*>(data.constData());
+        const uchar* end = p + data.size();
+        Posting posting = { 0, 0, 0 };
+        while (p != end)
+        {
+            quint32 gameDelta = readNumber(p, end);
+            quint32 commentValue = readNumber(p, end);
+            quint32 positionValue = readNumber(p, end);
+            posting.game += gameDelta;
+            posting.comment = gameDelta ? commentValue : posting.comment + commentValue;
+            posting.position = (gameDelta || commentValue) ? positionValue : posting.position + positionValue;
+            result.append(posting);
+        }
+        if (!prefix)
+        {
+            break;
+        }
+    }
+    if (prefix)
+    {
+        // Merge the lists of the different words
+        std::sort(result.begin(), result.end(), [](const Posting& a, const Posting& b)
+        {
+            return std::tie(a.game, a.comment, a.position) < std::tie(b.game, b.comment, b.position);
+        });
+    }
+    return result;
+}
+
+QHash<GameId, quint32> CommentIndex::matches(const Term& term) const
+{
+    QHash<GameId, quint32> games;
+    if (term.words.isEmpty())
+    {
+        return games;
+    }
+    int last = term.words.count() - 1;
+    QVector<Posting> candidates = postings(term.words[0], term.prefix && !last);
+    for (int k = 1; k <= last && !candidates.isEmpty(); ++k)
+    {
+        // Keep the phrase starts followed by the next word
+        QVector<Posting> next = postings(term.words[k], term.prefix && k == last);
+        QVector<Posting> kept;
+        foreach (const Posting& posting, candidates)
+        {
+            Posting sought = { posting.game, posting.comment, posting.position + quint32(k) };
+            if (std::binary_search(next.constBegin(), next.constEnd(), sought, [](const Posting& a, const Posting& b)
+            {
+                return std::tie(a.game, a.comment, a.position) < std::tie(b.game, b.comment, b.position);
+            }))
+            {
+                kept.append(posting);
+            }
+        }
+        candidates = kept;
+    }
+    // Entries are sorted, the first one of a game has its first comment
+    foreach (const Posting& posting, candidates)
+    {
+        if (!games.contains(posting.game))
+        {
+            games.insert(posting.game, posting.comment);
+        }
+    }
+    return games;
+}
+
+QList<CommentIndex::Term> CommentIndex::parseQuery(const QString& query)
+{
+    QList<Term> terms;
+    QStringList parts = query.split('"');
+    for (int i = 0; i < parts.count(); ++i)
+    {
+        // Parts with an odd index are quoted
+        QStringList tokens;
+        if (i % 2)
+        {
+            tokens.append(parts[i].trimmed());
+        }
+        else
+        {
+            tokens = parts[i].split(QRegularExpression("\\s+"), Qt::SkipEmptyParts);
+        }
+        foreach (const QString& token, tokens)
+        {
+            Term term;
+            term.words = words(token);
+            term.prefix = token.endsWith('*');
+            if (!term.words.isEmpty())
+            {
+                terms.append(term);
+            }
+        }
+    }
+    return terms;
+}
+
+QVector<int> CommentIndex::find(const QString& query) const
+{
+    QVector<int> result(int(m_gameCount), 0);
+    QList<Term> terms = parseQuery(query);
+    if (terms.isEmpty())
+    {
+        return result;
+    }
+    QHash<GameId, quint32> games = matches(terms[0]);
+    for (int i = 1; i < terms.count() && !games.isEmpty(); ++i)
+    {
+        QHash<GameId, quint32> other = matches(terms[i]);
+        for (auto it = games.begin(); it != games.end();)
+        {
+            if (other.contains(it.key()))
+            {
+                ++it;
+            }
+            else
+            {
+                it = games.erase(it);
+            }
+        }
+    }
+    for (auto it = games.constBegin(); it != games.constEnd(); ++it)
+    {
+        if (it.key() < m_gameCount)
+        {
+            result[int(it.key())] = int(it.value() / 2) + 1;
+        }
+    }
+    return result;
+}
+
+bool CommentIndex::write(QDataStream& out) const
+{
+    out << CommentIndexMagic;
+    out << m_gameCount;
+    out << qint32(m_words.count());
+    for (auto it = m_words.constBegin(); it != m_words.constEnd(); ++it)
+    {
+        out << it.key() << it.value().data << it.value().lastGame << it.value().lastComment << it.value().lastPosition;
+    }
+    return out.status() == QDataStream::Ok;
+}
+
+bool CommentIndex::read(QDataStream& in)
+{
+    clear();
+    quint32 magic;
+    qint32 count;
+    in >> magic >> m_gameCount >> count;
+    if (magic != CommentIndexMagic || count < 0 || in.status() != QDataStream::Ok)
+    {
+        clear();
+        return false;
+    }
+    for (qint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i)
+    {
+        QString word;
+        PostingList list;
+        in >> word >> list.data >> list.lastGame >> list.lastComment >> list.lastPosition;
+        m_words.insert(word, list);
+    }
+    if (in.status() != QDataStream::Ok)
+    {
+        clear();
+        return false;
+    }
+    return true;
+}
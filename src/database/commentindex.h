@@ -0,0 +1,98 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef COMMENTINDEX_H
+#define COMMENTINDEX_H
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QHash>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "gameid.h"
+
+class GameX;
+
+/** @ingroup Database
+The CommentIndex class is an inverted index of the words in the comments of
+the games of a database.
+
+For each word it keeps a posting list of (game, comment, word position)
+entries in ascending order. Each entry is stored as the differences to the
+previous one in variable length integers, so the lists take a small fraction
+of the space of the comment text. Comments are numbered per game, 2 * moveId
+for the comment in front of a move and 2 * moveId + 1 for the one after it.
+
+Games are added in the order of their ids, an index can be extended with the
+games appended to a database. */
+class CommentIndex
+{
+public:
+    CommentIndex();
+
+    /** Remove all games */
+    void clear();
+    /** @return the number of games indexed */
+    GameId gameCount() const { return m_gameCount; }
+    /** Index the comments of @p game as game gameCount() */
+    void addGame(const GameX& game);
+
+    /** Find the games with comments matching @p query. All words of the query
+        must occur in a game, compared case insensitively. A word ending with '*'
+        matches every word starting with it, words in double quotes must follow
+        each other in one comment.
+        @return for each game the moveId + 1 of the first comment matching the
+        first word of the query, 0 for games which do not match */
+    QVector<int> find(const QString& query) const;
+
+    /** Write the index to @p out */
+    bool write(QDataStream& out) const;
+    /** Read an index written by write() */
+    bool read(QDataStream& in);
+
+    /** Split @p text into case folded words, leaving out commands like [%clk 0:10:00] */
+    static QStringList words(const QString& text);
+
+private:
+    struct Posting
+    {
+        GameId game;
+        quint32 comment;
+        quint32 position;
+    };
+
+    struct PostingList
+    {
+        PostingList() : lastGame(0), lastComment(0), lastPosition(0) {}
+        QByteArray data;
+        GameId lastGame;
+        quint32 lastComment;
+        quint32 lastPosition;
+    };
+
+    /** A word or a sequence of words of the query */
+    struct Term
+    {
+        QStringList words;
+        bool prefix; ///< the last word is a prefix
+    };
+
+    void addWord(const QString& word, GameId game, quint32 comment, quint32 position);
+    /** Decode the posting list of @p word, or the merged lists of all words starting with it */
+    QVector<Posting> postings(const QString& word, bool prefix) const;
+    /** @return the first comment matching @p term for each game */
+    QHash<GameId, quint32> matches(const Term& term) const;
+    static QList<Term> parseQuery(const QString& query);
+
+    QMap<QString, PostingList> m_words;
+    GameId m_gameCount;
+};
+
+#endif // COMMENTINDEX_H
@@ -0,0 +1,40 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "commentsearch.h"
+#include "database.h"
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+#define DEBUG_NEW new( _NORMAL_BLOCK, __FILE__, __LINE__ )
+#define new DEBUG_NEW
+#endif // _MSC_VER
+
+CommentSearch::CommentSearch(Database* database, const QString& query) :
+    Search(database),
+    m_query(query)
+{
+}
+
+QString CommentSearch::query() const
+{
+    return m_query;
+}
+
+void CommentSearch::Prepare(volatile bool& breakFlag)
+{
+    m_matches.clear();
+    if(m_database)
+    {
+        RefKeeper m(m_database->refCounter());
+        m_matches = m_database->findInComments(m_query, breakFlag);
+    }
+}
+
+int CommentSearch::matches(GameId index) const
+{
+    return ((int)index < m_matches.count()) ? m_matches.at(index) : 0;
+}
@@ -0,0 +1,38 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef COMMENTSEARCH_H
+#define COMMENTSEARCH_H
+
+#include "search.h"
+
+#include <QVector>
+
+/** @ingroup Search
+The CommentSearch class finds games by the words of their comments.
+It is answered from the comment index of the database, which is built
+or extended when the search is prepared. */
+class CommentSearch : public Search
+{
+    Q_OBJECT
+
+public:
+    /** Search for @p query, see CommentIndex::find() for its syntax */
+    CommentSearch(Database* database, const QString& query);
+    /** @return the words sought */
+    QString query() const;
+
+    virtual void Prepare(volatile bool& breakFlag);
+    /** Return the moveId + 1 of the first matching comment, 0 if there is none */
+    virtual int matches(GameId index) const;
+
+private:
+    QString m_query;
+    QVector<int> m_matches;
+};
+
+#endif // COMMENTSEARCH_H
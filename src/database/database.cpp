@@ -21,7 +21,7 @@ using namespace chessx;
 #define new DEBUG_NEW
 #endif // _MSC_VER
 
-Database::Database() : m_break(false), m_utf8(false)
+Database::Database() : m_break(false), m_utf8(false), m_commentIndexLoaded(false)
 {
     connect(&m_index, SIGNAL(progress(int)), this, SIGNAL(progress(int)));
 }
@@ -110,9 +110,20 @@ void Database::findPosition(const BoardX& position, PositionSearchOptions option
 {
     for (auto gameId: games)
     {
+        // skip games whose signature rules out the position
+        if (!m_index.canContainPosition(gameId, position))
+        {
+            output.append(NO_MOVE);
+            continue;
+        }
+
         // search for position
         GameX g;
         loadGameMoves(gameId, g);
+        if (!m_index.hasSignature(gameId))
+        {
+            m_index.setSignature(gameId, GameSignature(g));
+        }
         const auto& cursor = g.cursor();
         auto moveId = cursor.findPosition(position);
         if ((options & PositionSearch_GameEnd) && !cursor.atGameEnd(moveId))
@@ -202,6 +213,45 @@ bool Database::remove(GameId)
 
 void Database::clear()
 {
+    clearCommentIndex();
+}
+
+QVector<int> Database::findInComments(const QString& query, volatile bool& breakFlag)
+{
+    QMutexLocker m(&m_commentIndexMutex);
+    if(!m_commentIndexLoaded)
+    {
+        m_commentIndexLoaded = true;
+        if(isModified() || !readCommentIndex(m_commentIndex) || m_commentIndex.gameCount() > count())
+        {
+            m_commentIndex.clear();
+        }
+    }
+
+    GameId indexed = m_commentIndex.gameCount();
+    GameId total = static_cast<GameId>(count());
+    for(GameId i = indexed; i < total; ++i)
+    {
+        if(breakFlag)
+        {
+            return QVector<int>();
+        }
+        GameX game; // Deleted games are indexed without comments
+        loadGame(i, game);
+        m_commentIndex.addGame(game);
+    }
+    if(total > indexed && !isModified())
+    {
+        writeCommentIndex(m_commentIndex);
+    }
+    return m_commentIndex.find(query);
+}
+
+void Database::clearCommentIndex()
+{
+    QMutexLocker m(&m_commentIndexMutex);
+    m_commentIndex.clear();
+    m_commentIndexLoaded = true;
 }
 
 void Database::setTagsToIndex(const GameX& game, GameId id)
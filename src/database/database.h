@@ -11,6 +11,7 @@
 #ifndef DATABASE_H_INCLUDED
 #define DATABASE_H_INCLUDED
 
+#include "commentindex.h"
 #include "filter.h"
 #include "gamex.h"
 #include "index.h"
@@ -112,6 +113,8 @@ public:
     virtual bool isModified() const;
     /** Set / Reset the modification flag. */
     virtual void setModified(bool) { }
+    /** Record that game @p gameId was changed in the index, e.g. by editing its tags */
+    virtual void setGameChanged(GameId) { }
     virtual void startTransaction(bool) { }
     /** Get the Valid Flag for a given game id from the index */
     virtual bool getValidFlag(GameId gameId) const;
@@ -121,9 +124,19 @@ public:
     virtual bool IsClipboard() const { return false; }
     /** Get a map of MoveData from a given board position */
     virtual unsigned int getMoveMapForBoard(const BoardX& , QMap<Move, MoveData> &) { return 0; }
+    /** Find the games with comments matching @p query, see CommentIndex::find().
+        Games not in the comment index yet are indexed first.
+        @return an empty vector if @p breakFlag interrupted the search */
+    QVector<int> findInComments(const QString& query, volatile bool& breakFlag);
 protected:
     /** Copies all tags from @p game to the Index */
     void setTagsToIndex(const GameX& game, GameId id);
+    /** Load a stored comment index, @return false if there is none for the current games */
+    virtual bool readCommentIndex(CommentIndex&) { return false; }
+    /** Store @p commentIndex for the next time the database is opened */
+    virtual void writeCommentIndex(const CommentIndex&) const { }
+    /** Forget the indexed comments, e.g. after games were replaced */
+    void clearCommentIndex();
 
 signals:
     /** Signal emitted when some progress is done. */
@@ -134,6 +147,11 @@ protected:
     IndexX m_index;
     bool m_utf8;
     QMutex m_mutex;
+
+private:
+    CommentIndex m_commentIndex;
+    bool m_commentIndexLoaded;
+    QMutex m_commentIndexMutex;
 };
 
 class DatabaseTransaction
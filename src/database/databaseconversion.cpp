@@ -28,6 +28,9 @@ bool DatabaseConversion::playerDatabaseFromScidRatings(const QString& inFileName
     QDir dir = QDir(pictureDir);
     QStringList pictures = dir.entryList();
 
+    // The players are collected in an updatable database, which is then
+    // written in the read-only mapped format
+    const QString buildFileName = outFileName + ".tmp";
     if(pdb.removeDatabase(outFileName))
     {
 //		std::cout << "removed " << (char*)outFileName.toLatin1().constData() << "\n";
@@ -36,13 +39,14 @@ bool DatabaseConversion::playerDatabaseFromScidRatings(const QString& inFileName
     {
         std::cout << "failure removing " << outFileName.toLatin1().constData() << "\n";
     }
-    if(pdb.create(outFileName))
+    pdb.removeDatabase(buildFileName);
+    if(pdb.create(buildFileName))
     {
-//		std::cout << "created " << outFileName.toLatin1().constData() << "\n";
+//		std::cout << "created " << buildFileName.toLatin1().constData() << "\n";
     }
     else
     {
-        std::cout << "failure creating " << outFileName.toLatin1().constData() << "\n";
+        std::cout << "failure creating " << buildFileName.toLatin1().constData() << "\n";
         return false;
     }
 
@@ -231,8 +235,14 @@ bool DatabaseConversion::playerDatabaseFromScidRatings(const QString& inFileName
 //	}
 
     pdb.commit();
+    bool saved = pdb.saveMapped(outFileName);
+    if(!saved)
+    {
+        std::cout << "failure writing " << outFileName.toLatin1().constData() << "\n";
+    }
     pdb.close();
+    pdb.removeDatabase(buildFileName);
 
-    return true;
+    return saved;
 
 }
@@ -23,7 +23,7 @@ class DatabaseConversion
 
 public:
     /**
-    convert Scid ratings.ssp to player database
+    convert Scid ratings.ssp to a player database in the mapped format
     outFileName is filename without extension
     inFileName is full path for ratings.ssp
     pictureDir is directory where player pictures are -
@@ -10,6 +10,7 @@
 #include <QFile>
 #include <QUndoStack>
 
+#include "archivedatabase.h"
 #include "arenabook.h"
 #include "ctgdatabase.h"
 #include "databaseinfo.h"
@@ -79,6 +80,10 @@ DatabaseInfo::DatabaseInfo(QUndoGroup* undoGroup, const QString& fname): m_filte
     {
         m_database = new CtgDatabase;
     }
+    else if (ArchiveDatabase::canOpen(fname))
+    {
+        m_database = new ArchiveDatabase;
+    }
     else if(file.size()/(1024 * 1024) < AppSettings->getValue("/General/EditLimit").toInt())
     {
         m_database = new MemoryDatabase;
@@ -222,12 +227,15 @@ void DatabaseInfo::setGameModified(bool modified, const GameX& g, QString action
     if (modified)
     {
         Q_ASSERT(!action.isEmpty());
-        m_undoStack->push(new GameUndoCommand(this, g, m_game, action));
+        // Changes made without a record since the last command are folded into this one
+        m_undoBase.dbMoveToId(g.currentMove());
+        m_undoStack->push(new GameUndoCommand(this, m_undoBase, m_game, action));
     }
     else
     {
         m_undoStack->clear();
     }
+    m_undoBase = m_game;
     updateMaterial();
 }
 
@@ -248,6 +256,7 @@ const QList<double>& DatabaseInfo::evaluations() const
 
 void DatabaseInfo::restoreState(const GameX& game)
 {
+    m_undoBase = game;
     emit signalRestoreState(game);
 }
 
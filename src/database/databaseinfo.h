@@ -116,6 +116,11 @@ public:
     bool gameNeedsSaving() const;
 
     void restoreState(const GameX& game);
+    /** @return the game as recorded at the current index of the undo history */
+    const GameX& undoBase() const
+    {
+        return m_undoBase;
+    }
 
     QUndoStack *undoStack() const;
 
@@ -155,6 +160,8 @@ private:
     Database* m_database;
     QPointer<FilterX> m_filter;
     GameX m_game;
+    /** The game as last recorded by the undo history, commands keep differences against it */
+    GameX m_undoBase;
     QString m_filename;
     GameId m_index;
     CircularBuffer<GameId> m_lastGames;
@@ -3,10 +3,8 @@
 ****************************************************************************/
 
 #include "datesearch.h"
-#include "gamex.h"
 #include "database.h"
-
-using namespace chessx;
+#include "tags.h"
 
 #if defined(_MSC_VER) && defined(_DEBUG)
 #define DEBUG_NEW new( _NORMAL_BLOCK, __FILE__, __LINE__ )
@@ -28,6 +26,27 @@ DateSearch::DateSearch(const PartialDate& minDate, const PartialDate& maxDate)
     m_maxDate = maxDate;
 }
 
+DateSearch::DateSearch(Database* database, const PartialDate& minDate, const PartialDate& maxDate) : Search(database)
+{
+    setDateRange(minDate, maxDate);
+}
+
+void DateSearch::Prepare(volatile bool&)
+{
+    m_matches.clear();
+    if (m_database)
+    {
+        // Few games have a date of their own, each distinct date is parsed only once
+        PartialDate minDate = m_minDate;
+        PartialDate maxDate = m_maxDate;
+        m_matches = m_database->index()->listMatching(TagNameDate, [minDate, maxDate](const QString& value)
+        {
+            PartialDate date(value);
+            return (date >= minDate && date <= maxDate);
+        });
+    }
+}
+
 PartialDate DateSearch::minDate() const
 {
     return m_minDate;
@@ -40,17 +59,13 @@ PartialDate DateSearch::maxDate() const
 
 void DateSearch::setDateRange(const PartialDate& minDate, const PartialDate& maxDate)
 {
-    Q_ASSERT(minDate < maxDate);
+    Q_ASSERT(minDate <= maxDate);
     m_minDate = minDate;
     m_maxDate = maxDate;
 }
 
 int DateSearch::matches(GameId index) const
 {
-    GameX g;
-    m_database->loadGameHeaders(index, g);
-    PartialDate date(g.tag("Date"));
-
-    return (date >= m_minDate && date <= m_maxDate);
+    return ((int)index < m_matches.size()) && m_matches.at(index);
 }
 
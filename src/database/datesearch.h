@@ -19,12 +19,16 @@ public:
     DateSearch();
     /** Constructor for searching games in given time period. */
     DateSearch(const PartialDate &minDate, const PartialDate &maxDate);
+    /** Constructor for searching games of @p database in given time period. */
+    DateSearch(Database* database, const PartialDate &minDate, const PartialDate &maxDate);
     /** @return beginning of the acceptable period. */
     PartialDate minDate() const;
     /** @return end of the acceptable period. */
     PartialDate maxDate() const;
     /** Sets whole period. */
     void setDateRange(const PartialDate &minDate, const PartialDate &maxDate);
+    /** Find the matching games from the distinct values of the Date tag */
+    virtual void Prepare(volatile bool& breakFlag);
     /** Return true if the game at index matches the search */
     virtual int matches(GameId index) const;
 
@@ -2,15 +2,54 @@
 *   Copyright (C) 2016 by Jens Nissen jens-chessx@gmx.net                   *
 ****************************************************************************/
 
+#include <algorithm>
+#include <tuple>
+
+#include <QFutureSynchronizer>
+#include <QtConcurrent/QtConcurrent>
+
 #include "database.h"
 #include "duplicatesearch.h"
+#include "fingerprint.h"
 #include "index.h"
+#include "tags.h"
 
 #if defined(_MSC_VER) && defined(_DEBUG)
 #define DEBUG_NEW new( _NORMAL_BLOCK, __FILE__, __LINE__ )
 #define new DEBUG_NEW
 #endif // _MSC_VER
 
+namespace {
+
+/** Plies of the main line hashed into the blocking key of DS_Similar */
+const int SimilarBlockPlies = 10;
+/** Plies of the main line kept for comparing games */
+const int SimilarComparePlies = 60;
+/** Share of the shorter main line which must agree */
+const double SimilarMinMoves = 0.9;
+/** Mean similarity of the player names required */
+const double SimilarMinNames = 0.7;
+
+/** @return true if a game of @p longer plies may be a copy of one of @p shorter plies */
+bool isPlyCountClose(int shorter, int longer)
+{
+    return longer - shorter <= 10 + longer / 4;
+}
+
+/** @return the sorted letter pairs of @p text */
+QVector<quint32> letterPairs(const QString& text)
+{
+    QVector<quint32> pairs;
+    for (int i = 1; i < text.length(); ++i)
+    {
+        pairs.append((quint32(text.at(i - 1).unicode()) << 16) | text.at(i).unicode());
+    }
+    std::sort(pairs.begin(), pairs.end());
+    return pairs;
+}
+
+} // namespace
+
 /* DuplicateSearch class
  * **********************/
 DuplicateSearch::DuplicateSearch(Database *db, DSMode mode):Search(db),m_filter(nullptr)
@@ -24,118 +63,559 @@ DuplicateSearch::DuplicateSearch(FilterX *filter, DSMode mode):Search(filter ? f
    m_filter = filter;
 }
 
-void DuplicateSearch::PrepareFilter(volatile bool &breakFlag)
+void DuplicateSearch::fingerprintChunk(GameId start, GameId end, quint64* fingerprints, volatile bool* breakFlag)
+{
+    const IndexX* index = m_database->index();
+    GameX game;
+    for (GameId i = start; i < end; ++i)
+    {
+        if (*breakFlag)
+        {
+            return;
+        }
+        if (index->deleted(i))
+        {
+            continue;
+        }
+        m_database->loadGameMoves(i, game);
+        fingerprints[i] = game.fingerprint();
+    }
+    qint64 done = m_fingerprinted.fetchAndAddRelaxed(end - start) + (end - start);
+    emit prepareUpdate(static_cast<int>(done * 100 / m_matches.count()));
+}
+
+void DuplicateSearch::Prepare(volatile bool &breakFlag)
 {
+    if (!m_database)
+    {
+        return;
+    }
     const IndexX* index = m_database->index();
-    for (GameId i = 0; (int)i<index->count(); ++i)
+    int n = index->count();
+    m_matches = QBitArray(n, false);
+
+    if (m_mode == DS_Similar)
+    {
+        prepareSimilar(breakFlag);
+        return;
+    }
+
+    bool byTags = (m_mode == DS_Tags) || (m_mode == DS_Tags_BestGame) || (m_mode == DS_Both) || (m_mode == DS_Both_All);
+    bool byGame = (m_mode == DS_Both) || (m_mode == DS_Both_All) || (m_mode == DS_Game) || (m_mode == DS_Game_All);
+
+    RefKeeper m(m_database->refCounter());
+
+    // Fingerprint stage, each game is loaded once
+    QVector<quint64> games;
+    if (byGame)
+    {
+        games.fill(0, n);
+        m_fingerprinted = 0;
+        int chunk = qMax(64, n / (8 * QThread::idealThreadCount()));
+        QFutureSynchronizer<void> synchronizer;
+        for (int start = 0; start < n; start += chunk)
+        {
+            int end = std::min(start + chunk, n);
+#if QT_VERSION < 0x060000
+            QFuture<void> future = QtConcurrent::run(this, &DuplicateSearch::fingerprintChunk, (GameId)start, (GameId)end, games.data(), &breakFlag);
+#else
+            QFuture<void> future = QtConcurrent::run(&DuplicateSearch::fingerprintChunk, this, (GameId)start, (GameId)end, games.data(), &breakFlag);
+#endif
+            synchronizer.addFuture(future);
+        }
+        synchronizer.waitForFinished();
+    }
+
+    QVector<Candidate> candidates;
+    candidates.reserve(n);
+    for (GameId i = 0; (int)i < n && !breakFlag; ++i)
     {
-        if (!m_filter->contains(i)) continue;
         if (index->deleted(i)) continue; // Do not analyse deleted games
-        if (breakFlag) break;
-        unsigned int hashval = index->hashIndexItem(i);
-        bool found = false;
-        if (m_hashToGames.contains(hashval))
+
+        Candidate candidate;
+        // Identical games are only looked for among the games of the same white player
+        candidate.key = byTags ? index->fingerprintIndexItem(i) : fingerprintMix(FingerprintSeed, index->hashIndexItem(i));
+        if (byGame)
         {
-            for (auto iter = m_hashToGames.find(hashval); iter != m_hashToGames.end() && iter.key() == hashval; ++iter)
+            candidate.key = fingerprintMix(candidate.key, games[i]);
+        }
+        candidate.id = i;
+        candidates.append(candidate);
+    }
+    std::sort(candidates.begin(), candidates.end());
+
+    // Equal games follow each other now
+    for (int first = 0; first < candidates.count() && !breakFlag;)
+    {
+        int last = first + 1;
+        while (last < candidates.count() && candidates[last].key == candidates[first].key)
+        {
+            ++last;
+        }
+        if (last - first > 1)
+        {
+            // Equal fingerprints are confirmed by comparing the tags and the games themselves
+            QVector<QVector<GameId> > groups;
+            QList<GameX> representatives;
+            for (int k = first; k < last; ++k)
             {
-                GameId j = iter.value();
-                if (index->isIndexItemEqual(i,j))
+                GameId id = candidates[k].id;
+                GameX game;
+                if (byGame)
                 {
-                    GameX gI, gJ;
-                    m_database->loadGame(i, gI);
-                    m_database->loadGame(j, gJ);
-                    found = gI.isEqual(gJ);
+                    m_database->loadGameMoves(id, game);
+                }
+                int g = 0;
+                while (g < groups.count() &&
+                       ((byTags && !index->isIndexItemEqual(groups[g].first(), id)) ||
+                        (byGame && !representatives[g].isEqual(game))))
+                {
+                    ++g;
+                }
+                if (g < groups.count())
+                {
+                    groups[g].append(id);
+                }
+                else
+                {
+                    groups.append(QVector<GameId>() << id);
+                    representatives.append(game);
                 }
             }
+            foreach (const QVector<GameId>& group, groups)
+            {
+                if (group.count() > 1)
+                {
+                    markGroup(group);
+                }
+            }
+        }
+        first = last;
+    }
+}
+
+void DuplicateSearch::markGroup(const QVector<GameId>& group)
+{
+    if (m_filter)
+    {
+        bool inFilter = false;
+        foreach (GameId id, group)
+        {
+            inFilter = inFilter || m_filter->contains(id);
+        }
+        if (!inFilter)
+        {
+            return;
+        }
+    }
+
+    if (m_mode == DS_Tags_BestGame)
+    {
+        markWorseGames(group);
+        return;
+    }
+    if (m_mode == DS_Similar)
+    {
+        markAllButBest(group);
+        return;
+    }
+
+    // The first game stays unmarked, unless all copies are asked for
+    bool all = (m_mode == DS_Both_All) || (m_mode == DS_Game_All);
+    for (int i = all ? 0 : 1; i < group.count(); ++i)
+    {
+        m_matches.setBit(group[i]);
+    }
+}
+
+void DuplicateSearch::markWorseGames(const QVector<GameId>& group)
+{
+    // Games not worse than any other game seen so far, incomparable games are kept side by side
+    QList<QPair<GameId, GameX> > best;
+    foreach (GameId i, group)
+    {
+        GameX game;
+        m_database->loadGameMoves(i, game);
+        bool found = false;
+        for (auto it = best.begin(); it != best.end(); ++it)
+        {
+            if (it->second.isBetterOrEqual(game))
+            {
+                m_matches.setBit(i);
+                found = true;
+                break;
+            }
+            if (game.isBetterOrEqual(it->second))
+            {
+                m_matches.setBit(it->first);
+                *it = qMakePair(i, game);
+                found = true;
+                break;
+            }
         }
         if (!found)
         {
-            m_hashToGames.insert(hashval, i);
+            best.append(qMakePair(i, game));
         }
     }
 }
 
-void DuplicateSearch::Prepare(volatile bool &breakFlag)
+void DuplicateSearch::markAllButBest(const QVector<GameId>& group)
 {
-    if (m_database)
+    // Of equally good games the first one is kept
+    GameId best = group.first();
+    GameX bestGame;
+    m_database->loadGameMoves(best, bestGame);
+    for (int i = 1; i < group.count(); ++i)
     {
-        const IndexX* index = m_database->index();
-        m_matches = QBitArray(index->count(), false);
-        if (m_filter)
+        GameX game;
+        m_database->loadGameMoves(group[i], game);
+        if (game.isBetterOrEqual(bestGame) && !bestGame.isBetterOrEqual(game))
         {
-            PrepareFilter(breakFlag);
+            m_matches.setBit(best);
+            best = group[i];
+            bestGame = game;
         }
+        else
+        {
+            m_matches.setBit(group[i]);
+        }
+    }
+}
 
-        for (GameId i = 0; (int)i<index->count(); ++i)
+QString DuplicateSearch::normalizedName(const QString& name)
+{
+    QString decomposed = name.normalized(QString::NormalizationForm_KD);
+    QString result;
+    bool separator = false;
+    foreach (QChar c, decomposed)
+    {
+        if (c.isLetterOrNumber())
+        {
+            if (separator && !result.isEmpty())
+            {
+                result += ' ';
+            }
+            result += c.toCaseFolded();
+            separator = false;
+        }
+        else if (!c.isMark())
         {
-            if (i % 1024 == 0) emit prepareUpdate(i*100/index->count());
+            separator = true;
+        }
+    }
+    return result;
+}
 
-            if (index->deleted(i)) continue; // Do not analyse deleted games
+double DuplicateSearch::nameSimilarity(const QString& name1, const QString& name2)
+{
+    QStringList words1 = normalizedName(name1).split(' ', Qt::SkipEmptyParts);
+    QStringList words2 = normalizedName(name2).split(' ', Qt::SkipEmptyParts);
+    if (words1.isEmpty() || words2.isEmpty())
+    {
+        return (words1.isEmpty() && words2.isEmpty()) ? 1.0 : 0.0;
+    }
+    if (words1 == words2)
+    {
+        return 1.0;
+    }
 
-            if (breakFlag) break;
-            unsigned int hashval = index->hashIndexItem(i);
-            if (m_hashToGames.contains(hashval))
+    // Abbreviated given names, like "Carlsen, M." for "Carlsen, Magnus"
+    if (words1.first() == words2.first())
+    {
+        bool abbreviated = true;
+        for (int i = 1; i < qMin(words1.count(), words2.count()); ++i)
+        {
+            abbreviated = abbreviated && (words1[i].startsWith(words2[i]) || words2[i].startsWith(words1[i]));
+        }
+        if (abbreviated)
+        {
+            return 0.9;
+        }
+    }
+
+    // Spelling variants and swapped names, the Dice coefficient of the letter pairs
+    words1.sort();
+    words2.sort();
+    QVector<quint32> pairs1 = letterPairs(words1.join(QString()));
+    QVector<quint32> pairs2 = letterPairs(words2.join(QString()));
+    if (pairs1.isEmpty() || pairs2.isEmpty())
+    {
+        return 0.0;
+    }
+    int common = 0;
+    for (int i = 0, j = 0; i < pairs1.count() && j < pairs2.count();)
+    {
+        if (pairs1[i] < pairs2[j])
+        {
+            ++i;
+        }
+        else if (pairs2[j] < pairs1[i])
+        {
+            ++j;
+        }
+        else
+        {
+            ++common;
+            ++i;
+            ++j;
+        }
+    }
+    return 2.0 * common / (pairs1.count() + pairs2.count());
+}
+
+void DuplicateSearch::similarChunk(GameId start, GameId end, volatile bool* breakFlag)
+{
+    const IndexX* index = m_database->index();
+    GameX game;
+    for (GameId i = start; i < end; ++i)
+    {
+        if (*breakFlag)
+        {
+            return;
+        }
+        if (index->deleted(i))
+        {
+            continue;
+        }
+        m_database->loadGameMoves(i, game);
+
+        SimilarGame& similar = m_similarGames[i];
+        similar.tagKey = fingerprintMix(FingerprintSeed, index->valueIndexFromTag(TagNameDate, i));
+        similar.tagKey = fingerprintMix(similar.tagKey, index->valueIndexFromTag(TagNameResult, i));
+        similar.key = similar.tagKey;
+        similar.plies = 0;
+        const GameCursor& cursor = game.cursor();
+        for (MoveId node = cursor.nextMove(ROOT_NODE); node != NO_MOVE; node = cursor.nextMove(node))
+        {
+            Move move = cursor.move(node);
+            if (similar.plies < SimilarBlockPlies)
             {
-                bool found = false;
-                for (auto iter = m_hashToGames.find(hashval); iter != m_hashToGames.end() && iter.key() == hashval; ++iter)
-                {
-                    GameId j = iter.value();
-                    if ((m_mode == DS_Game) || (m_mode == DS_Game_All) || index->isIndexItemEqual(i,j))
-                    {
-                        if ((m_mode == DS_Both) || (m_mode == DS_Both_All) || (m_mode == DS_Game) || (m_mode == DS_Game_All))
-                        {
-                            GameX gI, gJ;
-                            m_database->loadGame(i, gI);
-                            m_database->loadGame(j, gJ);
-                            found = gI.isEqual(gJ);
-                            if (((m_mode == DS_Both_All) || (m_mode == DS_Game_All)) && found)
-                            {
-                               m_matches[j] = 1;
-                            }
-                        }
-                        else if (m_mode == DS_Tags_BestGame)
-                        {
-                            GameX gI, gJ;
-                            m_database->loadGame(i, gI);
-                            m_database->loadGame(j, gJ);
-                            if (gJ.isBetterOrEqual(gI))
-                            {
-                                found = true;
-                            }
-                            else if (gI.isBetterOrEqual(gJ))
-                            {
-                                m_matches[j] = 1;
-                                m_hashToGames.remove(hashval, i);
-                                m_hashToGames.insert(hashval, j);
-                                found = true;
-                                break;
-                            }
-                        }
-                        else if (m_mode == DS_Tags)//
-                        {
-                            found = true;
-                        }
-                        if (found)
-                        {
-                            m_matches[i] = 1;
-                            break;
-                        }
-                    }
-                }
+                similar.key = fingerprintMix(similar.key, move.rawMove());
+            }
+            if (similar.plies < SimilarComparePlies)
+            {
+                similar.moves.append(quint16(move.from() | (move.to() << 6) | (move.promoted() << 12)));
+            }
+            ++similar.plies;
+        }
+    }
+    qint64 done = m_fingerprinted.fetchAndAddRelaxed(end - start) + (end - start);
+    emit prepareUpdate(static_cast<int>(done * 100 / m_matches.count()));
+}
+
+bool DuplicateSearch::isSimilar(GameId id1, GameId id2) const
+{
+    const SimilarGame& game1 = m_similarGames.at(id1);
+    const SimilarGame& game2 = m_similarGames.at(id2);
+
+    int shorter = qMin(game1.plies, game2.plies);
+    int compared = qMin(game1.moves.count(), game2.moves.count());
+    int agreed = 0;
+    while (agreed < compared && game1.moves.at(agreed) == game2.moves.at(agreed))
+    {
+        ++agreed;
+    }
+    if (agreed == compared)
+    {
+        // The main lines agree as far as they are kept
+        agreed = shorter;
+    }
+    if (shorter && agreed < SimilarMinMoves * shorter)
+    {
+        return false;
+    }
 
-                if (!found)
+    const IndexX* index = m_database->index();
+    double white = nameSimilarity(index->tagValue(TagNameWhite, id1), index->tagValue(TagNameWhite, id2));
+    double black = nameSimilarity(index->tagValue(TagNameBlack, id1), index->tagValue(TagNameBlack, id2));
+    return (white + black) / 2 >= SimilarMinNames;
+}
+
+void DuplicateSearch::compareChunk(int first, int last, const QVector<Candidate>* candidates, QVector<QVector<GameId> >* groups, volatile bool* breakFlag)
+{
+    for (int start = first; start < last && !*breakFlag;)
+    {
+        int end = start + 1;
+        while (end < last && candidates->at(end).key == candidates->at(start).key)
+        {
+            ++end;
+        }
+
+        // The block is sorted by length, each game joins the group of the first game it is similar to
+        QVector<int> group(end - start, -1);
+        for (int i = start; i < end; ++i)
+        {
+            GameId id = candidates->at(i).id;
+            int plies = m_similarGames.at(id).plies;
+            for (int j = i - 1; j >= start && isPlyCountClose(m_similarGames.at(candidates->at(j).id).plies, plies); --j)
+            {
+                if (isSimilar(candidates->at(j).id, id))
                 {
-                    m_hashToGames.insert(hashval, i);
+                    group[i - start] = (group[j - start] < 0) ? j - start : group[j - start];
+                    break;
                 }
             }
-            else
+        }
+        QMap<int, QVector<GameId> > members;
+        for (int k = 0; k < group.count(); ++k)
+        {
+            if (group[k] >= 0)
             {
-                if (!m_filter)
-                {
-                    m_hashToGames.insert(hashval, i);
-                }
+                members[group[k]].append(candidates->at(start + k).id);
             }
         }
+        for (auto it = members.begin(); it != members.end(); ++it)
+        {
+            it.value().append(candidates->at(start + it.key()).id);
+            std::sort(it.value().begin(), it.value().end());
+            groups->append(it.value());
+        }
+        start = end;
+    }
+}
+
+void DuplicateSearch::prepareSimilar(volatile bool& breakFlag)
+{
+    const IndexX* index = m_database->index();
+    int n = index->count();
+    RefKeeper m(m_database->refCounter());
+
+    // Blocking stage, each game is loaded once
+    m_similarGames = QVector<SimilarGame>(n);
+    m_fingerprinted = 0;
+    int chunk = qMax(64, n / (8 * QThread::idealThreadCount()));
+    {
+        QFutureSynchronizer<void> synchronizer;
+        for (int start = 0; start < n; start += chunk)
+        {
+            int end = std::min(start + chunk, n);
+#if QT_VERSION < 0x060000
+            QFuture<void> future = QtConcurrent::run(this, &DuplicateSearch::similarChunk, (GameId)start, (GameId)end, &breakFlag);
+#else
+            QFuture<void> future = QtConcurrent::run(&DuplicateSearch::similarChunk, this, (GameId)start, (GameId)end, &breakFlag);
+#endif
+            synchronizer.addFuture(future);
+        }
+        synchronizer.waitForFinished();
+    }
+
+    // Games shorter than the opening moves of the key are missed by the blocks,
+    // they are compared with the games they may be truncated copies of
+    int shortBound = SimilarBlockPlies - 1;
+    while (isPlyCountClose(SimilarBlockPlies - 1, shortBound + 1))
+    {
+        ++shortBound;
+    }
+    QSet<quint64> shortBlocks;
+    QVector<Candidate> candidates;
+    for (GameId i = 0; (int)i < n && !breakFlag; ++i)
+    {
+        const SimilarGame& similar = m_similarGames.at(i);
+        if (similar.plies >= 0)
+        {
+            Candidate candidate;
+            candidate.key = similar.key;
+            candidate.id = i;
+            candidates.append(candidate);
+            if (similar.plies < SimilarBlockPlies)
+            {
+                shortBlocks.insert(similar.tagKey);
+            }
+        }
+    }
+    QVector<Candidate> shortCandidates;
+    for (GameId i = 0; (int)i < n && !breakFlag && !shortBlocks.isEmpty(); ++i)
+    {
+        const SimilarGame& similar = m_similarGames.at(i);
+        if (similar.plies >= 0 && similar.plies <= shortBound && shortBlocks.contains(similar.tagKey))
+        {
+            Candidate candidate;
+            candidate.key = similar.tagKey;
+            candidate.id = i;
+            shortCandidates.append(candidate);
+        }
+    }
+
+    QVector<QVector<GameId> > groups;
+    compareBlocks(candidates, chunk, groups, breakFlag);
+    compareBlocks(shortCandidates, chunk, groups, breakFlag);
+    m_similarGames.clear();
+
+    // A game may be in a group of each pass, overlapping groups are merged
+    QHash<GameId, GameId> parents;
+    auto root = [&parents](GameId id)
+    {
+        while (parents.value(id, id) != id)
+        {
+            id = parents.value(id);
+        }
+        return id;
+    };
+    foreach (const QVector<GameId>& group, groups)
+    {
+        GameId first = root(group.first());
+        parents.insert(first, first);
+        foreach (GameId id, group)
+        {
+            GameId other = root(id);
+            if (other != first)
+            {
+                parents.insert(other, first);
+            }
+        }
+    }
+    QMap<GameId, QVector<GameId> > merged;
+    for (auto it = parents.constBegin(); it != parents.constEnd(); ++it)
+    {
+        merged[root(it.key())].append(it.key());
+    }
+    for (auto it = merged.begin(); it != merged.end() && !breakFlag; ++it)
+    {
+        std::sort(it.value().begin(), it.value().end());
+        markGroup(it.value());
+    }
+}
+
+void DuplicateSearch::compareBlocks(QVector<Candidate>& candidates, int chunk, QVector<QVector<GameId> >& groups, volatile bool& breakFlag)
+{
+    std::sort(candidates.begin(), candidates.end(), [this](const Candidate& a, const Candidate& b)
+    {
+        int pliesA = m_similarGames.at(a.id).plies;
+        int pliesB = m_similarGames.at(b.id).plies;
+        return std::tie(a.key, pliesA, a.id) < std::tie(b.key, pliesB, b.id);
+    });
+
+    // Chunks end at block boundaries
+    QList<QVector<QVector<GameId> > > chunkGroups;
+    QList<QPair<int, int> > ranges;
+    for (int first = 0; first < candidates.count();)
+    {
+        int last = qMin(first + chunk, candidates.count());
+        while (last < candidates.count() && candidates.at(last).key == candidates.at(last - 1).key)
+        {
+            ++last;
+        }
+        ranges.append(qMakePair(first, last));
+        chunkGroups.append(QVector<QVector<GameId> >());
+        first = last;
+    }
+    {
+        QFutureSynchronizer<void> synchronizer;
+        for (int i = 0; i < ranges.count(); ++i)
+        {
+#if QT_VERSION < 0x060000
+            QFuture<void> future = QtConcurrent::run(this, &DuplicateSearch::compareChunk, ranges[i].first, ranges[i].second, &candidates, &chunkGroups[i], &breakFlag);
+#else
+            QFuture<void> future = QtConcurrent::run(&DuplicateSearch::compareChunk, this, ranges[i].first, ranges[i].second, &candidates, &chunkGroups[i], &breakFlag);
+#endif
+            synchronizer.addFuture(future);
+        }
+        synchronizer.waitForFinished();
+    }
+    for (int i = 0; i < chunkGroups.count(); ++i)
+    {
+        groups += chunkGroups[i];
     }
 }
 
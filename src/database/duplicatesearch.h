@@ -6,11 +6,27 @@
 #define DUPLICATESEARCH_H
 
 #include "search.h"
+#include <QAtomicInt>
 #include <QBitArray>
-#include <QMultiHash>
+#include <QVector>
 
 /** @ingroup Search
-The DuplicateSearch class defines a search for duplicates within a database */
+The DuplicateSearch class defines a search for duplicates within a database.
+
+Each game gets a fingerprint of the parts compared by the mode, its tag values
+and/or its moves and annotations. The games of a mode with moves are loaded
+once, in parallel. Sorting the fingerprints puts equal games next to each
+other, so only games with equal fingerprints are compared, which rules out
+games whose fingerprints merely collide. With a filter, only groups holding at
+least one game of the filter count.
+
+DS_Similar finds games which are the same although their copies differ, like
+games with misspelt names or truncated move lists. The games are put into
+blocks of equal date, result and opening moves. Within a block, games of
+about the same length are compared by the agreement of their main lines and
+the similarity of their player names. Games shorter than the opening moves of
+the blocks are compared with the short games of equal date and result in a
+second pass. Of each group of similar games the best one is kept. */
 class DuplicateSearch : public Search
 {
     Q_OBJECT
@@ -23,7 +39,8 @@ public:
         DS_Both,
         DS_Both_All,
         DS_Game,
-        DS_Game_All
+        DS_Game_All,
+        DS_Similar
     } DSMode;
 
     /** Standard constructor. */
@@ -33,11 +50,57 @@ public:
     virtual int matches(GameId index) const;
 
     virtual void Prepare(volatile bool& breakFlag);
-    void PrepareFilter(volatile bool& breakFlag);
+
+    /** @return @p name case folded, without accents and punctuation */
+    static QString normalizedName(const QString& name);
+    /** @return the similarity of two player names, between 0 and 1 */
+    static double nameSimilarity(const QString& name1, const QString& name2);
 
 private:
-    QMultiHash<quint64, GameId> m_hashToGames;
+    struct Candidate
+    {
+        quint64 key;
+        GameId id;
+
+        bool operator<(const Candidate& other) const
+        {
+            return (key < other.key) || (key == other.key && id < other.id);
+        }
+    };
+
+    /** The parts of a game compared in DS_Similar mode */
+    struct SimilarGame
+    {
+        SimilarGame() : tagKey(0), key(0), plies(-1) {}
+        quint64 tagKey;           ///< date and result
+        quint64 key;              ///< date, result and opening moves
+        int plies;                ///< length of the main line, -1 for deleted games
+        QVector<quint16> moves;   ///< first moves of the main line
+    };
+
+    /** Store the fingerprints of the moves of the games @p start to @p end */
+    void fingerprintChunk(GameId start, GameId end, quint64* fingerprints, volatile bool* breakFlag);
+    /** Mark the duplicates within @p group, equal games in ascending order */
+    void markGroup(const QVector<GameId>& group);
+    /** Keep the best of the games of @p group in DS_Tags_BestGame mode, mark the others */
+    void markWorseGames(const QVector<GameId>& group);
+    /** Mark all games of @p group but the best one */
+    void markAllButBest(const QVector<GameId>& group);
+
+    /** Find the similar games, the DS_Similar part of Prepare() */
+    void prepareSimilar(volatile bool& breakFlag);
+    /** Store the main lines and blocking keys of the games @p start to @p end */
+    void similarChunk(GameId start, GameId end, volatile bool* breakFlag);
+    /** Group the similar games within the blocks of equal keys of @p candidates, in parallel */
+    void compareBlocks(QVector<Candidate>& candidates, int chunk, QVector<QVector<GameId> >& groups, volatile bool& breakFlag);
+    /** Group the similar games within the blocks of @p candidates from @p first to @p last */
+    void compareChunk(int first, int last, const QVector<Candidate>* candidates, QVector<QVector<GameId> >* groups, volatile bool* breakFlag);
+    /** @return true if the games @p id1 and @p id2 are taken as the same */
+    bool isSimilar(GameId id1, GameId id2) const;
+
     QBitArray m_matches;
+    QAtomicInt m_fingerprinted;
+    QVector<SimilarGame> m_similarGames;
     DSMode m_mode;
     FilterX* m_filter;
 };
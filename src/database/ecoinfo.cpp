@@ -110,12 +110,8 @@ void EcoInfo::update()
     // Clean previous statistics
     reset();
 
-    for(int i = 0; i < (int) m_database->count(); ++i)
+    foreach(GameId i, index->gamesWithValue(TagNameECO, eco))
     {
-        if(index->valueIndexFromTag(TagNameECO, i) != eco)
-        {
-            continue;
-        }
         QString result = index->tagValue(TagNameResult, i);
         int res = toResult(result);
         QString whitePlayer = index->tagValue(TagNameWhite, i);
@@ -105,12 +105,8 @@ void EventInfo::update()
     // Clean previous statistics
     reset();
 
-    for(int i = 0; i < (int) m_database->count(); ++i)
+    foreach(GameId i, index->gamesWithValue(TagNameEvent, event))
     {
-        if(index->valueIndexFromTag(TagNameEvent, i) != event)
-        {
-            continue;
-        }
         QString result = index->tagValue(TagNameResult, i);
         int res = ResultFromString(result);
         QString whitePlayer = index->tagValue(TagNameWhite, i);
@@ -164,6 +164,8 @@ void FilterX::invert()
 void FilterX::runSingleSearch(Search* s, FilterOperator op)
 {
     connect(s, SIGNAL(prepareUpdate(int)), this, SIGNAL(searchProgress(int)));
+    s->setInputFilter(this);
+    s->setInputOperator(op);
     s->Prepare(m_break);
     switch (op)
     {
@@ -94,6 +94,11 @@ bool FilterModel::canEditItem(const QModelIndex& index) const
     return false;
 }
 
+bool FilterModel::isNumericColumn(int column)
+{
+    return (column==2) || (column==4) || (column==11);
+}
+
 void FilterModel::cacheTags()
 {
     m_columnTagIndex.clear();
@@ -154,6 +159,7 @@ bool FilterModel::setData(const QModelIndex &index, const QVariant &value, int r
     {
         GameId id = index.row();
         m_filter->database()->index()->setTag(m_columnTags[index.column()], value.toString(), id);
+        m_filter->database()->setGameChanged(id);
         emit dataChanged(index, index, QVector<int>() << role);
         TagIndex tag = m_columnTagIndex[index.column()];
         if (tag == TagNoIndex)
@@ -188,7 +194,7 @@ QVariant FilterModel::data(const QModelIndex &index, int role) const
                     return i + 1;
                 }
                 QString tag = m_filter->database()->tagValue(i, m_columnTagIndex[index.column()]);
-                if ((index.column()==2) || (index.column()==4) || (index.column()==11))
+                if (isNumericColumn(index.column()))
                 {
                     return tag.toInt();
                 }
@@ -75,6 +75,9 @@ public:
         return m_columnTags;
     }
 
+    /** @return true if column @p column is sorted by its integer value */
+    static bool isNumericColumn(int column);
+
     void updateColumns();
     void set(GameId game, int value);
     static QStringList additionalTags();
@@ -0,0 +1,42 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef FINGERPRINT_H
+#define FINGERPRINT_H
+
+#include <QString>
+#include <QtGlobal>
+
+/** @ingroup Database
+ * 64 bit fingerprints of games and their parts. Equal contents give equal
+ * fingerprints, different contents practically never do, so fingerprints can
+ * be sorted and grouped instead of comparing games pairwise.
+ */
+
+/** Initial value of a fingerprint */
+const quint64 FingerprintSeed = Q_UINT64_C(0xcbf29ce484222325);
+
+/** @return @p fingerprint extended by @p value */
+inline quint64 fingerprintMix(quint64 fingerprint, quint64 value)
+{
+    fingerprint = (fingerprint ^ value) * Q_UINT64_C(0x9e3779b97f4a7c15);
+    return fingerprint ^ (fingerprint >> 29);
+}
+
+/** @return @p fingerprint extended by the length and characters of @p text */
+inline quint64 fingerprintMix(quint64 fingerprint, const QString& text)
+{
+    fingerprint = fingerprintMix(fingerprint, quint64(text.length()));
+    const ushort* p = text.utf16();
+    for (int i = 0; i < text.length(); ++i)
+    {
+        fingerprint = fingerprintMix(fingerprint, p[i]);
+    }
+    return fingerprint;
+}
+
+#endif // FINGERPRINT_H
@@ -11,6 +11,7 @@
 #include <QtDebug>
 #include <QFile>
 #include "annotation.h"
+#include "fingerprint.h"
 #include "gamecursor.h"
 #include "settings.h"
 #include "tags.h"
@@ -148,14 +149,55 @@ int GameCursor::variationCount(MoveId moveId) const
     MoveId node = makeNodeIndex(moveId);
     if(node != NO_MOVE)
     {
-        return m_nodes[node].variations.size();
+        int count = 0;
+        for(MoveId v = m_nodes[node].firstVariation; v != NO_MOVE; v = m_nodes[v].nextVariation)
+        {
+            ++count;
+        }
+        return count;
     }
     return 0;
 }
 
-const QList<MoveId>& GameCursor::variations() const
+QList<MoveId> GameCursor::variations() const
+{
+    return variations(m_currentNode);
+}
+
+QList<MoveId> GameCursor::variations(MoveId moveId) const
+{
+    QList<MoveId> list;
+    for(MoveId v = m_nodes[moveId].firstVariation; v != NO_MOVE; v = m_nodes[v].nextVariation)
+    {
+        list.append(v);
+    }
+    return list;
+}
+
+void GameCursor::appendVariation(MoveId parent, MoveId variation)
 {
-    return m_nodes[m_currentNode].variations;
+    m_nodes[variation].nextVariation = NO_MOVE;
+    MoveId* link = &m_nodes[parent].firstVariation;
+    while(*link != NO_MOVE)
+    {
+        link = &m_nodes[*link].nextVariation;
+    }
+    *link = variation;
+}
+
+void GameCursor::setVariations(MoveId parent, const QList<MoveId>& variations)
+{
+    MoveId* link = &m_nodes[parent].firstVariation;
+    foreach(MoveId v, variations)
+    {
+        if(v == NO_MOVE)
+        {
+            continue;
+        }
+        *link = v;
+        link = &m_nodes[v].nextVariation;
+    }
+    *link = NO_MOVE;
 }
 
 bool GameCursor::isMainline(MoveId moveId) const
@@ -332,7 +374,7 @@ MoveId GameCursor::variationBranchPoint(MoveId variation) const
         MoveId prevNode = variation;
         while ((prevNode = m_nodes[prevNode].previousNode) != NO_MOVE)
         {
-            if (m_nodes[prevNode].variations.size())
+            if (m_nodes[prevNode].firstVariation != NO_MOVE)
             {
                 branch = prevNode;
                 break;
@@ -480,7 +522,7 @@ MoveId GameCursor::addVariation(const Move& move)
     auto saveNextNode = m_nodes[m_currentNode].nextNode;
     auto node = addMove(move);
     m_nodes[m_currentNode].parentNode = previousNode;
-    m_nodes[previousNode].variations.append(node);
+    appendVariation(previousNode, node);
     m_nodes[previousNode].nextNode = saveNextNode;
     return node;
 }
@@ -503,7 +545,7 @@ void GameCursor::remove(MoveId moveId, QList<MoveId>* removed)
     {
         removed->append(node);
     }
-    for (auto v: qAsConst(m_nodes[node].variations))
+    for (MoveId v = m_nodes[node].firstVariation; v != NO_MOVE; v = m_nodes[v].nextVariation)
     {
         remove(v, removed);
     }
@@ -525,7 +567,7 @@ void GameCursor::truncateFrom(MoveId moveId, QList<MoveId>* removed)
     if (node == NO_MOVE)
         return;
     remove(m_nodes[node].nextNode, removed);
-    for (auto v: qAsConst(m_nodes[node].variations))
+    for (MoveId v = m_nodes[node].firstVariation; v != NO_MOVE; v = m_nodes[v].nextVariation)
     {
         remove(v, removed);
     }
@@ -552,8 +594,9 @@ void GameCursor::truncateUpto(MoveId moveId, QList<MoveId>* removed)
     // Keep variation if truncating main line
     if(m_nodes[m_nodes[m_currentNode].previousNode].nextNode == m_currentNode)
     {
-        firstNode.variations = m_nodes[m_nodes[m_currentNode].previousNode].variations;
-        foreach(MoveId var, firstNode.variations)
+        // The chain lives in the variation nodes, taking over its head is enough
+        firstNode.firstVariation = m_nodes[m_nodes[m_currentNode].previousNode].firstVariation;
+        for(MoveId var = firstNode.firstVariation; var != NO_MOVE; var = m_nodes[var].nextVariation)
         {
             reparentVariation(var, 0);
             m_nodes[var].previousNode = 0;
@@ -584,8 +627,11 @@ void GameCursor::promoteVariation(MoveId variation)
     reparentVariation(variation, m_nodes[parent].parentNode);
 
     // Swap main line and the variation
-    int index = m_nodes[parent].variations.indexOf(variation);
-    qSwap(m_nodes[parent].nextNode, m_nodes[parent].variations[index]);
+    QList<MoveId> vars = variations(parent);
+    int index = vars.indexOf(variation);
+    qSwap(m_nodes[parent].nextNode, vars[index]);
+    setVariations(parent, vars);
+    m_nodes[m_nodes[parent].nextNode].nextVariation = NO_MOVE;
     moveToId(save);
 }
 
@@ -597,7 +643,7 @@ bool GameCursor::canMoveVariationUp(MoveId moveId) const
     auto variation = variationNumber(moveId);
     auto parentNode = m_nodes[moveId].parentNode;
 
-    auto& vars = m_nodes[parentNode].variations;
+    auto vars = variations(parentNode);
     int i = vars.indexOf(variation);
     return i > 0;
 }
@@ -610,7 +656,7 @@ bool GameCursor::canMoveVariationDown(MoveId moveId) const
     auto variation = variationNumber(moveId);
     auto parentNode = m_nodes[moveId].parentNode;
 
-    auto& vars = m_nodes[parentNode].variations;
+    auto vars = variations(parentNode);
     int i = vars.indexOf(variation);
     return 0 <= i && i + 1 < vars.size();
 }
@@ -623,12 +669,13 @@ bool GameCursor::moveVariationUp(MoveId moveId)
     auto variation = variationNumber(moveId);
     auto parentNode = m_nodes[moveId].parentNode;
 
-    auto& vars = m_nodes[parentNode].variations;
+    auto vars = variations(parentNode);
     int i = vars.indexOf(variation);
     auto possible = i > 0;
     if (possible)
     {
         vars.swapItemsAt(i, i - 1);
+        setVariations(parentNode, vars);
     }
     return possible;
 }
@@ -641,12 +688,13 @@ bool GameCursor::moveVariationDown(MoveId moveId)
     auto variation = variationNumber(moveId);
     auto parentNode = m_nodes[moveId].parentNode;
 
-    auto& vars = m_nodes[parentNode].variations;
+    auto vars = variations(parentNode);
     int i = vars.indexOf(variation);
     auto possible = 0 <= i && i + 1 < vars.size();
     if (possible)
     {
         vars.swapItemsAt(i, i + 1);
+        setVariations(parentNode, vars);
     }
     return possible;
 }
@@ -662,9 +710,10 @@ bool GameCursor::removeVariation(MoveId variation)
     remove(variation);
     moveToId(parentNode);
 
-    QList<MoveId> &vars = m_nodes[m_currentNode].variations;
+    QList<MoveId> vars = variations(m_currentNode);
     int n = vars.indexOf(variation);
     vars.removeAt(n);
+    setVariations(m_currentNode, vars);
     return true;
 }
 
@@ -672,9 +721,9 @@ void GameCursor::removeVariations()
 {
     for(int i = 0; i < m_nodes.size(); ++i)
     {
-        while (!m_nodes[i].variations.empty())
+        while (m_nodes[i].firstVariation != NO_MOVE)
         {
-            removeVariation(m_nodes[i].variations.at(0));
+            removeVariation(m_nodes[i].firstVariation);
         }
     }
 }
@@ -696,14 +745,15 @@ void GameCursor::removeNullLines()
                     // This is the first move of an empty variation
                     MoveId parentNode = m_nodes[self].parentNode;
                     remove(self);
-                    QList<MoveId> &vars = m_nodes[parentNode].variations;
+                    QList<MoveId> vars = variations(parentNode);
                     int n = vars.indexOf(self);
                     vars.removeAt(n);
+                    setVariations(parentNode, vars);
                  }
                 else
                 {
                     MoveId previousNode = m_nodes[self].previousNode;
-                    QList<MoveId> &vars = m_nodes[previousNode].variations;
+                    QList<MoveId> vars = variations(previousNode);
                     if (vars.isEmpty())
                     {
                         // This is an empty move at the end of a line
@@ -719,6 +769,8 @@ void GameCursor::removeNullLines()
                         node.remove();
                         m_nodes[previousNode].nextNode = variation;
                         vars.removeAt(0);
+                        setVariations(previousNode, vars);
+                        m_nodes[variation].nextVariation = NO_MOVE;
                     }
                 }
             }
@@ -772,30 +824,24 @@ QMap<MoveId, MoveId> GameCursor::compact()
     // map NO_MOVE for simplicity
     renames[NO_MOVE] = NO_MOVE;
 
-    // arena ends
-    auto ib = m_nodes.cbegin(), ie = m_nodes.cend();
-    // read iterator
-    auto ir = ib;
-    // write iterator
-    auto iw = m_nodes.begin();
-    // keep track of indexes corresponding to `ir` and `iw`
+    // the variation chains run through the old indexes, read them first
+    QVector<QList<MoveId>> chains;
+    // keep track of indexes corresponding to read and write position
     MoveId src = 0, dst = 0;
-    for (; ir != ie; ++ir, ++src)
+    for (; src < m_nodes.size(); ++src)
     {
-        auto& node = *ir;
         // skip removed nodes
-        if (node.Removed())
+        if (m_nodes[src].Removed())
             continue;
+        chains.append(variations(src));
         // move data
-        *iw = *ir;
+        m_nodes[dst] = m_nodes[src];
         // note rename
         renames[src] = dst;
-        // update write iterator
-        ++iw;
         ++dst;
     }
     // shrink m_nodes
-    m_nodes.erase(iw, m_nodes.end());
+    m_nodes.resize(dst);
 
     // update links
     for (auto& node: m_nodes)
@@ -803,12 +849,20 @@ QMap<MoveId, MoveId> GameCursor::compact()
         node.nextNode = renames[node.nextNode];
         node.previousNode = renames[node.previousNode];
         node.parentNode = renames[node.parentNode];
-        for (auto& v: node.variations)
+        node.nextVariation = NO_MOVE;
+    }
+    for (MoveId node = 0; node < m_nodes.size(); ++node)
+    {
+        QList<MoveId> vars;
+        foreach (MoveId v, chains[node])
         {
             v = renames[v];
+            if (v != NO_MOVE && v != ROOT_NODE)
+            {
+                vars.append(v);
+            }
         }
-        node.variations.removeAll(NO_MOVE);
-        node.variations.removeAll(ROOT_NODE);
+        setVariations(node, vars);
     }
     m_currentNode = renames[m_currentNode];
     return renames;
@@ -837,6 +891,20 @@ MoveId GameCursor::findPosition(const BoardX& position) const
     return NO_MOVE;
 }
 
+quint64 GameCursor::fingerprint() const
+{
+    // The fields compared by Node::operator==
+    quint64 fingerprint = fingerprintMix(FingerprintSeed, quint64(m_nodes.count()));
+    foreach (const Node& node, m_nodes)
+    {
+        fingerprint = fingerprintMix(fingerprint, node.move.rawMove());
+        fingerprint = fingerprintMix(fingerprint, quint32(node.firstVariation));
+        fingerprint = fingerprintMix(fingerprint, quint32(node.nextVariation));
+        fingerprint = fingerprintMix(fingerprint, quint16(node.m_ply));
+    }
+    return fingerprint;
+}
+
 void GameCursor::dumpMoveNode(MoveId moveId) const
 {
     if(moveId == CURRENT_MOVE)
@@ -850,11 +918,109 @@ void GameCursor::dumpMoveNode(MoveId moveId) const
         qDebug() << "   Prev node   : " << m_nodes.at(moveId).previousNode;
         qDebug() << "   Parent node : " << m_nodes.at(moveId).parentNode;
         qDebug() << "   Deleted     : " << m_nodes.at(moveId).Removed();
-        qDebug() << "   # Variations: " << m_nodes.at(moveId).variations.size();
-        qDebug() << "   Variations  : " << m_nodes.at(moveId).variations;
+        qDebug() << "   # Variations: " << variationCount(moveId);
+        qDebug() << "   Variations  : " << variations(moveId);
         qDebug() << "   Move        : " << m_nodes.at(moveId).move.toAlgebraic()
                  << " (" << m_nodes.at(moveId).move.rawMove()
                  << ", " << m_nodes.at(moveId).move.rawUndo()
                  << ")";
     }
 }
+
+static bool identicalNodes(const GameCursor::Node& a, const GameCursor::Node& b)
+{
+    return a.previousNode == b.previousNode &&
+           a.nextNode == b.nextNode &&
+           a.parentNode == b.parentNode &&
+           a.firstVariation == b.firstVariation &&
+           a.nextVariation == b.nextVariation &&
+           a.m_ply == b.m_ply &&
+           a.move.rawMove() == b.move.rawMove() &&
+           a.move.rawUndo() == b.move.rawUndo();
+}
+
+GameCursor::Delta GameCursor::diff(const GameCursor& before, const GameCursor& after)
+{
+    Delta delta;
+    delta.sizeBefore = before.m_nodes.size();
+    delta.sizeAfter = after.m_nodes.size();
+    delta.currentBefore = before.m_currentNode;
+    delta.currentAfter = after.m_currentNode;
+    delta.startPlyBefore = before.m_startPly;
+    delta.startPlyAfter = after.m_startPly;
+
+    // Copies share their nodes until one of them is modified
+    if (before.m_nodes.constData() != after.m_nodes.constData())
+    {
+        int size = qMax(delta.sizeBefore, delta.sizeAfter);
+        for (MoveId id = 0; id < size; ++id)
+        {
+            bool inBefore = id < delta.sizeBefore;
+            bool inAfter = id < delta.sizeAfter;
+            if (inBefore && inAfter && identicalNodes(before.m_nodes[id], after.m_nodes[id]))
+            {
+                continue;
+            }
+            delta.nodes.append({id, inBefore, inAfter,
+                                inBefore ? before.m_nodes[id] : Node(),
+                                inAfter ? after.m_nodes[id] : Node()});
+        }
+    }
+
+    if (before.m_startPly != after.m_startPly ||
+        before.m_startingBoard.chess960() != after.m_startingBoard.chess960() ||
+        before.m_startingBoard.toFen() != after.m_startingBoard.toFen())
+    {
+        delta.startingBoards << before.m_startingBoard << after.m_startingBoard;
+    }
+    return delta;
+}
+
+void GameCursor::applyDelta(const Delta& delta, bool reverse)
+{
+    m_nodes.resize(reverse ? delta.sizeBefore : delta.sizeAfter);
+    for (const auto& change : delta.nodes)
+    {
+        if (reverse ? change.inBefore : change.inAfter)
+        {
+            m_nodes[change.key] = reverse ? change.before : change.after;
+        }
+    }
+    if (!delta.startingBoards.isEmpty())
+    {
+        m_startingBoard = delta.startingBoards[reverse ? 0 : 1];
+    }
+    m_startPly = reverse ? delta.startPlyBefore : delta.startPlyAfter;
+
+    MoveId current = reverse ? delta.currentBefore : delta.currentAfter;
+    if (m_currentBoard)
+    {
+        // the tree under the cursor may have changed, replay from the start
+        m_currentNode = ROOT_NODE;
+        *m_currentBoard = m_startingBoard;
+        moveToId(current);
+    }
+    else
+    {
+        m_currentNode = current;
+    }
+}
+
+void GameCursor::mergeDelta(Delta& first, const Delta& second)
+{
+    mergeChanges(first.nodes, second.nodes);
+    first.sizeAfter = second.sizeAfter;
+    first.currentAfter = second.currentAfter;
+    first.startPlyAfter = second.startPlyAfter;
+    if (!second.startingBoards.isEmpty())
+    {
+        if (first.startingBoards.isEmpty())
+        {
+            first.startingBoards = second.startingBoards;
+        }
+        else
+        {
+            first.startingBoards[1] = second.startingBoards[1];
+        }
+    }
+}
@@ -2,7 +2,9 @@
 #define GAMECURSOR_H
 
 #include <QObject>
+#include <QVector>
 #include "board.h"
+#include "gamedelta.h"
 #include "move.h"
 
 #define ROOT_NODE 0
@@ -16,18 +18,22 @@ typedef int MoveId;
 class GameCursor
 {
 public:
+    /** A node of the move tree. The variations starting after a node are
+        chained through the first node of each variation, so nodes hold no
+        containers of their own and the whole tree is one contiguous vector. */
     struct Node
     {
         MoveId previousNode;
         MoveId nextNode;
         MoveId parentNode;
+        MoveId firstVariation;   // first variation after this node
+        MoveId nextVariation;    // next sibling, if this node starts a variation
         short m_ply;
         Move move;
-        QList<MoveId> variations;
         void remove()
         {
-            parentNode = previousNode = nextNode = NO_MOVE;
-            variations.clear();
+            // nextVariation stays, the node is unlinked by its parent
+            parentNode = previousNode = nextNode = firstVariation = NO_MOVE;
             setRemoved();
         }
         void setRemoved()
@@ -37,7 +43,7 @@ public:
         Node()
         {
             parentNode = nextNode = previousNode = NO_MOVE;
-            variations.clear();
+            firstVariation = nextVariation = NO_MOVE;
             m_ply = 0;
         }
         void SetPly(short ply) { Q_ASSERT(m_ply<0x7FFF); m_ply = ply; }
@@ -46,7 +52,8 @@ public:
         inline bool operator==(const struct Node& c) const
         {
             return (move == c.move &&
-                    variations == c.variations &&
+                    firstVariation == c.firstVariation &&
+                    nextVariation == c.nextVariation &&
                     m_ply == c.m_ply);
         }
     };
@@ -96,8 +103,8 @@ public:
     /** @return number of variations at the current position */
     int variationCount(MoveId moveId = CURRENT_MOVE) const;
     /** @return list of variation at the current move */
-    const QList<MoveId>& variations() const;
-    const QList<MoveId>& variations(MoveId moveId) const { return m_nodes[moveId].variations; }
+    QList<MoveId> variations() const;
+    QList<MoveId> variations(MoveId moveId) const;
     /** @returns amount of allocated nodes */
     int capacity() const { return m_nodes.size(); }
 
@@ -197,12 +204,35 @@ public:
 
     /** compare game moves and annotations */
     int isEqual(const GameCursor& rhs) const { return m_nodes == rhs.m_nodes; }
+    /** @return a fingerprint of the move tree, the same for trees which are isEqual() */
+    quint64 fingerprint() const;
+
+    /** Reversible difference between two versions of a move tree */
+    struct Delta
+    {
+        int sizeBefore;
+        int sizeAfter;
+        MoveId currentBefore;
+        MoveId currentAfter;
+        /** Nodes which differ, including those present on one side only */
+        QList<DeltaChange<MoveId, Node> > nodes;
+        short startPlyBefore;
+        short startPlyAfter;
+        /** Starting boards before and after, empty unless the start position changed */
+        QList<BoardX> startingBoards;
+    };
+    /** @return the changes turning @p before into @p after */
+    static Delta diff(const GameCursor& before, const GameCursor& after);
+    /** Apply @p delta, or revert it if @p reverse is set, and move to the recorded current node */
+    void applyDelta(const Delta& delta, bool reverse = false);
+    /** Combine @p second, which must directly follow @p first, into @p first */
+    static void mergeDelta(Delta& first, const Delta& second);
 
 private:
     /** Keeps the current position of the game */
     BoardX* m_currentBoard;
-    /** List of nodes */
-    QList<Node> m_nodes;
+    /** All nodes of the game, shared between copies until one is modified */
+    QVector<Node> m_nodes;
     /** Keeps the current node in the game */
     MoveId m_currentNode;
     /** Keeps the start ply of the game, 0 for standard starting position */
@@ -211,6 +241,12 @@ private:
     BoardX m_startingBoard;
 
     void initCursor();
+    /** Add @p variation as the last variation after @p parent */
+    void appendVariation(MoveId parent, MoveId variation);
+    /** Rebuild the variation chain after @p parent from @p variations */
+    void setVariations(MoveId parent, const QList<MoveId>& variations);
 };
 
+Q_DECLARE_TYPEINFO(GameCursor::Node, Q_MOVABLE_TYPE);
+
 #endif // GAMECURSOR_H
@@ -0,0 +1,97 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef GAMEDELTA_H
+#define GAMEDELTA_H
+
+#include <QHash>
+#include <QList>
+
+/** A single reversible change of a keyed value. A value missing on one side
+    is recorded with the corresponding @p in flag cleared. */
+template <class Key, class T>
+struct DeltaChange
+{
+    Key key;
+    bool inBefore;
+    bool inAfter;
+    T before;
+    T after;
+};
+
+/** Record the keys of the associative containers @p before and @p after
+    whose values differ. Works with QMap and QHash alike. */
+template <class Key, class T, class Container>
+QList<DeltaChange<Key, T> > diffContainers(const Container& before, const Container& after)
+{
+    QList<DeltaChange<Key, T> > changes;
+    for (auto it = before.constBegin(); it != before.constEnd(); ++it)
+    {
+        auto other = after.constFind(it.key());
+        if (other == after.constEnd())
+        {
+            changes.append({it.key(), true, false, it.value(), T()});
+        }
+        else if (!(other.value() == it.value()))
+        {
+            changes.append({it.key(), true, true, it.value(), other.value()});
+        }
+    }
+    for (auto it = after.constBegin(); it != after.constEnd(); ++it)
+    {
+        if (!before.contains(it.key()))
+        {
+            changes.append({it.key(), false, true, T(), it.value()});
+        }
+    }
+    return changes;
+}
+
+/** Apply @p changes to @p container, towards the after state unless
+    @p reverse is set. */
+template <class Key, class T, class Container>
+void applyContainerChanges(Container& container, const QList<DeltaChange<Key, T> >& changes, bool reverse)
+{
+    for (const auto& change : changes)
+    {
+        if (reverse ? change.inBefore : change.inAfter)
+        {
+            container.insert(change.key, reverse ? change.before : change.after);
+        }
+        else
+        {
+            container.remove(change.key);
+        }
+    }
+}
+
+/** Combine the changes @p first (A to B) and @p second (B to C) into @p first,
+    which then takes A to C. */
+template <class Key, class T>
+void mergeChanges(QList<DeltaChange<Key, T> >& first, const QList<DeltaChange<Key, T> >& second)
+{
+    QHash<Key, int> index;
+    for (int i = 0; i < first.count(); ++i)
+    {
+        index.insert(first[i].key, i);
+    }
+    for (const auto& change : second)
+    {
+        int i = index.value(change.key, -1);
+        if (i < 0)
+        {
+            first.append(change);
+        }
+        else
+        {
+            first[i].inAfter = change.inAfter;
+            first[i].after = change.after;
+        }
+    }
+}
+
+#endif // GAMEDELTA_H
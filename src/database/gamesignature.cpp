@@ -0,0 +1,113 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <QtAlgorithms>
+
+#include "board.h"
+#include "gamesignature.h"
+#include "gamex.h"
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+#define DEBUG_NEW new( _NORMAL_BLOCK, __FILE__, __LINE__ )
+#define new DEBUG_NEW
+#endif // _MSC_VER
+
+static const int MaterialTypes = 5; // queens, rooks, bishops, knights, pawns
+
+GameSignature::GameSignature() :
+    m_initialMaterial(0),
+    m_material(0),
+    m_homePawnOrder(0),
+    m_homePawns(0),
+    m_homePawnCount(0),
+    m_promotions(false),
+    m_valid(false)
+{
+}
+
+GameSignature::GameSignature(const GameX& game) : GameSignature()
+{
+    const GameCursor& cursor = game.cursor();
+    BoardX board = cursor.initialBoard();
+    m_initialMaterial = board.materialSignature();
+    m_homePawns = board.homePawns();
+
+    quint16 homePawns = m_homePawns;
+    for(MoveId node = cursor.nextMove(ROOT_NODE); node != NO_MOVE; node = cursor.nextMove(node))
+    {
+        Move move = cursor.move(node);
+        m_promotions |= move.isPromotion();
+        board.doMove(move);
+
+        quint16 left = homePawns & ~board.homePawns();
+        homePawns &= ~left;
+        while(left)
+        {
+            quint64 pawn = qCountTrailingZeroBits(left);
+            m_homePawnOrder |= pawn << (4 * m_homePawnCount++);
+            left &= left - 1;
+        }
+    }
+    m_material = board.materialSignature();
+    m_valid = true;
+}
+
+bool GameSignature::canContain(const BoardX& position) const
+{
+    if(!m_valid)
+    {
+        return true;
+    }
+
+    // The home pawns of the position must be the initial ones less the first pawns to leave
+    quint16 homePawns = position.homePawns();
+    if(homePawns & ~m_homePawns)
+    {
+        return false;
+    }
+    quint16 left = m_homePawns & ~homePawns;
+    int count = qPopulationCount(left);
+    if(count > m_homePawnCount)
+    {
+        return false;
+    }
+    quint16 firstLeft = 0;
+    for(int i = 0; i < count; ++i)
+    {
+        firstLeft |= 1 << ((m_homePawnOrder >> (4 * i)) & 0xF);
+    }
+    if(firstLeft != left)
+    {
+        return false;
+    }
+
+    // Material only decreases, except that a promotion turns a pawn into a piece
+    quint64 material = position.materialSignature();
+    for(int color = White; color <= Black; ++color)
+    {
+        int total = 0;
+        int finalTotal = 0;
+        for(int type = 0; type < MaterialTypes; ++type)
+        {
+            int shift = 4 * (MaterialTypes * color + type);
+            int pieces = (material >> shift) & 0xF;
+            int finalPieces = (m_material >> shift) & 0xF;
+            bool pawns = (type == MaterialTypes - 1);
+            if(finalPieces > pieces && (pawns || !m_promotions))
+            {
+                return false;
+            }
+            total += pieces;
+            finalTotal += finalPieces;
+        }
+        if(finalTotal > total)
+        {
+            return false;
+        }
+    }
+    return true;
+}
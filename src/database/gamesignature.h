@@ -0,0 +1,54 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef GAMESIGNATURE_H_INCLUDED
+#define GAMESIGNATURE_H_INCLUDED
+
+#include <QtGlobal>
+
+class BoardX;
+class GameX;
+
+/** @ingroup Database
+   The GameSignature class summarizes the main line of a game so that most
+   positions which cannot occur in it are rejected without replaying it:
+   the material of the final position and the order in which the pawns
+   left their initial squares (like the material and home pawn signatures of Scid).
+*/
+class GameSignature
+{
+public:
+    /** An invalid signature, which does not reject any position */
+    GameSignature();
+    /** Calculate the signature of the main line of @p game */
+    explicit GameSignature(const GameX& game);
+
+    bool isValid() const { return m_valid; }
+    /** @return false if @p position can not occur in the main line of the game */
+    bool canContain(const BoardX& position) const;
+    /** Material of the initial position, see BitBoard::materialSignature() */
+    quint64 initialMaterial() const { return m_initialMaterial; }
+    /** Material of the final position, see BitBoard::materialSignature() */
+    quint64 finalMaterial() const { return m_material; }
+    /** @return true if a pawn was promoted in the main line */
+    bool hasPromotions() const { return m_promotions; }
+
+private:
+    quint64 m_initialMaterial;
+    quint64 m_material;
+    /** Home pawns which left their square, 4 bits per pawn in the order they left */
+    quint64 m_homePawnOrder;
+    /** Home pawns of the initial position, see BitBoard::homePawns() */
+    quint16 m_homePawns;
+    /** Number of pawns in m_homePawnOrder */
+    quint8 m_homePawnCount;
+    /** Promotions change the material of a side */
+    bool m_promotions;
+    bool m_valid;
+};
+
+#endif // GAMESIGNATURE_H_INCLUDED
@@ -0,0 +1,136 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <QQueue>
+#include <QtConcurrent/QtConcurrent>
+
+#include "filter.h"
+#include "gametransformer.h"
+#include "gamex.h"
+#include "refcount.h"
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+#define DEBUG_NEW new( _NORMAL_BLOCK, __FILE__, __LINE__ )
+#define new DEBUG_NEW
+#endif // _MSC_VER
+
+namespace {
+
+struct TransformedChunk
+{
+    QVector<GameId> ids;
+    QVector<GameX> games;
+};
+
+TransformedChunk transformChunk(Database* database, QVector<GameId> ids,
+                                GameTransformer::Transformation transformation, volatile bool* breakFlag)
+{
+    TransformedChunk chunk;
+    chunk.ids.reserve(ids.count());
+    chunk.games.reserve(ids.count());
+    GameX game;
+    foreach (GameId id, ids)
+    {
+        if (*breakFlag)
+        {
+            break;
+        }
+        if (database->loadGame(id, game))
+        {
+            transformation(game);
+            game.unmountBoard();
+            chunk.ids.append(id);
+            chunk.games.append(game);
+        }
+    }
+    return chunk;
+}
+
+} // namespace
+
+GameTransformer::GameTransformer(QObject *parent) :
+    QThread(parent),
+    m_database(nullptr),
+    m_transformed(0),
+    m_break(false)
+{
+}
+
+GameTransformer::~GameTransformer()
+{
+}
+
+void GameTransformer::run()
+{
+    if (m_database)
+    {
+        RefKeeper keeper(m_database->refCounter());
+
+        // Each chunk holds its games in memory until it is replaced, so the
+        // number of chunks in flight bounds the memory used by the job.
+        const int chunkSize = 256;
+        const int maxChunks = 2 * qMax(1, QThread::idealThreadCount());
+
+        QQueue<QFuture<TransformedChunk> > pending;
+        int percentDone = 0;
+        int next = 0;
+        int handled = 0;
+        while (handled < m_games.count() && !m_break)
+        {
+            while (next < m_games.count() && pending.count() < maxChunks)
+            {
+                pending.enqueue(QtConcurrent::run(transformChunk, m_database.data(), m_games.mid(next, chunkSize), m_transformation, &m_break));
+                next += chunkSize;
+            }
+            TransformedChunk chunk = pending.dequeue().result();
+            for (int i = 0; i < chunk.ids.count() && !m_break; ++i)
+            {
+                m_database->replace(chunk.ids[i], chunk.games[i]);
+                ++m_transformed;
+            }
+            handled = qMin(handled + chunkSize, m_games.count());
+
+            int percentDone2 = static_cast<int>(qint64(handled) * 100 / m_games.count());
+            if (percentDone2 > percentDone)
+            {
+                emit progress((percentDone = percentDone2));
+            }
+        }
+        while (!pending.isEmpty())
+        {
+            pending.dequeue().waitForFinished();
+        }
+    }
+    emit transformFinished(this);
+    deleteLater();
+}
+
+// ---------------------------------------------------------
+// Mainthread Interface
+// ---------------------------------------------------------
+
+void GameTransformer::transformGames(FilterX* filter, Transformation transformation, GameId skip)
+{
+    m_break = false;
+    m_transformed = 0;
+    m_database = filter->database();
+    m_transformation = transformation;
+    m_games.clear();
+    for (GameId i = 0, sz = filter->size(); i < sz; ++i)
+    {
+        if (i != skip && filter->contains(i))
+        {
+            m_games.append(i);
+        }
+    }
+    start();
+}
+
+void GameTransformer::cancel()
+{
+    m_break = true;
+}
@@ -0,0 +1,65 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef GAMETRANSFORMER_H
+#define GAMETRANSFORMER_H
+
+#include <functional>
+
+#include <QPointer>
+#include <QThread>
+#include <QVector>
+
+#include "database.h"
+#include "gameid.h"
+
+class FilterX;
+class GameX;
+
+/** @ingroup Database
+The GameTransformer class applies a transformation to every game of a filter
+and stores the results back into the database. Games are loaded and transformed
+in chunks on worker threads, with a bounded number of chunks in flight, and are
+replaced in the original order on the transformer thread. */
+class GameTransformer : public QThread
+{
+    Q_OBJECT
+public:
+    /** Changes a game in place. Called concurrently, so it must not touch shared state. */
+    typedef std::function<void(GameX&)> Transformation;
+
+    explicit GameTransformer(QObject *parent = nullptr);
+    ~GameTransformer();
+    /** Start transforming the games in @p filter, leaving out @p skip (e.g. the game being edited) */
+    void transformGames(FilterX* filter, Transformation transformation, GameId skip = InvalidGameId);
+    /** @return the database being transformed */
+    Database* database() const { return m_database; }
+    /** @return number of games replaced so far */
+    int transformedCount() const { return m_transformed; }
+    /** @return true if the job stopped before all games were handled */
+    bool wasCancelled() const { return m_break; }
+
+signals:
+    void transformFinished(GameTransformer*);
+    void progress(int);
+
+public slots:
+    void cancel();
+
+    // QThread interface
+protected:
+    virtual void run();
+
+    QPointer<Database> m_database;
+    QVector<GameId> m_games;
+    Transformation m_transformation;
+    int m_transformed;
+
+    volatile bool m_break;
+};
+
+#endif // GAMETRANSFORMER_H
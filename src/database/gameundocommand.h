@@ -13,26 +13,28 @@
 class DatabaseInfo;
 Q_DECLARE_METATYPE(DatabaseInfo*)
 
+/** Undo step of a game edit. Only the difference between the game before
+    and after the edit is kept, it is replayed against DatabaseInfo::undoBase(). */
 class GameUndoCommand : public QUndoCommand
 {
 public:
     GameUndoCommand(QObject* parent, const GameX& from, const GameX& to, QString action) :
         QUndoCommand(action),
         m_dbInfo(static_cast<DatabaseInfo*>(parent)),
-        m_fromGame(from),
-        m_toGame(to),
+        m_delta(GameX::diff(from, to)),
+        m_id(from.currentMove()),
         m_bInConstructor(true)
         {
         }
 
     QPointer<DatabaseInfo> m_dbInfo;
-    GameX m_fromGame;
-    GameX m_toGame;
+    GameX::Delta m_delta;
+    MoveId m_id;
     bool m_bInConstructor;
 
-    void undo() { m_dbInfo->restoreState(m_fromGame); }
-    void redo() { if (m_bInConstructor) m_bInConstructor=false; else m_dbInfo->restoreState(m_toGame); }
-    int id() const  { return m_fromGame.currentMove(); }
+    void undo() { restore(true); }
+    void redo() { if (m_bInConstructor) m_bInConstructor=false; else restore(false); }
+    int id() const  { return m_id; }
     bool mergeWith(const QUndoCommand *other)
     {
         if (m_bInConstructor)
@@ -43,9 +45,17 @@ public:
             return false;
         if (other->id() != id()) // make sure other applies to the same position
             return false;
-        m_toGame = (static_cast<const GameUndoCommand*>(other))->m_toGame;
+        GameX::mergeDelta(m_delta, (static_cast<const GameUndoCommand*>(other))->m_delta);
         return true;
     }
+
+private:
+    void restore(bool reverse)
+    {
+        GameX game(m_dbInfo->undoBase());
+        game.applyDelta(m_delta, reverse);
+        m_dbInfo->restoreState(game);
+    }
 };
 
 #endif // GAMEUNDOCOMMAND_H
@@ -13,6 +13,7 @@
 #include <QRegularExpression>
 #include "annotation.h"
 #include "ecopositions.h"
+#include "fingerprint.h"
 #include "gamex.h"
 #include "settings.h"
 #include "tags.h"
@@ -51,14 +52,13 @@ static const char strSquareNames[64][3] =
     "a8", "b8", "c8", "d8", "e8", "f8", "g8", "h8"
 };
 
-const QList<QRegularExpression> GameX::s_specList = QList<QRegularExpression>() << SquareAnnotation().filter() << ArrowAnnotation().filter() << EvalAnnotation().filter();
-
 GameX::GameX()
     : QObject()
     , m_moves()
     , m_variationStartAnnotations()
     , m_annotations()
     , m_nags()
+    , m_commands()
     , m_tags()
     , m_needsCleanup(false)
 {
@@ -70,6 +70,7 @@ GameX::GameX(const GameX& game)
     , m_variationStartAnnotations(game.m_variationStartAnnotations)
     , m_annotations(game.m_annotations)
     , m_nags(game.m_nags)
+    , m_commands(game.m_commands)
     , m_tags(game.m_tags)
     , m_needsCleanup(game.m_needsCleanup)
 {
@@ -87,6 +88,7 @@ GameX& GameX::operator=(const GameX& game)
         m_variationStartAnnotations = game.m_variationStartAnnotations;
         m_annotations = game.m_annotations;
         m_nags = game.m_nags;
+        m_commands = game.m_commands;
         m_tags = game.m_tags;
         m_needsCleanup = game.m_needsCleanup;
         if (m_moves.currentBoard() && !game.m_moves.currentBoard())
@@ -141,6 +143,16 @@ MoveId GameX::dbAddSanMove(const QString& sanMove, const QString& annotation, Na
     return NO_MOVE;
 }
 
+MoveId GameX::dbAddSanMove(const char* san, size_t length, const QString& annotation, NagSet nags)
+{
+    Move move = m_moves.currentBoard()->parseMove(san, length);
+    if(move.isLegal() || move.isNullMove())
+    {
+        return dbAddMove(move, annotation, nags);
+    }
+    return NO_MOVE;
+}
+
 MoveId GameX::addMove(const QString& sanMove, const QString& annotation, NagSet nags)
 {
     Move move = m_moves.currentBoard()->parseMove(sanMove);
@@ -472,7 +484,7 @@ bool GameX::currentNodeHasVariation(Square from, Square to) const
     return false;
 }
 
-const QList<MoveId>& GameX::currentVariations() const
+QList<MoveId> GameX::currentVariations() const
 {
     return m_moves.variations();
 }
@@ -723,6 +735,16 @@ MoveId GameX::dbAddSanVariation(const QString& sanMove, const QString& annotatio
     return NO_MOVE;
 }
 
+MoveId GameX::dbAddSanVariation(const char* san, size_t length, const QString& annotation, NagSet nags)
+{
+    Move move = m_moves.currentBoard()->parseMove(san, length);
+    if(move.isLegal() || move.isNullMove())
+    {
+        return dbAddVariation(move, annotation, nags);
+    }
+    return NO_MOVE;
+}
+
 void GameX::dbPromoteVariation(MoveId variation)
 {
     if(!isMainline(variation))
@@ -1109,8 +1131,7 @@ bool GameX::appendArrowAnnotation(Square dest, Square src, QChar colorCode)
 
 QString GameX::squareAnnotation(MoveId moveId) const
 {
-    QString s = specAnnotation(SquareAnnotation().filter(), moveId);
-    return s;
+    return commands(moveId, AfterMove).squares();
 }
 
 bool GameX::setSpecAnnotation(const Annotation& a)
@@ -1129,8 +1150,7 @@ bool GameX::setSpecAnnotation(const Annotation& a)
 
 QString GameX::arrowAnnotation(MoveId moveId) const
 {
-    QString s = specAnnotation(ArrowAnnotation().filter(), moveId);
-    return s;
+    return commands(moveId, AfterMove).arrows();
 }
 
 QString GameX::specAnnotation(const QRegularExpression &r, MoveId moveId) const
@@ -1170,9 +1190,7 @@ QString GameX::timeAnnotation(MoveId moveId, Position position) const
         else return "";
     }
 
-    QString s = specAnnotation(TimeAnnotation().filter(), moveId);
-    s = s.trimmed();
-    return s;
+    return commands(moveId, AfterMove).time();
 }
 
 void GameX::setTimeAnnotation(QString a, MoveId moveId)
@@ -1201,24 +1219,36 @@ QString GameX::annotation(MoveId moveId, Position position) const
     }
 }
 
+QList<MoveId> GameX::annotatedMoves(Position position) const
+{
+    return (position == AfterMove) ? m_annotations.keys() : m_variationStartAnnotations.keys();
+}
+
 QString GameX::specAnnotations(QString s) const
 {
-    QString retval;
-    foreach (QRegularExpression r, s_specList)
-    {
-        QRegularExpressionMatch match;
-        if (s.indexOf(r,0,&match)>=0)
-        {
-            retval += match.captured(0);
-        }
-    }
-    return retval;
+    return AnnotationCommands(s).specAnnotations();
 }
 
 QString GameX::specAnnotations(MoveId moveId, Position position) const
 {
-    QString s = annotation(moveId, position);
-    return specAnnotations(s);
+    return commands(moveId, position).specAnnotations();
+}
+
+AnnotationCommands GameX::commands(MoveId moveId, Position position) const
+{
+    MoveId node = m_moves.makeNodeIndex(moveId);
+    if (node == NO_MOVE)
+    {
+        return AnnotationCommands();
+    }
+    QString text = annotation(node, position);
+    MoveId key = node * 2 + (position == AfterMove ? 1 : 0);
+    auto it = m_commands.find(key);
+    if (it == m_commands.end() || it->text() != text)
+    {
+        it = m_commands.insert(key, AnnotationCommands(text));
+    }
+    return *it;
 }
 
 /* static */ QString GameX::cleanAnnotation(QString s, AnnotationFilter f)
@@ -1497,6 +1527,7 @@ void GameX::clear()
     m_variationStartAnnotations.clear();
     m_annotations.clear();
     m_nags.clear();
+    m_commands.clear();
 }
 
 void GameX::clearTags()
@@ -1740,45 +1771,38 @@ bool GameX::isEcoPosition() const
 
 void GameX::scoreMaterial(QList<double>& scores) const
 {
-    GameX g = *this;
-    g.moveToStart();
+    // Replay the main line on a board of its own, without copying the game
+    BoardX board = m_moves.initialBoard();
     scores.clear();
-
-    do
+    scores.append(board.score());
+    for (MoveId node = m_moves.nextMove(ROOT_NODE); node != NO_MOVE; node = m_moves.nextMove(node))
     {
-        int score = g.board().score();
-        scores.append(score);
-    } while(g.forward());
+        board.doMove(m_moves.move(node));
+        scores.append(board.score());
+    }
 }
 
 void GameX::evaluation(double& d) const
 {
-    QRegularExpression eval = EvalAnnotation().filter();
-    QRegularExpressionMatch match;
-    int pos = annotation().indexOf(eval, 0, &match);
-    if(pos >= 0)
+    AnnotationCommands c = commands(CURRENT_MOVE, AfterMove);
+    if (c.hasEvaluation())
     {
-        QString w = match.captured(2);
-        bool ok;
-        double f = w.toDouble(&ok);
-        if (ok)
-        {
-            d = f;
-        }
+        d = c.evaluation() / 100.0;
     }
 }
 
 void GameX::scoreEvaluations(QList<double>& evaluations) const
 {
-    GameX g = *this;
-    g.moveToStart();
+    // The evaluations are parsed once per comment and kept in m_commands
     evaluations.clear();
     double score = 0.0;
-    g.evaluation(score);
-    evaluations.append(score);
-    while(g.forward())
+    for (MoveId node = ROOT_NODE; node != NO_MOVE; node = m_moves.nextMove(node))
     {
-        g.evaluation(score);
+        AnnotationCommands c = commands(node, AfterMove);
+        if (c.hasEvaluation())
+        {
+            score = c.evaluation() / 100.0;
+        }
         evaluations.append(score);
     }
 }
@@ -1791,6 +1815,68 @@ int GameX::isEqual(const GameX& game) const
             (m_variationStartAnnotations == game.m_variationStartAnnotations));
 }
 
+GameX::Delta GameX::diff(const GameX& before, const GameX& after)
+{
+    Delta delta;
+    delta.moves = GameCursor::diff(before.m_moves, after.m_moves);
+    delta.variationStartAnnotations = diffContainers<MoveId, QString>(before.m_variationStartAnnotations, after.m_variationStartAnnotations);
+    delta.annotations = diffContainers<MoveId, QString>(before.m_annotations, after.m_annotations);
+    delta.nags = diffContainers<MoveId, NagSet>(before.m_nags, after.m_nags);
+    delta.tags = diffContainers<QString, QString>(before.m_tags, after.m_tags);
+    delta.needsCleanupBefore = before.m_needsCleanup;
+    delta.needsCleanupAfter = after.m_needsCleanup;
+    return delta;
+}
+
+void GameX::applyDelta(const Delta& delta, bool reverse)
+{
+    m_moves.applyDelta(delta.moves, reverse);
+    applyContainerChanges(m_variationStartAnnotations, delta.variationStartAnnotations, reverse);
+    applyContainerChanges(m_annotations, delta.annotations, reverse);
+    applyContainerChanges(m_nags, delta.nags, reverse);
+    applyContainerChanges(m_tags, delta.tags, reverse);
+    m_needsCleanup = reverse ? delta.needsCleanupBefore : delta.needsCleanupAfter;
+}
+
+void GameX::mergeDelta(Delta& first, const Delta& second)
+{
+    GameCursor::mergeDelta(first.moves, second.moves);
+    mergeChanges(first.variationStartAnnotations, second.variationStartAnnotations);
+    mergeChanges(first.annotations, second.annotations);
+    mergeChanges(first.nags, second.nags);
+    mergeChanges(first.tags, second.tags);
+    first.needsCleanupAfter = second.needsCleanupAfter;
+}
+
+quint64 GameX::fingerprint(bool annotations) const
+{
+    quint64 fingerprint = m_moves.fingerprint();
+    if (!annotations)
+    {
+        return fingerprint;
+    }
+    fingerprint = fingerprintMix(fingerprint, quint64(m_nags.count()));
+    for (auto it = m_nags.cbegin(); it != m_nags.cend(); ++it)
+    {
+        fingerprint = fingerprintMix(fingerprint, quint32(it.key()));
+        fingerprint = fingerprintMix(fingerprint, quint64(it.value().count()));
+        foreach (Nag nag, it.value())
+        {
+            fingerprint = fingerprintMix(fingerprint, quint32(nag));
+        }
+    }
+    for (const AnnotationMap* map : { &m_annotations, &m_variationStartAnnotations })
+    {
+        fingerprint = fingerprintMix(fingerprint, quint64(map->count()));
+        for (auto it = map->cbegin(); it != map->cend(); ++it)
+        {
+            fingerprint = fingerprintMix(fingerprint, quint32(it.key()));
+            fingerprint = fingerprintMix(fingerprint, it.value());
+        }
+    }
+    return fingerprint;
+}
+
 int GameX::isBetterOrEqual(const GameX& game) const
 {
     return ((m_moves.capacity() >= game.m_moves.capacity()) &&
@@ -11,6 +11,7 @@
 #ifndef GAME_H_INCLUDED
 #define GAME_H_INCLUDED
 
+#include <QHash>
 #include <QObject>
 #include <QRegularExpression>
 #include "annotation.h"
@@ -87,8 +88,6 @@ public :
         FilterAll  = (FilterTan | FilterCan | FilterEval),
     };
 
-    static const QList<QRegularExpression> s_specList;
-
     GameX();
     GameX(const GameX& game);
     GameX& operator=(const GameX& game);
@@ -104,6 +103,9 @@ public :
     int isEqual(const GameX& game) const;
     /** compare game moves and annotations */
     int isBetterOrEqual(const GameX& game) const;
+    /** @return a fingerprint of the moves, and with @p annotations of the comments and nags.
+        Games which are isEqual() have the same fingerprint with annotations. */
+    quint64 fingerprint(bool annotations = true) const;
     /** @return current position */
     const BoardX& board() const;
     /** @return current position in FEN */
@@ -116,6 +118,8 @@ public :
     Result result() const;
     /** @return comment at move at node @p moveId including visual hints for diagrams. */
     QString annotation(MoveId moveId = CURRENT_MOVE, Position position = AfterMove) const;
+    /** @return the nodes which have a comment at @p position. */
+    QList<MoveId> annotatedMoves(Position position = AfterMove) const;
     /** @return comment at move at node @p moveId. */
     static QString cleanAnnotation(QString s, AnnotationFilter f);
     QString textAnnotation(MoveId moveId = CURRENT_MOVE, Position position = AfterMove, AnnotationFilter f = FilterNone) const;
@@ -188,7 +192,7 @@ public :
     MoveId nextMove() const { return m_moves.nextMove(); }
     MoveId parentMove() const { return m_moves.parentMove(); }
     int variationCount(MoveId moveId = CURRENT_MOVE) const { return m_moves.variationCount(moveId); }
-    const QList<MoveId>& variations() const { return m_moves.variations(); }
+    QList<MoveId> variations() const { return m_moves.variations(); }
 
     bool isMainline(MoveId moveId = CURRENT_MOVE) const { return m_moves.isMainline(moveId); }
     bool atLineStart(MoveId moveId = CURRENT_MOVE) const { return m_moves.atLineStart(moveId); }
@@ -239,6 +243,8 @@ public :
     MoveId addMove(const Move& move, const QString& annotation = QString(), NagSet nags = NagSet());
     /** Adds a move at the current position, returns the move id of the added move */
     MoveId dbAddSanMove(const QString& sanMove, const QString& annotation = QString(), NagSet nags = NagSet());
+    /** Adds a move given as @p length bytes of SAN at the current position, returns the move id of the added move */
+    MoveId dbAddSanMove(const char* san, size_t length, const QString& annotation = QString(), NagSet nags = NagSet());
     /** Adds a move at the current position, returns the move id of the added move */
     MoveId addMove(const QString& sanMove, const QString& annotation = QString(), NagSet nags = NagSet());
     /** Adds a move at the current position, returns the move id of the added move */
@@ -273,6 +279,9 @@ public :
     /** Adds a move at the current position as a variation,
      * returns the move id of the added move */
     MoveId dbAddSanVariation(const QString& sanMove, const QString& annotation = QString(), NagSet nags = NagSet());
+    /** Adds a move given as @p length bytes of SAN at the current position as a variation,
+     * returns the move id of the added move */
+    MoveId dbAddSanVariation(const char* san, size_t length, const QString& annotation = QString(), NagSet nags = NagSet());
     /** Merge current node of @p otherGame into this game */
     bool mergeNode(GameX &otherGame);
     /** Merge @p otherGame starting from otherGames current position into this game as a new mainline */
@@ -343,7 +352,7 @@ public :
     /** @return true if the move @p from @p to is already in a variation */
     bool currentNodeHasVariation(chessx::Square from, chessx::Square to) const;
     /** Return the list of variations of the current node */
-    const QList<MoveId>& currentVariations() const;
+    QList<MoveId> currentVariations() const;
 
     /** Evaluate a list of scores for the complete game (mainline only) */
     void scoreMaterial(QList<double> &scores) const;
@@ -368,6 +377,24 @@ public :
     /** Copy in a game and set it as modified (different from operator=) */
     void copyFromGame(const GameX& g);
 
+    /** Reversible difference between two versions of a game, used by the undo history */
+    struct Delta
+    {
+        GameCursor::Delta moves;
+        QList<DeltaChange<MoveId, QString> > variationStartAnnotations;
+        QList<DeltaChange<MoveId, QString> > annotations;
+        QList<DeltaChange<MoveId, NagSet> > nags;
+        QList<DeltaChange<QString, QString> > tags;
+        bool needsCleanupBefore;
+        bool needsCleanupAfter;
+    };
+    /** @return the changes turning @p before into @p after */
+    static Delta diff(const GameX& before, const GameX& after);
+    /** Apply @p delta to this game, or revert it if @p reverse is set. No signal is emitted. */
+    void applyDelta(const Delta& delta, bool reverse = false);
+    /** Combine @p second, which must directly follow @p first, into @p first */
+    static void mergeDelta(Delta& first, const Delta& second);
+
     int resultAsInt() const;
     void setStartingBoard(const BoardX &startingBoard, QString text, bool chess960 = false);
 
@@ -408,6 +435,8 @@ private:
     AnnotationMap m_annotations;
     /** NAGs for move nodes */
     QMap<MoveId, NagSet> m_nags;
+    /** Commands parsed from the annotations, 2 * node for the one before a move, 2 * node + 1 after it */
+    mutable QHash<MoveId, AnnotationCommands> m_commands;
 
     /** Map keeping pgn tags of the game */
     TagMap m_tags;
@@ -418,6 +447,8 @@ private:
     bool m_needsCleanup;
 
     void removeTimeCommentsFromMap(AnnotationMap& map);
+    /** @return the commands of the annotation at @p moveId, parsed again only when its text changed */
+    AnnotationCommands commands(MoveId moveId, Position position) const;
 
     friend class SaveRestoreMove;
 };
@@ -0,0 +1,168 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "guessservice.h"
+
+#include <QMutexLocker>
+
+using namespace chessx;
+
+namespace {
+
+GuessService* s_sharedService = nullptr;
+int s_sharedServiceUsers = 0;
+
+} // namespace
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+#define DEBUG_NEW new( _NORMAL_BLOCK, __FILE__, __LINE__ )
+#define new DEBUG_NEW
+#endif // _MSC_VER
+
+GuessService::GuessService(QObject* parent) :
+    QThread(parent),
+    m_stop(false),
+    m_thinkTime(50),
+    m_generation(0),
+    m_guesses(64)
+{
+}
+
+GuessService::~GuessService()
+{
+    stop();
+}
+
+GuessService* GuessService::acquire()
+{
+    if (!s_sharedServiceUsers++)
+    {
+        s_sharedService = new GuessService;
+    }
+    return s_sharedService;
+}
+
+void GuessService::release()
+{
+    if (!--s_sharedServiceUsers)
+    {
+        delete s_sharedService;
+        s_sharedService = nullptr;
+    }
+}
+
+void GuessService::setBoard(const BoardX& board)
+{
+    QMutexLocker lock(&m_mutex);
+    if (m_board == board && m_generation)
+    {
+        return;
+    }
+    m_board = board;
+    ++m_generation;
+    m_guesses.fill(SquareGuess());
+
+    // Only the squares of the side to move, the ones most likely to be hovered,
+    // are guessed in advance. Other squares are guessed when they are asked for.
+    m_pending.clear();
+    Color toMove = board.toMove();
+    for (int s = a1; s <= h8; ++s)
+    {
+        if (board.colorAt(Square(s)) == toMove)
+        {
+            m_pending.append(Square(s));
+        }
+    }
+
+    m_stop = false;
+    if (!isRunning())
+    {
+        start(QThread::LowPriority);
+    }
+    m_condition.wakeOne();
+}
+
+bool GuessService::guess(const BoardX& board, Square square, Guess::Result& result, Guess::MoveList& moveList)
+{
+    if (square > h8)
+    {
+        return false;
+    }
+    setBoard(board);
+
+    QMutexLocker lock(&m_mutex);
+    const SquareGuess& guess = m_guesses.at(square);
+    if (guess.known)
+    {
+        result = guess.result;
+        moveList = guess.moveList;
+        return true;
+    }
+    // Guess the hovered square next
+    m_pending.removeOne(square);
+    m_pending.prepend(square);
+    m_condition.wakeOne();
+    return false;
+}
+
+void GuessService::stop()
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        m_stop = true;
+        m_pending.clear();
+        m_condition.wakeOne();
+    }
+    wait();
+}
+
+void GuessService::setThinkTime(int value)
+{
+    QMutexLocker lock(&m_mutex);
+    m_thinkTime = value;
+}
+
+void GuessService::run()
+{
+    Guess::Guesser guesser;
+    forever
+    {
+        m_mutex.lock();
+        while (!m_stop && m_pending.isEmpty())
+        {
+            m_condition.wait(&m_mutex);
+        }
+        if (m_stop)
+        {
+            m_mutex.unlock();
+            break;
+        }
+        Square square = m_pending.takeFirst();
+        BoardX board = m_board;
+        int generation = m_generation;
+        int thinkTime = m_thinkTime;
+        m_mutex.unlock();
+
+        SquareGuess guess;
+        guess.result = guesser.guessMove(qPrintable(board.toFen()), board.chess960(), board.castlingRooks(),
+                                         static_cast<Guess::squareT>(square), guess.moveList, thinkTime);
+        guess.known = true;
+
+        m_mutex.lock();
+        // Nothing is kept while guessing is disabled, it may be enabled again for the same board
+        bool current = (generation == m_generation) && Guess::guessAllowed();
+        if (current)
+        {
+            m_guesses[square] = guess;
+        }
+        m_mutex.unlock();
+        if (current)
+        {
+            emit guessFound(square);
+        }
+    }
+}
@@ -0,0 +1,82 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef GUESSSERVICE_H
+#define GUESSSERVICE_H
+
+#include "board.h"
+#include "guess.h"
+#include "square.h"
+
+#include <QList>
+#include <QMutex>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+
+/** @ingroup Core
+The GuessService class guesses the moves for the squares of a board on a
+thread of its own.
+
+As soon as a board is set, the service guesses the best move from every
+square of the side to move. Asking for a square which has been guessed
+already is a lookup. Any other square is guessed next and guessFound() is
+emitted when it is done. The service uses the same Guess::Guesser for all
+boards, so its hash tables are kept from one position to the next.
+
+All boards share one service, see acquire(). */
+class GuessService : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit GuessService(QObject* parent = nullptr);
+    ~GuessService();
+
+    /** @return the service shared by all boards, created for its first user */
+    static GuessService* acquire();
+    /** Give back the service got from acquire(), it is deleted after its last user */
+    static void release();
+
+    /** Start guessing the moves of @p board, dropping the guesses of the previous board */
+    void setBoard(const BoardX& board);
+    /** Get the guess for @p square of @p board.
+        @return false if it is not known yet, guessFound() follows when it is */
+    bool guess(const BoardX& board, chessx::Square square, Guess::Result& result, Guess::MoveList& moveList);
+    /** Stop guessing, the thread is finished when the function returns */
+    void stop();
+    void setThinkTime(int value);
+
+signals:
+    /** The guess for @p square of the current board is known */
+    void guessFound(int square);
+
+protected:
+    virtual void run();
+
+private:
+    struct SquareGuess
+    {
+        SquareGuess() : known(false) {}
+        bool known;
+        Guess::Result result;
+        Guess::MoveList moveList;
+    };
+
+    QMutex m_mutex;
+    QWaitCondition m_condition;
+    bool m_stop;
+    int m_thinkTime;
+    BoardX m_board;
+    /** Changes with every new board, guesses for an older board are dropped */
+    int m_generation;
+    QVector<SquareGuess> m_guesses;
+    /** Squares still to be guessed, in order */
+    QList<chessx::Square> m_pending;
+};
+
+#endif // GUESSSERVICE_H
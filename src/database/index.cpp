@@ -9,6 +9,7 @@
  *   (at your option) any later version.                                   *
  ***************************************************************************/
 
+#include <algorithm>
 #include <QtDebug>
 #include <QFile>
 #include <QDataStream>
@@ -19,6 +20,7 @@
 #include <QRegularExpression>
 #include <QVector>
 
+#include "fingerprint.h"
 #include "index.h"
 #include "tags.h"
 
@@ -29,7 +31,7 @@ using namespace chessx;
 #define new DEBUG_NEW
 #endif // _MSC_VER
 
-IndexX::IndexX() : m_mutex(QReadWriteLock::Recursive)
+IndexX::IndexX() : m_count(0), m_valueIndexValid(1), m_mutex(QReadWriteLock::Recursive)
 {
     // Dummy Values in case a index is miscalculated
     init();
@@ -42,9 +44,7 @@ IndexX::~IndexX()
 GameId IndexX::add()
 {
     QWriteLocker m(&m_mutex);
-    GameId gameId = m_indexItems.count();
-    m_indexItems.insert(gameId, IndexItem());
-    return gameId;
+    return m_count++;
 }
 
 TagIndex IndexX::AddTagName(const QString& name)
@@ -56,35 +56,24 @@ TagIndex IndexX::AddTagName(const QString& name)
     TagIndex n = m_tagNameIndex.size();
     m_tagNameIndex[name] = n;
     m_tagNames[n] = name;
+    if ((int)n >= m_columns.count())
+    {
+        m_columns.resize(n + 1);
+    }
     return n;
 }
 
 ValueIndex IndexX::AddTagValue(QString name)
 {
-    ValueIndex n = qHash(name);
-    if (m_tagValues.contains(n))
+    calculateValueIndex();
+    auto it = m_valueIndex.constFind(name);
+    if (it != m_valueIndex.constEnd())
     {
-        if (m_tagValues[n] == name)
-        {
-            return n;
-        }
-        name.append(QChar(0));
-        QString prelim;
-        int i = 0;
-        do {
-            prelim = name + QString::number(i++);
-            n = qHash(prelim);
-            if (m_tagValues.contains(n))
-            {
-                if (m_tagValues[n] == prelim)
-                {
-                    return n;
-                }
-            }
-        } while(m_tagValues.contains(n));
-        name = prelim;
+        return it.value();
     }
-    m_tagValues[n] = name;
+    ValueIndex n = valueCount();
+    m_addedValues.append(name);
+    m_valueIndex.insert(name, n);
     return n;
 }
 
@@ -99,11 +88,13 @@ void IndexX::setTag_nolock(const QString& tagName, const QString& value, GameId
 	TagIndex tagIndex = AddTagName(tagName);
 	ValueIndex valueIndex = AddTagValue(value);
 
-	if (m_indexItems.count() <= (int)gameId)
+	if (m_count <= (int)gameId)
 	{
-		(void) add();
+		m_count = gameId + 1;
 	}
-	m_indexItems[gameId].set(tagIndex, valueIndex);
+	updateValueGames(tagIndex, m_columns[tagIndex].value(gameId, ValueMissing), valueIndex, gameId);
+	m_columns[tagIndex].set(gameId, valueIndex);
+	updateSortRank(tagIndex, valueIndex, gameId);
 }
 
 void IndexX::removeTag(const QString& tagName, GameId gameId)
@@ -112,9 +103,11 @@ void IndexX::removeTag(const QString& tagName, GameId gameId)
     if(m_tagNameIndex.contains(tagName))
     {
         TagIndex tagIndex = m_tagNameIndex.value(tagName);
-        if((int)gameId < m_indexItems.count())
+        if((int)gameId < m_columns[tagIndex].count())
         {
-            m_indexItems[gameId].remove(tagIndex);
+            updateValueGames(tagIndex, m_columns[tagIndex].at(gameId), ValueMissing, gameId);
+            m_columns[tagIndex].set(gameId, ValueMissing);
+            updateSortRank(tagIndex, ValueMissing, gameId);
         }
     }
 }
@@ -145,30 +138,78 @@ bool IndexX::replaceTagValue(const QStringList& tags, const QString& newValue, c
         }
     }
     ValueIndex valueIndex = getValueIndex(oldValue);
-    if(!ok || !m_tagValues.contains(valueIndex))
+    if(!ok || valueIndex == ValueNoIndex)
     {
         return false;
     }
-    ValueIndex newIndex = getValueIndex(newValue);
-
-    if (!m_tagValues.contains(newIndex))
+    ValueIndex newIndex = AddTagValue(newValue);
+    if(newIndex == valueIndex)
     {
-        (void) AddTagValue(newValue); // Adds newIndex-newValue pair, return must be newIndex
+        return true;
     }
 
-    QList<TagIndex> tl;
     foreach (QString t, tags)
     {
-        tl << getTagIndex(t);
+        TagIndex tagIndex = getTagIndex(t);
+        if(tagIndex == TagNoIndex)
+        {
+            continue;
+        }
+        MappedArray<ValueIndex>& column = m_columns[tagIndex];
+        for(int i = 0; i < column.count(); ++i)
+        {
+            if(column.at(i) == valueIndex)
+            {
+                column.set(i, newIndex);
+            }
+        }
+    }
+    m_sortRanks.clear();
+    m_valueGames.clear();
+
+    // The text stays in the value pool, but it can no longer be found
+    m_valueIndex.remove(oldValue);
+    return true;
+}
+
+int IndexX::replaceTagValues(const QString& tagName, const QHash<QString, QString>& replacements)
+{
+    QWriteLocker m(&m_mutex);
+
+    if(!m_tagNameIndex.contains(tagName) || replacements.isEmpty())
+    {
+        return 0;
     }
+    TagIndex tagIndex = getTagIndex(tagName);
 
-     for (auto i = m_indexItems.begin(); i != m_indexItems.end(); ++i)
+    QHash<ValueIndex, ValueIndex> valueIndices;
+    for (auto it = replacements.cbegin(); it != replacements.cend(); ++it)
     {
-        i->replaceValue(tl, valueIndex, newIndex);
+        ValueIndex valueIndex = getValueIndex(it.key());
+        if (valueIndex == ValueNoIndex)
+        {
+            continue;
+        }
+        valueIndices.insert(valueIndex, AddTagValue(it.value()));
     }
 
-    m_tagValues.remove(valueIndex);
-    return true;
+    int changed = 0;
+    MappedArray<ValueIndex>& column = m_columns[tagIndex];
+    for (int i = 0; i < column.count(); ++i)
+    {
+        auto replacement = valueIndices.constFind(column.at(i));
+        if (replacement != valueIndices.constEnd() && replacement.value() != column.at(i))
+        {
+            column.set(i, replacement.value());
+            ++changed;
+        }
+    }
+    if (changed)
+    {
+        m_sortRanks.clear();
+        m_valueGames.clear();
+    }
+    return changed;
 }
 
 bool IndexX::isValidFlag(GameId gameId) const
@@ -182,47 +223,142 @@ bool IndexX::write(QDataStream &out) const
     QReadLocker m(&m_mutex);
 
     out << m_tagNames;
-    out << m_tagValues;
-	out << m_indexItems;
+    out << qint32(m_count);
+
+    // The value pool as UTF-8 texts and their boundaries, values read from the file are copied as they are
+    QVector<quint32> offsets;
+    offsets.reserve(valueCount() + 1);
+    for (int i = 0; i < mappedValueCount(); ++i)
+    {
+        offsets.append(m_valueOffsets.at(i));
+    }
+    QByteArray text(m_valueText.constData(), m_valueText.count());
+    foreach (const QString& value, m_addedValues)
+    {
+        offsets.append(quint32(text.size()));
+        text.append(value.toUtf8());
+    }
+    offsets.append(quint32(text.size()));
+    writeMappedArray(out, offsets.constData(), offsets.count());
+    writeMappedArray(out, text.constData(), text.size());
+
+    out << qint32(m_columns.count());
+    foreach (const MappedArray<ValueIndex>& column, m_columns)
+    {
+        writeMappedArray(out, column);
+    }
     out << m_validFlags;
 
     bool extension = false;
     out << extension;
 
-    return true;
+    return out.status() == QDataStream::Ok;
 }
 
 void IndexX::reserve(quint32 estimation)
 {
-    m_tagValues.reserve(estimation+16);
+    m_addedValues.reserve(estimation + 16);
+    m_valueIndex.reserve(estimation + 16);
 }
 
 void IndexX::squeeze()
 {
-    m_tagValues.squeeze();
+    m_addedValues.squeeze();
+    m_valueIndex.squeeze();
+    for (auto it = m_columns.begin(); it != m_columns.end(); ++it)
+    {
+        it->squeeze();
+    }
 }
 
-bool IndexX::read(QDataStream &in, volatile bool *breakFlag, short version)
+bool IndexX::read(QDataStream &in, const QSharedPointer<const FileMapping>& mapping, volatile bool *breakFlag, short version)
 {
     Q_UNUSED(version);
 
     QWriteLocker m(&m_mutex);
 
+    m_signatures.clear();
+    m_sortRanks.clear();
+    m_valueGames.clear();
+    m_tagNameIndex.clear();
+    m_columns.clear();
+    m_addedValues.clear();
+    m_valueIndex.clear();
+    m_valueIndexValid.storeRelease(0);
+
+    qint32 count;
+    qint32 columns;
     in >> m_tagNames;
-    in >> m_tagValues;
-	in >> m_indexItems;
+    in >> count;
+    bool ok = mapping && readMappedArray(in, mapping, m_valueOffsets) && readMappedArray(in, mapping, m_valueText);
+    in >> columns;
+    ok = ok && in.status() == QDataStream::Ok && count >= 0 && columns >= 0 && !m_valueOffsets.isEmpty();
+
+    // Offsets are checked here, so that looking up a value needs no checks
+    for (int i = 0; ok && i < m_valueOffsets.count(); ++i)
+    {
+        ok = (m_valueOffsets.at(i) <= (quint32)m_valueText.count()) && (!i || m_valueOffsets.at(i - 1) <= m_valueOffsets.at(i));
+    }
+    m_columns.resize(qMax(columns, m_tagNames.count()));
+    for (int i = 0; ok && i < columns; ++i)
+    {
+        ok = readMappedArray(in, mapping, m_columns[i]);
+    }
     in >> m_validFlags;
-    
-	bool extension;
+
+    bool extension;
     in >> extension;
+    m_count = count;
 
-    m_tagNameIndex.clear();
+    if (!ok || in.status() != QDataStream::Ok)
+    {
+        return false;
+    }
 
     calculateCache(breakFlag);
 
     return !(*breakFlag);
 }
 
+void IndexX::detach()
+{
+    QWriteLocker m(&m_mutex);
+    m_valueOffsets.detach();
+    m_valueText.detach();
+    for (auto it = m_columns.begin(); it != m_columns.end(); ++it)
+    {
+        it->detach();
+    }
+}
+
+void IndexX::setSignature(GameId gameId, const GameSignature& signature)
+{
+    QWriteLocker m(&m_mutex);
+    if ((int)gameId >= m_signatures.count())
+    {
+        m_signatures.resize(gameId + 1);
+    }
+    m_signatures[gameId] = signature;
+}
+
+bool IndexX::hasSignature(GameId gameId) const
+{
+    QReadLocker m(&m_mutex);
+    return (int)gameId < m_signatures.count() && m_signatures[gameId].isValid();
+}
+
+GameSignature IndexX::signature(GameId gameId) const
+{
+    QReadLocker m(&m_mutex);
+    return ((int)gameId < m_signatures.count()) ? m_signatures[gameId] : GameSignature();
+}
+
+bool IndexX::canContainPosition(GameId gameId, const BoardX& position) const
+{
+    QReadLocker m(&m_mutex);
+    return (int)gameId >= m_signatures.count() || m_signatures[gameId].canContain(position);
+}
+
 void IndexX::clearCache()
 {
     QWriteLocker m(&m_mutex);
@@ -249,8 +385,41 @@ void IndexX::calculateReverseMaps(volatile bool* breakFlag)
     }
 }
 
+void IndexX::calculateValueIndex() const
+{
+    if (m_valueIndexValid.loadAcquire())
+    {
+        return;
+    }
+    QMutexLocker m(&m_valueIndexMutex);
+    if (!m_valueIndexValid.loadAcquire())
+    {
+        int values = valueCount();
+        m_valueIndex.reserve(values);
+        for (int i = ValueMissing + 1; i < values; ++i)
+        {
+            m_valueIndex.insert(tagValueName(i), i);
+        }
+        m_valueIndexValid.storeRelease(1);
+    }
+}
+
+int IndexX::valueCount() const
+{
+    return mappedValueCount() + m_addedValues.count();
+}
+
+int IndexX::mappedValueCount() const
+{
+    return qMax(0, m_valueOffsets.count() - 1);
+}
+
 void IndexX::init()
 {
+    if (!valueCount())
+    {
+        m_addedValues.append(QString()); // ValueMissing
+    }
     AddTagName("?");
     AddTagValue("?");
 }
@@ -258,72 +427,100 @@ void IndexX::init()
 void IndexX::clear()
 {
     QWriteLocker m(&m_mutex);
-    m_indexItems.clear();
+    m_count = 0;
+    m_columns.clear();
     m_tagNames.clear();
     m_tagNameIndex.clear();
-    m_tagValues.clear();
+    m_valueOffsets.clear();
+    m_valueText.clear();
+    m_addedValues.clear();
+    m_valueIndex.clear();
+    m_valueIndexValid.storeRelease(1);
     m_deletedGames.clear();
     m_validFlags.clear();
+    m_sortRanks.clear();
+    m_valueGames.clear();
+    m_signatures.clear();
     init(); // Just to make sure that the index can be used after clearing
 }
 
 int IndexX::count() const
 {
-    return m_indexItems.count();
+    return m_count;
 }
 
-QBitArray IndexX::listInSet(const QString& tagName, const QSet<QString>& set) const
+template<class Predicate>
+QBitArray IndexX::listMatchingValues(TagIndex tagIndex, Predicate predicate) const
 {
-    QReadLocker m(&m_mutex);
-
-    TagIndex tagIndex = m_tagNameIndex.value(tagName);
+    // Games share few distinct values, each is tested once and its result is looked up for the others
+    const int values = valueCount();
+    QVector<qint8> matches(values, -1);
+    const MappedArray<ValueIndex>* column = (tagIndex < (TagIndex)m_columns.count()) ? &m_columns[tagIndex] : nullptr;
 
     QBitArray list(count(), false);
     for(int i = 0; i < count(); ++i)
     {
-        QString value = tagValue(tagIndex, i);
-        bool b = false;
+        ValueIndex valueIndex = column ? column->value(i, ValueMissing) : ValueMissing;
+        if (valueIndex >= (ValueIndex)values)
+        {
+            valueIndex = ValueMissing;
+        }
+        qint8& match = matches[valueIndex];
+        if (match < 0)
+        {
+            match = predicate(tagValueName(valueIndex)) ? 1 : 0;
+        }
+        if (match)
+        {
+            list.setBit(i);
+        }
+    }
+    return list;
+}
+
+QBitArray IndexX::listInSet(const QString& tagName, const QSet<QString>& set) const
+{
+    QReadLocker m(&m_mutex);
+
+    return listMatchingValues(getTagIndex(tagName), [&set](const QString& value)
+    {
         foreach(QString s, set)
         {
             if (value.contains(s, Qt::CaseInsensitive))
             {
-                b = true;
-                break;
+                return true;
             }
         }
-        list.setBit(i, b);
-    }
-    return list;
+        return false;
+    });
 }
 
 QBitArray IndexX::listInRange(const QString& tagName, const QString& minValue, const QString& maxValue) const
 {
     QReadLocker m(&m_mutex);
 
-    TagIndex tagIndex = m_tagNameIndex.value(tagName);
-
-    QBitArray list(count(), false);
-    for(int i = 0; i < count(); ++i)
+    return listMatchingValues(getTagIndex(tagName), [&minValue, &maxValue](const QString& value)
     {
-        QString value = tagValue(tagIndex, i);
-        list.setBit(i, (minValue <= value) && (value <= maxValue));
-    }
-    return list;
+        return (minValue <= value) && (value <= maxValue);
+    });
 }
 
 QBitArray IndexX::listInRange(const QString &tagName, int minValue, int maxValue) const
 {
     QReadLocker m(&m_mutex);
 
-    TagIndex tagIndex = m_tagNameIndex.value(tagName);
-
-    QBitArray list(count(), false);
-    for(int i = 0; i < count(); ++i)
+    return listMatchingValues(getTagIndex(tagName), [minValue, maxValue](const QString& value)
     {
-        int value = tagValue(tagIndex, i).toInt();
-        list.setBit(i, (minValue <= value) && (value <= maxValue));
-    }
-    return list;
+        int number = value.toInt();
+        return (minValue <= number) && (number <= maxValue);
+    });
+}
+
+QBitArray IndexX::listMatching(const QString& tagName, const std::function<bool(const QString&)>& predicate) const
+{
+    QReadLocker m(&m_mutex);
+
+    return listMatchingValues(getTagIndex(tagName), predicate);
 }
 
 QBitArray IndexX::listPartialValue(const QString& tagName, QString value) const
@@ -332,32 +529,193 @@ QBitArray IndexX::listPartialValue(const QString& tagName, QString value) const
     value.replace("-","\\-"); // Avoid - to become range
     value.replace("(","\\("); // Avoid () to become regex
     value.replace(")","\\)");
-    TagIndex tagIndex = m_tagNameIndex.value(tagName);
     QRegularExpression re(value);
     re.setPatternOptions(QRegularExpression::CaseInsensitiveOption);
-    QBitArray list(count(), false);
+    return listMatchingValues(getTagIndex(tagName), [&re](const QString& gameValue)
+    {
+        return gameValue.contains(re);
+    });
+}
+
+QVector<quint32> IndexX::sortRanks(const QString& tagName, bool numeric) const
+{
+    QWriteLocker m(&m_mutex);
+
+    TagIndex tagIndex = getTagIndex(tagName);
+    if(tagIndex == TagNoIndex)
+    {
+        return QVector<quint32>(count(), 0);
+    }
+
+    auto it = m_sortRanks.find(tagIndex);
+    if(it != m_sortRanks.end() && it->numeric == numeric)
+    {
+        // Games appended since the last call, as long as they reuse known values
+        while(it->gameRanks.count() < count())
+        {
+            auto rank = it->valueRanks.constFind(valueIndexFromIndex(tagIndex, it->gameRanks.count()));
+            if(rank == it->valueRanks.constEnd())
+            {
+                break;
+            }
+            it->gameRanks.append(*rank);
+        }
+        if(it->gameRanks.count() == count())
+        {
+            return it->gameRanks;
+        }
+    }
+
+    calculateSortRanks(tagIndex, numeric);
+    return m_sortRanks.value(tagIndex).gameRanks;
+}
+
+void IndexX::calculateSortRanks(TagIndex tagIndex, bool numeric) const
+{
+    SortRanks& ranks = m_sortRanks[tagIndex];
+    ranks.numeric = numeric;
+    ranks.valueRanks.clear();
+    ranks.gameRanks.resize(count());
+
+    // Sort the distinct values only, there are far less of them than games
+    QVector<ValueIndex> values;
     for(int i = 0; i < count(); ++i)
     {
-        QString gameValue = tagValue(tagIndex, i);
-        list.setBit(i, gameValue.contains(re));
+        ValueIndex valueIndex = valueIndexFromIndex(tagIndex, i);
+        if(!ranks.valueRanks.contains(valueIndex))
+        {
+            ranks.valueRanks.insert(valueIndex, 0);
+            values.append(valueIndex);
+        }
+    }
+
+    QVector<QPair<QString, ValueIndex> > texts;
+    QVector<QPair<int, ValueIndex> > numbers;
+    foreach(ValueIndex valueIndex, values)
+    {
+        QString value = tagValueName(valueIndex);
+        if(numeric)
+        {
+            numbers.append(qMakePair(value.toInt(), valueIndex));
+        }
+        else
+        {
+            texts.append(qMakePair(value == "?" ? QString() : value, valueIndex));
+        }
+    }
+    std::sort(texts.begin(), texts.end());
+    std::sort(numbers.begin(), numbers.end());
+
+    quint32 rank = 0;
+    for(int i = 0; i < texts.count(); ++i)
+    {
+        if(i && texts[i].first != texts[i - 1].first)
+        {
+            ++rank;
+        }
+        ranks.valueRanks[texts[i].second] = rank;
+    }
+    for(int i = 0; i < numbers.count(); ++i)
+    {
+        if(i && numbers[i].first != numbers[i - 1].first)
+        {
+            ++rank;
+        }
+        ranks.valueRanks[numbers[i].second] = rank;
+    }
+
+    for(int i = 0; i < count(); ++i)
+    {
+        ranks.gameRanks[i] = ranks.valueRanks.value(valueIndexFromIndex(tagIndex, i));
+    }
+}
+
+void IndexX::updateSortRank(TagIndex tagIndex, ValueIndex valueIndex, GameId gameId)
+{
+    auto it = m_sortRanks.find(tagIndex);
+    if(it == m_sortRanks.end())
+    {
+        return;
+    }
+    auto rank = it->valueRanks.constFind(valueIndex);
+    if(rank == it->valueRanks.constEnd())
+    {
+        // A new value would shift the ranks of all greater values
+        m_sortRanks.erase(it);
+    }
+    else if((int)gameId < it->gameRanks.count())
+    {
+        it->gameRanks[gameId] = *rank;
+    }
+}
+
+QVector<GameId> IndexX::gamesWithValue(const QString& tagName, ValueIndex valueIndex) const
+{
+    QWriteLocker m(&m_mutex);
+
+    TagIndex tagIndex = getTagIndex(tagName);
+    if(tagIndex == TagNoIndex || valueIndex == ValueMissing || valueIndex == ValueNoIndex)
+    {
+        return QVector<GameId>();
+    }
+
+    auto it = m_valueGames.find(tagIndex);
+    if(it == m_valueGames.end())
+    {
+        it = m_valueGames.insert(tagIndex, QHash<ValueIndex, QVector<GameId> >());
+        const MappedArray<ValueIndex>& column = m_columns[tagIndex];
+        for(int i = 0; i < column.count(); ++i)
+        {
+            if(column.at(i) != ValueMissing)
+            {
+                (*it)[column.at(i)].append(GameId(i));
+            }
+        }
+    }
+    return it->value(valueIndex);
+}
+
+void IndexX::updateValueGames(TagIndex tagIndex, ValueIndex oldValue, ValueIndex newValue, GameId gameId)
+{
+    auto it = m_valueGames.find(tagIndex);
+    if(it == m_valueGames.end() || oldValue == newValue)
+    {
+        return;
+    }
+    if(oldValue != ValueMissing)
+    {
+        QVector<GameId>& games = (*it)[oldValue];
+        auto pos = std::lower_bound(games.begin(), games.end(), gameId);
+        if(pos != games.end() && *pos == gameId)
+        {
+            games.erase(pos);
+        }
+    }
+    if(newValue != ValueMissing)
+    {
+        // Appended games go to the end, replaced ones are inserted in order
+        QVector<GameId>& games = (*it)[newValue];
+        if(games.isEmpty() || games.last() < gameId)
+        {
+            games.append(gameId);
+        }
+        else
+        {
+            games.insert(std::lower_bound(games.begin(), games.end(), gameId), gameId);
+        }
     }
-    return list;
 }
 
 QString IndexX::tagValue_byIndex(TagIndex tagIndex, GameId gameId) const
 {
     QReadLocker m(&m_mutex);
 
-    ValueIndex valueIndex = m_indexItems[gameId].valueIndex(tagIndex);
-
-    return tagValueName(valueIndex);
+    return tagValueName(valueIndexFromIndex(tagIndex, gameId));
 }
 
 QString IndexX::tagValue(TagIndex tagIndex, GameId gameId) const
 {
-    ValueIndex valueIndex = m_indexItems[gameId].valueIndex(tagIndex);
-
-    return tagValueName(valueIndex);
+    return tagValueName(valueIndexFromIndex(tagIndex, gameId));
 }
 
 QString IndexX::tagName(TagIndex tagIndex) const
@@ -367,8 +725,14 @@ QString IndexX::tagName(TagIndex tagIndex) const
 
 QString IndexX::tagValueName(ValueIndex valueIndex) const
 {
-    QString r = m_tagValues.value(valueIndex);
-    return r.section(QChar(0),0,0);
+    ValueIndex mapped = mappedValueCount();
+    if (valueIndex < mapped)
+    {
+        quint32 begin = m_valueOffsets.at(valueIndex);
+        return QString::fromUtf8(m_valueText.constData() + begin, int(m_valueOffsets.at(valueIndex + 1) - begin));
+    }
+    valueIndex -= mapped;
+    return (valueIndex < (ValueIndex)m_addedValues.count()) ? m_addedValues.at(valueIndex) : QString();
 }
 
 QString IndexX::tagValue(const QString& tagName, GameId gameId) const
@@ -387,12 +751,12 @@ ValueIndex IndexX::valueIndexFromTag(const QString& tagName, GameId gameId) cons
 
 bool IndexX::indexItemHasTag(TagIndex tagIndex, GameId gameId) const
 {
-    return m_indexItems[gameId].hasTagIndex(tagIndex);
+    return valueIndexFromIndex(tagIndex, gameId) != ValueMissing;
 }
 
 inline ValueIndex IndexX::valueIndexFromIndex(TagIndex tagIndex, GameId gameId) const
 {
-    return m_indexItems[gameId].valueIndex(tagIndex);
+    return (tagIndex < (TagIndex)m_columns.count()) ? m_columns[tagIndex].value(gameId, ValueMissing) : ValueMissing;
 }
 
 TagIndex IndexX::getTagIndex(const QString& value) const
@@ -406,31 +770,8 @@ TagIndex IndexX::getTagIndex(const QString& value) const
 
 ValueIndex IndexX::getValueIndex(QString name) const
 {
-    ValueIndex n = qHash(name);
-
-    if (m_tagValues.contains(n))
-    {
-        if (m_tagValues[n] == name)
-        {
-            return n;
-        }
-        name.append(QChar(0));
-        QString prelim;
-        int i = 0;
-        do {
-            prelim = name + QString::number(i++);
-            n = qHash(prelim);
-            if (m_tagValues.contains(n))
-            {
-                if (m_tagValues[n] == prelim)
-                {
-                    return n;
-                }
-            }
-        } while(m_tagValues.contains(n));
-    }
-
-    return n;
+    calculateValueIndex();
+    return m_valueIndex.value(name, ValueNoIndex);
 }
 
 unsigned int IndexX::hashIndexItem(GameId gameId) const
@@ -441,9 +782,25 @@ unsigned int IndexX::hashIndexItem(GameId gameId) const
 bool IndexX::isIndexItemEqual(GameId i, GameId j) const
 {
     QReadLocker m(&m_mutex);
-    const IndexItem& iItem = m_indexItems.value(i);
-    const IndexItem& jItem = m_indexItems.value(j);
-    return (iItem.isEqual(jItem));
+    foreach (const MappedArray<ValueIndex>& column, m_columns)
+    {
+        if (column.value(i, ValueMissing) != column.value(j, ValueMissing))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+quint64 IndexX::fingerprintIndexItem(GameId gameId) const
+{
+    QReadLocker m(&m_mutex);
+    quint64 fingerprint = FingerprintSeed;
+    foreach (const MappedArray<ValueIndex>& column, m_columns)
+    {
+        fingerprint = fingerprintMix(fingerprint, column.value(gameId, ValueMissing));
+    }
+    return fingerprint;
 }
 
 void IndexX::loadGameHeaders(GameId id, GameX& game) const
@@ -451,10 +808,13 @@ void IndexX::loadGameHeaders(GameId id, GameX& game) const
     QReadLocker m(&m_mutex);
 
     game.clearTags();
-    foreach(TagIndex tagIndex, m_indexItems[id].getTagIndices())
+    for (TagIndex tagIndex = 0; tagIndex < (TagIndex)m_columns.count(); ++tagIndex)
     {
-        // qDebug() << "lGH>" << &game << " " << id << " " << tagName(tagIndex) << " " << tagValue(tagIndex, id);
-        game.setTag(tagName(tagIndex), tagValue(tagIndex, id));
+        ValueIndex valueIndex = m_columns[tagIndex].value(id, ValueMissing);
+        if (valueIndex != ValueMissing)
+        {
+            game.setTag(tagName(tagIndex), tagValueName(valueIndex));
+        }
     }
 }
 
@@ -476,21 +836,19 @@ QStringList IndexX::playerNames() const
     TagIndex tagIndex = getTagIndex(TagNameWhite);
     if(tagIndex != TagNoIndex)
     {
-        QVector<IndexItem>::const_iterator i;
-		for (i = m_indexItems.constBegin(); i != m_indexItems.constEnd(); ++i)
-		{
-            playerNameIndex.insert(i->valueIndex(tagIndex));
-		}
+        for (int i = 0; i < m_count; ++i)
+        {
+            playerNameIndex.insert(valueIndexFromIndex(tagIndex, i));
+        }
     }
 
     tagIndex = getTagIndex(TagNameBlack);
     if(tagIndex != TagNoIndex)
     {
-        QVector<IndexItem>::const_iterator i;
-		for (i = m_indexItems.constBegin(); i != m_indexItems.constEnd(); ++i)
-		{
-            playerNameIndex.insert(i->valueIndex(tagIndex));
-		}
+        for (int i = 0; i < m_count; ++i)
+        {
+            playerNameIndex.insert(valueIndexFromIndex(tagIndex, i));
+        }
 	}
 
     foreach(ValueIndex valueIndex, playerNameIndex)
@@ -510,11 +868,10 @@ QSet<ValueIndex> IndexX::tagValueSet(const QString& tagName) const
 
 	if (tagIndex != TagNoIndex)
 	{
-        QVector<IndexItem>::const_iterator i;
-		for (i = m_indexItems.constBegin(); i != m_indexItems.constEnd(); ++i)
-		{
-            tagNameIndex.insert(i->valueIndex(tagIndex));
-		}
+        for (int i = 0; i < m_count; ++i)
+        {
+            tagNameIndex.insert(valueIndexFromIndex(tagIndex, i));
+        }
 	}
 	return tagNameIndex;
 }
@@ -12,14 +12,21 @@
 #ifndef INDEX_H_INCLUDED
 #define INDEX_H_INCLUDED
 
+#include <functional>
+
+#include <QAtomicInt>
 #include <QList>
+#include <QMutex>
 #include <QPair>
 #include <QObject>
 #include <QSet>
 #include <QReadWriteLock>
+#include <QSharedPointer>
 #include <QVector>
 
 #include "indexitem.h"
+#include "mappedarray.h"
+#include "gamesignature.h"
 #include "gamex.h"
 #include "gameid.h"
 
@@ -27,15 +34,20 @@
 #define VERSION_INDEX_1_3 0x0002
 #define VERSION_INDEX_1_4 0x0101
 #define VERSION_INDEX_1_5 0x0201
-#define VERSION_INDEX_CURRENT VERSION_INDEX_1_5
+#define VERSION_INDEX_2_0 0x0301
+#define VERSION_INDEX_2_1 0x0302
+#define VERSION_INDEX_CURRENT VERSION_INDEX_2_1
 
 #define INDEX_FILE_MAGIC 0xce55
 
 /** @ingroup Database
- * The Index class holds a list of IndexItem instances, typically one
- * for each game in the current database. This enables fast access to
- * game header information.
+ * The Index class holds the header information of all games in the current
+ * database for fast access. Tag values are stored once in a value pool, and
+ * each tag has a column holding the ValueIndex of every game.
  *
+ * Columns and the value pool are flat arrays. When the index is read from an
+ * index file they are used in place from the mapped file, so that opening a
+ * database does not deserialise the index game by game.
  */
 
 class IndexX : public QObject
@@ -64,6 +76,9 @@ public:
 
     /** Set the valid flag accordingly */
     bool replaceTagValue(const QStringList &tags, const QString& newValue, const QString& oldValue);
+    /** Replace each value of @p tagName found in @p replacements (old to new) in a single pass.
+        @return the number of games changed */
+    int replaceTagValues(const QString& tagName, const QHash<QString, QString>& replacements);
 
     // Retrieving tags //
     //
@@ -121,14 +136,34 @@ public:
     /** Returns a bit array to indicate which games in index have a tag value in @p set */
     QBitArray listInSet(const QString& tagName, const QSet<QString>& set) const;
 
+    /** Returns a bit array to indicate which games in index have a tag value accepted by @p predicate.
+        The predicate is called once per distinct value, games without the tag pass an empty value. */
+    QBitArray listMatching(const QString& tagName, const std::function<bool(const QString&)>& predicate) const;
+
+    // Sorting //
+    //
+    /** @ret the rank of each game when sorted by @p tagName. Games with equal values share a rank.
+        Numeric tags are ordered by their integer value, all others by the tag text with "?" as empty. */
+    QVector<quint32> sortRanks(const QString& tagName, bool numeric) const;
+
+    // Statistics //
+    //
+    /** @ret the games whose tag @p tagName has the value @p valueIndex, in ascending order.
+        The lists of all values of a tag are built in one pass on first use and kept up to date
+        when games change, so that statistics need to look only at the games concerned. */
+    QVector<GameId> gamesWithValue(const QString& tagName, ValueIndex valueIndex) const;
+
     // Utility //
     //
 
     /** Write the index to disk, using m_filename */
     bool write(QDataStream& out) const;
 
-    /** Read the index from disk, using m_filename */
-    bool read(QDataStream& in, volatile bool *breakFlag, short version);
+    /** Read the index from disk, using m_filename. The arrays are used in place from @p mapping, which maps the file read by @p in */
+    bool read(QDataStream& in, const QSharedPointer<const FileMapping>& mapping, volatile bool *breakFlag, short version);
+
+    /** Copy the data used in place from the index file into memory, e.g. before the file is replaced */
+    void detach();
 
     /** Clear all cached values */
     void clearCache();
@@ -154,6 +189,21 @@ public:
     /** Calculate hash for a game header */
     bool isIndexItemEqual(GameId i, GameId j) const;
 
+    /** @ret a fingerprint of all tag values of game @p gameId, the same for games which are isIndexItemEqual() */
+    quint64 fingerprintIndexItem(GameId gameId) const;
+
+    /** Store the signature of the main line of game @p gameId */
+    void setSignature(GameId gameId, const GameSignature& signature);
+
+    /** @ret true if a signature was stored for game @p gameId */
+    bool hasSignature(GameId gameId) const;
+
+    /** @ret the signature stored for game @p gameId, an invalid one if there is none */
+    GameSignature signature(GameId gameId) const;
+
+    /** @ret false if the stored signature of game @p gameId rules out that @p position occurs in its main line */
+    bool canContainPosition(GameId gameId, const BoardX& position) const;
+
     /** Squeeze internal structures */
     void squeeze();
 
@@ -168,6 +218,15 @@ private:
     /** Calculate missing data from the index file import */
     void calculateReverseMaps(volatile bool *breakFlag);
 
+    /** Build the map from values to their indices, which is not stored in the index file */
+    void calculateValueIndex() const;
+
+    /** @ret the number of values in the value pool */
+    int valueCount() const;
+
+    /** @ret the number of values used in place from the index file */
+    int mappedValueCount() const;
+
     /** Add a tag name to the index */
     TagIndex AddTagName(const QString &);
 
@@ -189,6 +248,20 @@ private:
     /** @ret true if a game @p gameId has a given tag index */
     bool indexItemHasTag(TagIndex tagIndex, GameId gameId) const;
 
+    /** Keep the sort ranks of @p tagIndex up to date after a game changed its value */
+    void updateSortRank(TagIndex tagIndex, ValueIndex valueIndex, GameId gameId);
+
+    /** Move @p gameId from the game list of @p oldValue to the one of @p newValue */
+    void updateValueGames(TagIndex tagIndex, ValueIndex oldValue, ValueIndex newValue, GameId gameId);
+
+    /** Calculate the sort ranks for @p tagIndex from scratch */
+    void calculateSortRanks(TagIndex tagIndex, bool numeric) const;
+
+    /** @ret a bit array of the games whose value of @p tagIndex satisfies @p predicate,
+        which is called once per distinct value */
+    template<class Predicate>
+    QBitArray listMatchingValues(TagIndex tagIndex, Predicate predicate) const;
+
 private:
     /** Contains information which games are marked for deletion */
     QSet<GameId> m_deletedGames;
@@ -196,12 +269,36 @@ private:
     QHash<TagIndex, QString> m_tagNames;
     /** Map a tagName to an associated index */
     QHash<QString, TagIndex> m_tagNameIndex;
-    /** Map an Index to a tagValue */
-    QHash<ValueIndex, QString> m_tagValues;
     /** Contains information which games are marked as valid */
     QSet<GameId> m_validFlags;
-    /** Hold the list of index items (=holds all game header information) */
-    QVector<IndexItem> m_indexItems;
+    /** Number of games in the index */
+    int m_count;
+    /** The value of each tag for each game, indexed by TagIndex and GameId. Columns may be shorter than m_count */
+    QVector<MappedArray<ValueIndex> > m_columns;
+    /** Value pool read from the index file, UTF-8 texts and the offsets of their boundaries */
+    MappedArray<quint32> m_valueOffsets;
+    MappedArray<char> m_valueText;
+    /** Values added after the pool was read, the first of them has index mappedValueCount() */
+    QVector<QString> m_addedValues;
+    /** Map a tag value to its index, built on first use */
+    mutable QHash<QString, ValueIndex> m_valueIndex;
+    /** Set with release order once m_valueIndex is complete, readers may only hold m_mutex for reading */
+    mutable QAtomicInt m_valueIndexValid;
+    mutable QMutex m_valueIndexMutex;
+    /** Signatures of the games' main lines, not stored in the index file */
+    QVector<GameSignature> m_signatures;
+
+    /** Sort order of one tag, ranks are positions in the sorted list of distinct values */
+    struct SortRanks
+    {
+        bool numeric;
+        QHash<ValueIndex, quint32> valueRanks;
+        QVector<quint32> gameRanks;
+    };
+    /** Sort orders calculated so far, a tag is dropped when a new value would shift its ranks */
+    mutable QHash<TagIndex, SortRanks> m_sortRanks;
+    /** Games of each value of the tags asked for by gamesWithValue() */
+    mutable QHash<TagIndex, QHash<ValueIndex, QVector<GameId> > > m_valueGames;
 
     mutable QReadWriteLock m_mutex;
 };
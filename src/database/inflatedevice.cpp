@@ -0,0 +1,473 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <cstring>
+
+#include "inflatedevice.h"
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+#define DEBUG_NEW new( _NORMAL_BLOCK, __FILE__, __LINE__ )
+#define new DEBUG_NEW
+#endif // _MSC_VER
+
+namespace {
+
+/** Size of the deflate dictionary, which is also the size of the output window */
+const int WindowSize = 32768;
+/** Distance between access points in the uncompressed data */
+const qint64 AccessPointSpan = 512 * 1024;
+/** Size of the compressed input chunks */
+const int InputSize = 65536;
+
+const quint32 AccessPointMagic = 0x1f8b4350;
+
+} // namespace
+
+InflateDevice::InflateDevice(const QString& filename, Format format, qint64 dataStart,
+                             qint64 dataSize, qint64 uncompressedSize, QObject* parent) :
+    QIODevice(parent),
+    m_file(filename),
+    m_format(format),
+    m_dataStart(dataStart),
+    m_dataSize(dataSize),
+    m_sizeHint(uncompressedSize),
+    m_streamInitialized(false),
+    m_raw(false),
+    m_inRead(0),
+    m_windowPos(0),
+    m_have(0),
+    m_out(0),
+    m_end(false),
+    m_total(-1),
+    m_pos(0)
+{
+    memset(&m_stream, 0, sizeof(m_stream));
+}
+
+InflateDevice::~InflateDevice()
+{
+    close();
+}
+
+bool InflateDevice::open(OpenMode mode)
+{
+    if ((mode & QIODevice::WriteOnly) || !m_file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+    if (m_dataSize < 0)
+    {
+        m_dataSize = m_file.size() - m_dataStart;
+    }
+    if (m_format == Stored)
+    {
+        m_total = m_dataSize;
+    }
+    m_input.resize(InputSize);
+    m_window.resize(WindowSize);
+    // Lines are cut from the window by readLineData(), QIODevice's own buffer would only copy them twice
+    QIODevice::open(mode | QIODevice::Unbuffered);
+    m_pos = 0;
+    if (!restart(nullptr))
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void InflateDevice::close()
+{
+    if (m_streamInitialized)
+    {
+        inflateEnd(&m_stream);
+        m_streamInitialized = false;
+    }
+    m_file.close();
+    QIODevice::close();
+}
+
+qint64 InflateDevice::size() const
+{
+    return (m_total >= 0) ? m_total : qMax(m_sizeHint, m_out);
+}
+
+bool InflateDevice::seek(qint64 pos)
+{
+    if (!QIODevice::seek(pos))
+    {
+        return false;
+    }
+    m_pos = pos;
+    return true;
+}
+
+bool InflateDevice::atEnd() const
+{
+    if (!isOpen())
+    {
+        return true;
+    }
+    if (m_total >= 0)
+    {
+        return m_pos >= m_total;
+    }
+    return !const_cast<InflateDevice*>(this)->makeAvailable(m_pos);
+}
+
+qint64 InflateDevice::bytesAvailable() const
+{
+    if (atEnd())
+    {
+        return 0;
+    }
+    return qMax<qint64>(1, size() - m_pos);
+}
+
+qint64 InflateDevice::readData(char* data, qint64 maxSize)
+{
+    qint64 done = 0;
+    while (done < maxSize && makeAvailable(m_pos))
+    {
+        qint64 n = copyFromWindow(data + done, m_pos, maxSize - done, false);
+        m_pos += n;
+        done += n;
+    }
+    return done;
+}
+
+qint64 InflateDevice::readLineData(char* data, qint64 maxSize)
+{
+    qint64 done = 0;
+    while (done < maxSize && makeAvailable(m_pos))
+    {
+        qint64 n = copyFromWindow(data + done, m_pos, maxSize - done, true);
+        m_pos += n;
+        done += n;
+        if (data[done - 1] == '\n')
+        {
+            break;
+        }
+    }
+    return done;
+}
+
+qint64 InflateDevice::copyFromWindow(char* data, qint64 pos, qint64 maxSize, bool stopAtNewline) const
+{
+    int index = m_windowPos - int(m_out - pos);
+    if (index < 0)
+    {
+        index += WindowSize;
+    }
+    qint64 n = qMin<qint64>(maxSize, (index < m_windowPos) ? m_windowPos - index : WindowSize - index);
+    const char* start = m_window.constData() + index;
+    if (stopAtNewline)
+    {
+        const char* newline = static_cast<const char*>(memchr(start, '\n', size_t(n)));
+        if (newline)
+        {
+            n = newline - start + 1;
+        }
+    }
+    memcpy(data, start, size_t(n));
+    return n;
+}
+
+bool InflateDevice::makeAvailable(qint64 pos)
+{
+    if (pos < m_out && pos >= m_out - m_have)
+    {
+        return true;
+    }
+    if (m_format == Stored)
+    {
+        if (pos >= m_total)
+        {
+            return false;
+        }
+        if (pos < m_out - m_have || pos >= m_out + WindowSize)
+        {
+            m_file.seek(m_dataStart + pos);
+            m_inRead = m_out = pos;
+            m_have = m_windowPos = 0;
+        }
+    }
+    else if (pos < m_out - m_have || pos >= m_out + AccessPointSpan)
+    {
+        // Find the last access point at or before pos
+        int lo = 0;
+        int hi = m_points.count();
+        while (lo < hi)
+        {
+            int mid = (lo + hi) / 2;
+            if (m_points[mid].out <= pos)
+            {
+                lo = mid + 1;
+            }
+            else
+            {
+                hi = mid;
+            }
+        }
+        const AccessPoint* point = lo ? &m_points[lo - 1] : nullptr;
+        if ((pos < m_out - m_have || (point && point->out > m_out)) && !restart(point))
+        {
+            return false;
+        }
+    }
+    while (pos >= m_out)
+    {
+        if (!inflateMore())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool InflateDevice::restart(const AccessPoint* point)
+{
+    if (m_format == Stored)
+    {
+        m_inRead = m_out = 0;
+        m_have = m_windowPos = 0;
+        return m_file.seek(m_dataStart);
+    }
+
+    m_raw = point || m_format == RawDeflate;
+    int windowBits = m_raw ? -MAX_WBITS : MAX_WBITS + 16;
+    if (!m_streamInitialized)
+    {
+        if (inflateInit2(&m_stream, windowBits) != Z_OK)
+        {
+            return false;
+        }
+        m_streamInitialized = true;
+    }
+    else if (inflateReset2(&m_stream, windowBits) != Z_OK)
+    {
+        return false;
+    }
+    m_stream.next_in = nullptr;
+    m_stream.avail_in = 0;
+    m_end = false;
+    m_have = 0;
+    m_windowPos = 0;
+    m_out = 0;
+
+    m_inRead = point ? point->in - (point->bits ? 1 : 0) : 0;
+    if (!m_file.seek(m_dataStart + m_inRead))
+    {
+        return false;
+    }
+    if (point)
+    {
+        if (point->bits)
+        {
+            if (!fillInput())
+            {
+                return false;
+            }
+            int byte = *m_stream.next_in;
+            ++m_stream.next_in;
+            --m_stream.avail_in;
+            inflatePrime(&m_stream, point->bits, byte >> (8 - point->bits));
+        }
+        QByteArray dictionary = qUncompress(point->window);
+        if (dictionary.size() > WindowSize)
+        {
+            return false;
+        }
+        if (!dictionary.isEmpty())
+        {
+            inflateSetDictionary(&m_stream, reinterpret_cast<const Bytef*>(dictionary.constData()), uInt(dictionary.size()));
+            memcpy(m_window.data(), dictionary.constData(), size_t(dictionary.size()));
+        }
+        m_have = m_windowPos = dictionary.size();
+        m_out = point->out;
+    }
+    return true;
+}
+
+bool InflateDevice::fillInput()
+{
+    qint64 n = m_file.read(m_input.data(), qMin<qint64>(m_input.size(), m_dataSize - m_inRead));
+    if (n <= 0)
+    {
+        return false;
+    }
+    m_inRead += n;
+    m_stream.next_in = reinterpret_cast<Bytef*>(m_input.data());
+    m_stream.avail_in = uInt(n);
+    return true;
+}
+
+bool InflateDevice::skipInput(qint64 n)
+{
+    while (n > 0)
+    {
+        if (!m_stream.avail_in && !fillInput())
+        {
+            return false;
+        }
+        uInt skip = uInt(qMin<qint64>(n, m_stream.avail_in));
+        m_stream.next_in += skip;
+        m_stream.avail_in -= skip;
+        n -= skip;
+    }
+    return true;
+}
+
+bool InflateDevice::nextMember()
+{
+    // Raw inflating stops in front of the member trailer (CRC and size), gzip inflating reads it
+    if (m_raw && !skipInput(8))
+    {
+        return false;
+    }
+    if (!m_stream.avail_in && !fillInput())
+    {
+        return false;
+    }
+    m_raw = false;
+    return inflateReset2(&m_stream, MAX_WBITS + 16) == Z_OK;
+}
+
+bool InflateDevice::inflateMore()
+{
+    if (m_end)
+    {
+        return false;
+    }
+    if (m_windowPos == WindowSize)
+    {
+        m_windowPos = 0;
+    }
+    int available = WindowSize - m_windowPos;
+
+    if (m_format == Stored)
+    {
+        qint64 n = m_file.read(m_window.data() + m_windowPos, qMin<qint64>(available, m_total - m_out));
+        if (n <= 0)
+        {
+            return false;
+        }
+        m_inRead += n;
+        m_windowPos += int(n);
+        m_out += n;
+        m_have = qMin(WindowSize, m_have + int(n));
+        return true;
+    }
+
+    m_stream.next_out = reinterpret_cast<Bytef*>(m_window.data() + m_windowPos);
+    m_stream.avail_out = uInt(available);
+    int produced = 0;
+    while (!produced && !m_end)
+    {
+        if (!m_stream.avail_in && !fillInput())
+        {
+            // Truncated stream, deliver what was inflated
+            m_end = true;
+            break;
+        }
+        uInt before = m_stream.avail_out;
+        int ret = inflate(&m_stream, Z_BLOCK);
+        produced = int(before - m_stream.avail_out);
+        m_windowPos += produced;
+        m_out += produced;
+        m_have = qMin(WindowSize, m_have + produced);
+
+        if (ret == Z_STREAM_END)
+        {
+            // gzip files may consist of several members
+            if (m_format != Gzip || !nextMember())
+            {
+                m_end = true;
+            }
+        }
+        else if (ret != Z_OK && ret != Z_BUF_ERROR)
+        {
+            m_end = true;
+        }
+        else if ((m_stream.data_type & 128) && !(m_stream.data_type & 64))
+        {
+            // At a block boundary which is not the end of the stream
+            if (m_points.isEmpty() || m_out >= m_points.last().out + AccessPointSpan)
+            {
+                addAccessPoint();
+            }
+        }
+    }
+    if (m_end && m_total < 0)
+    {
+        m_total = m_out;
+    }
+    return produced > 0;
+}
+
+void InflateDevice::addAccessPoint()
+{
+    QByteArray dictionary;
+    dictionary.reserve(m_have);
+    int start = m_windowPos - m_have;
+    if (start < 0)
+    {
+        dictionary.append(m_window.constData() + WindowSize + start, -start);
+        start = 0;
+    }
+    dictionary.append(m_window.constData() + start, m_windowPos - start);
+
+    AccessPoint point;
+    point.out = m_out;
+    point.in = compressedPos();
+    point.bits = m_stream.data_type & 7;
+    point.window = qCompress(dictionary);
+    m_points.append(point);
+}
+
+void InflateDevice::writeAccessPoints(QDataStream& out) const
+{
+    out << AccessPointMagic;
+    out << m_total;
+    out << qint32(m_points.count());
+    foreach (const AccessPoint& point, m_points)
+    {
+        out << point.out << point.in << qint32(point.bits) << point.window;
+    }
+}
+
+bool InflateDevice::readAccessPoints(QDataStream& in)
+{
+    quint32 magic;
+    qint64 total;
+    qint32 count;
+    in >> magic >> total >> count;
+    if (magic != AccessPointMagic || count < 0 || in.status() != QDataStream::Ok)
+    {
+        return false;
+    }
+    QVector<AccessPoint> points;
+    points.reserve(count);
+    for (qint32 i = 0; i < count; ++i)
+    {
+        AccessPoint point;
+        qint32 bits;
+        in >> point.out >> point.in >> bits >> point.window;
+        point.bits = bits;
+        points.append(point);
+    }
+    if (in.status() != QDataStream::Ok)
+    {
+        return false;
+    }
+    m_points = points;
+    if (m_format != Stored)
+    {
+        m_total = total;
+    }
+    return true;
+}
@@ -0,0 +1,119 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef INFLATEDEVICE_H
+#define INFLATEDEVICE_H
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QFile>
+#include <QIODevice>
+#include <QVector>
+
+#include <zlib.h>
+
+/** @ingroup Database
+The InflateDevice class gives read only random access to the uncompressed
+contents of a gzip file or of a deflated zip entry.
+
+While the stream is read for the first time, the device records an access
+point every few hundred KB of output, holding the inflate state needed to
+restart there (compressed offset, bit offset and the preceding 32 KB window).
+Seeking restores the closest access point before the target and inflates only
+from there. Reading forward from the current position never restarts.
+The access points can be saved and restored, so a stream needs to be
+inflated completely only once. */
+class InflateDevice : public QIODevice
+{
+    Q_OBJECT
+public:
+    enum Format
+    {
+        Gzip,       ///< gzip file, possibly with several members
+        RawDeflate, ///< deflate data without header, e.g. a zip entry
+        Stored      ///< uncompressed data, e.g. a stored zip entry
+    };
+
+    /** Restart information for one position of the uncompressed stream */
+    struct AccessPoint
+    {
+        qint64 out;        ///< offset in the uncompressed data
+        qint64 in;         ///< offset of the first complete byte in the compressed data
+        int bits;          ///< number of bits of the preceding byte still to be used
+        QByteArray window; ///< qCompress()ed dictionary preceding @p out
+    };
+
+    /** Create a device over the compressed data of @p filename, which starts at
+        @p dataStart and is @p dataSize bytes long (-1 for the rest of the file).
+        @p uncompressedSize is a hint, -1 if unknown. */
+    InflateDevice(const QString& filename, Format format, qint64 dataStart = 0,
+                  qint64 dataSize = -1, qint64 uncompressedSize = -1, QObject* parent = nullptr);
+    ~InflateDevice();
+
+    virtual bool open(OpenMode mode);
+    virtual void close();
+    virtual bool isSequential() const { return false; }
+    /** @return the uncompressed size, an estimate until the stream was read once */
+    virtual qint64 size() const;
+    virtual bool seek(qint64 pos);
+    virtual bool atEnd() const;
+    virtual qint64 bytesAvailable() const;
+
+    /** @return true if the whole stream was inflated once and its size is exact */
+    bool isComplete() const { return m_total >= 0; }
+    /** Write the access points to @p out */
+    void writeAccessPoints(QDataStream& out) const;
+    /** Read access points previously written by writeAccessPoints(). */
+    bool readAccessPoints(QDataStream& in);
+
+protected:
+    virtual qint64 readData(char* data, qint64 maxSize);
+    virtual qint64 readLineData(char* data, qint64 maxSize);
+    virtual qint64 writeData(const char*, qint64) { return -1; }
+
+private:
+    /** Make the byte at @p pos available in the window, @return false beyond the end */
+    bool makeAvailable(qint64 pos);
+    /** Inflate the next piece of output into the window */
+    bool inflateMore();
+    /** Restart inflating at @p point, or at the beginning if @p point is null */
+    bool restart(const AccessPoint* point);
+    bool fillInput();
+    bool skipInput(qint64 n);
+    /** Continue with the next member of a gzip file, @return false if there is none */
+    bool nextMember();
+    /** @return the number of compressed bytes consumed */
+    qint64 compressedPos() const { return m_inRead - m_stream.avail_in; }
+    /** Store an access point for the current stream position */
+    void addAccessPoint();
+    /** Copy contiguous window bytes starting at @p pos, @return the number of bytes copied */
+    qint64 copyFromWindow(char* data, qint64 pos, qint64 maxSize, bool stopAtNewline) const;
+
+    QFile m_file;
+    Format m_format;
+    qint64 m_dataStart;
+    qint64 m_dataSize;
+    qint64 m_sizeHint;
+
+    z_stream m_stream;
+    bool m_streamInitialized;
+    bool m_raw;       ///< inflating without gzip header, after restarting at an access point
+    QByteArray m_input;
+    qint64 m_inRead;  ///< compressed bytes read from the file
+
+    QByteArray m_window;
+    int m_windowPos;  ///< where the next output goes into the circular window
+    int m_have;       ///< valid bytes in the window, ending at m_out
+    qint64 m_out;     ///< uncompressed bytes produced by the stream
+    bool m_end;
+    qint64 m_total;   ///< exact uncompressed size, -1 until known
+
+    qint64 m_pos;
+    QVector<AccessPoint> m_points;
+};
+
+#endif // INFLATEDEVICE_H
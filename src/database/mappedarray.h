@@ -0,0 +1,179 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef MAPPEDARRAY_H
+#define MAPPEDARRAY_H
+
+#include <cstring>
+
+#include <QDataStream>
+#include <QFile>
+#include <QSharedPointer>
+#include <QVector>
+
+/** @ingroup Database
+ * A read only memory mapping of a whole file. It is shared by the arrays which
+ * use parts of it in place and is unmapped when the last of them lets go.
+ */
+class FileMapping
+{
+public:
+    /** Map @p filename, @return a null pointer if the file cannot be mapped */
+    static QSharedPointer<const FileMapping> map(const QString& filename)
+    {
+        QSharedPointer<FileMapping> mapping(new FileMapping(filename));
+        if (!mapping->m_file.open(QIODevice::ReadOnly) || !mapping->m_file.size())
+        {
+            return QSharedPointer<const FileMapping>();
+        }
+        mapping->m_size = mapping->m_file.size();
+        mapping->m_data = mapping->m_file.map(0, mapping->m_size);
+        if (!mapping->m_data)
+        {
+            return QSharedPointer<const FileMapping>();
+        }
+        return mapping;
+    }
+
+    const uchar* data() const { return m_data; }
+    qint64 size() const { return m_size; }
+
+private:
+    explicit FileMapping(const QString& filename) : m_file(filename), m_data(nullptr), m_size(0) {}
+    Q_DISABLE_COPY(FileMapping)
+
+    QFile m_file;
+    uchar* m_data;
+    qint64 m_size;
+};
+
+/** @ingroup Database
+ * An array of plain values which either owns its elements or uses them in
+ * place from a FileMapping. The first change copies mapped elements into
+ * memory owned by the array.
+ */
+template <class T>
+class MappedArray
+{
+public:
+    MappedArray() : m_data(nullptr), m_count(0) {}
+
+    int count() const { return m_count; }
+    bool isEmpty() const { return !m_count; }
+    /** @return element @p i, which must exist */
+    T at(int i) const { return m_data[i]; }
+    /** @return element @p i, or @p defaultValue beyond the end */
+    T value(int i, T defaultValue = T()) const { return (i >= 0 && i < m_count) ? m_data[i] : defaultValue; }
+    const T* constData() const { return m_data; }
+    bool isMapped() const { return !m_mapping.isNull(); }
+
+    /** Use @p count elements at @p data in place, @p mapping keeps them valid */
+    void setMapped(const QSharedPointer<const FileMapping>& mapping, const T* data, int count)
+    {
+        m_values.clear();
+        m_mapping = mapping;
+        m_data = data;
+        m_count = count;
+    }
+    /** Set element @p i, growing the array with default values if needed */
+    void set(int i, T value)
+    {
+        detach();
+        if (i >= m_values.count())
+        {
+            m_values.resize(i + 1);
+        }
+        m_values[i] = value;
+        sync();
+    }
+    void append(T value) { detach(); m_values.append(value); sync(); }
+    void resize(int count) { detach(); m_values.resize(count); sync(); }
+    void reserve(int count) { detach(); m_values.reserve(count); sync(); }
+    void squeeze() { if (!isMapped()) { m_values.squeeze(); sync(); } }
+    void clear() { m_mapping.reset(); m_values.clear(); sync(); }
+
+    /** Copy mapped elements into memory owned by the array */
+    void detach()
+    {
+        if (isMapped())
+        {
+            m_values.resize(m_count);
+            if (m_count)
+            {
+                memcpy(m_values.data(), m_data, size_t(m_count) * sizeof(T));
+            }
+            m_mapping.reset();
+            sync();
+        }
+    }
+
+private:
+    void sync()
+    {
+        m_data = m_values.constData();
+        m_count = m_values.count();
+    }
+
+    QSharedPointer<const FileMapping> m_mapping;
+    const T* m_data;
+    int m_count;
+    QVector<T> m_values;
+};
+
+/** Write @p count elements at @p data in host byte order, aligned so that they
+    can be used in place once the file is mapped. */
+template <class T>
+void writeMappedArray(QDataStream& out, const T* data, int count)
+{
+    static const char padding[sizeof(qint64)] = {};
+    out << qint32(count);
+    int misalignment = int(out.device()->pos() % sizeof(qint64));
+    if (misalignment)
+    {
+        out.writeRawData(padding, int(sizeof(qint64)) - misalignment);
+    }
+    out.writeRawData(reinterpret_cast<const char*>(data), int(count * sizeof(T)));
+}
+
+template <class T>
+void writeMappedArray(QDataStream& out, const MappedArray<T>& array)
+{
+    writeMappedArray(out, array.constData(), array.count());
+}
+
+/** Read an array written by writeMappedArray() by pointing @p array to its
+    elements in @p mapping, which maps the file read by @p in. */
+template <class T>
+bool readMappedArray(QDataStream& in, const QSharedPointer<const FileMapping>& mapping, MappedArray<T>& array)
+{
+    qint32 count;
+    in >> count;
+    if (in.status() != QDataStream::Ok || count < 0)
+    {
+        return false;
+    }
+    qint64 pos = in.device()->pos();
+    int misalignment = int(pos % sizeof(qint64));
+    if (misalignment)
+    {
+        int skip = int(sizeof(qint64)) - misalignment;
+        if (in.skipRawData(skip) != skip)
+        {
+            return false;
+        }
+        pos += skip;
+    }
+    int size = int(count * sizeof(T));
+    if (pos + size > mapping->size() || in.skipRawData(size) != size)
+    {
+        return false;
+    }
+    array.setMapped(mapping, reinterpret_cast<const T*>(mapping->data() + pos), count);
+    return true;
+}
+
+#endif // MAPPEDARRAY_H
@@ -0,0 +1,253 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <QtCore>
+#include <QFutureSynchronizer>
+#include <QtConcurrent/QtConcurrent>
+
+#include "board.h"
+#include "database.h"
+#include "materialsearch.h"
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+#define DEBUG_NEW new( _NORMAL_BLOCK, __FILE__, __LINE__ )
+#define new DEBUG_NEW
+#endif // _MSC_VER
+
+static const int MaterialTypes = 5; // queens, rooks, bishops, knights, pawns
+static const int MaterialValues[MaterialTypes] = { 9, 5, 3, 3, 1 };
+
+static int materialCount(quint64 signature, int i)
+{
+    return (signature >> (4 * i)) & 0xF;
+}
+
+/* MaterialSearch class
+ * **********************/
+MaterialSearch::MaterialSearch(Database* db) : Search(db),
+    m_minBalance(-1000),
+    m_maxBalance(1000),
+    m_minPlies(1)
+{
+    for(int i = 0; i < 2 * MaterialTypes; ++i)
+    {
+        m_min[i] = 0;
+        m_max[i] = 15;
+    }
+}
+
+void MaterialSearch::setPieceCount(Piece piece, int min, int max)
+{
+    PieceType type = pieceType(piece);
+    if(type < Queen || type > Pawn)
+    {
+        return;
+    }
+    int i = MaterialTypes * pieceColor(piece) + (type - Queen);
+    m_min[i] = min;
+    m_max[i] = max;
+}
+
+bool MaterialSearch::setMaterial(const QString& material)
+{
+    QStringList sides = material.toUpper().split('-');
+    if(sides.count() != 2)
+    {
+        return false;
+    }
+    int counts[2 * MaterialTypes] = {};
+    for(int color = White; color <= Black; ++color)
+    {
+        foreach(QChar c, sides[color].trimmed())
+        {
+            int type = QString("QRBNP").indexOf(c);
+            if(type >= 0)
+            {
+                ++counts[MaterialTypes * color + type];
+            }
+            else if(c != 'K')
+            {
+                return false;
+            }
+        }
+    }
+    for(int i = 0; i < 2 * MaterialTypes; ++i)
+    {
+        m_min[i] = m_max[i] = counts[i];
+    }
+    return true;
+}
+
+void MaterialSearch::setBalance(int min, int max)
+{
+    m_minBalance = min;
+    m_maxBalance = max;
+}
+
+void MaterialSearch::addPattern(Piece piece, quint64 squares, bool present)
+{
+    Pattern pattern;
+    pattern.piece = piece;
+    pattern.squares = squares;
+    pattern.present = present;
+    m_patterns.append(pattern);
+}
+
+void MaterialSearch::setMinPlies(int plies)
+{
+    m_minPlies = qMax(1, plies);
+}
+
+bool MaterialSearch::rejectedBySignature(GameId index) const
+{
+    GameSignature signature = m_database->index()->signature(index);
+    if(!signature.isValid())
+    {
+        return false;
+    }
+    // The count of each piece lies between the initial and the final one,
+    // a promotion only keeps this true for the pawns
+    for(int i = 0; i < 2 * MaterialTypes; ++i)
+    {
+        bool pawns = (i % MaterialTypes == MaterialTypes - 1);
+        if(!pawns && signature.hasPromotions())
+        {
+            continue;
+        }
+        if(m_max[i] < materialCount(signature.finalMaterial(), i) ||
+           m_min[i] > materialCount(signature.initialMaterial(), i))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool MaterialSearch::matchesBoard(const BoardX& board) const
+{
+    quint64 material = board.materialSignature();
+    int balance = 0;
+    for(int i = 0; i < 2 * MaterialTypes; ++i)
+    {
+        int count = materialCount(material, i);
+        if(count < m_min[i] || count > m_max[i])
+        {
+            return false;
+        }
+        balance += (i < MaterialTypes ? 1 : -1) * count * MaterialValues[i % MaterialTypes];
+    }
+    if(balance < m_minBalance || balance > m_maxBalance)
+    {
+        return false;
+    }
+    foreach(const Pattern& pattern, m_patterns)
+    {
+        if(((board.pieceMask(pattern.piece) & pattern.squares) != 0) != pattern.present)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int MaterialSearch::searchGame(GameId index) const
+{
+    if(rejectedBySignature(index))
+    {
+        return 0;
+    }
+
+    GameX game;
+    m_database->loadGameMoves(index, game);
+    const GameCursor& cursor = game.cursor();
+    BoardX board = cursor.initialBoard();
+    MoveId node = ROOT_NODE;
+    MoveId runStart = NO_MOVE;
+    int run = 0;
+    for(;;)
+    {
+        if(matchesBoard(board))
+        {
+            if(!run++)
+            {
+                runStart = node;
+            }
+            if(run >= m_minPlies)
+            {
+                return runStart + 1;
+            }
+        }
+        else
+        {
+            run = 0;
+        }
+        node = cursor.nextMove(node);
+        if(node == NO_MOVE)
+        {
+            return 0;
+        }
+        board.doMove(cursor.move(node));
+    }
+}
+
+void MaterialSearch::searchChunk(int start, int end, const QVector<GameId>* games, int* results, volatile bool* breakFlag)
+{
+    for(int i = start; i < end; ++i)
+    {
+        if(*breakFlag)
+        {
+            return;
+        }
+        GameId id = games->at(i);
+        results[id] = searchGame(id);
+    }
+    int searched = m_searched.fetchAndAddRelaxed(end - start) + (end - start);
+    emit prepareUpdate(static_cast<int>(qint64(searched) * 100 / games->count()));
+}
+
+void MaterialSearch::Prepare(volatile bool& breakFlag)
+{
+    m_matches.clear();
+    if(!m_database)
+    {
+        return;
+    }
+    int n = m_database->index()->count();
+    m_matches.fill(0, n);
+    m_searched = 0;
+
+    // Only the games the filter asks for are searched
+    QVector<GameId> games;
+    for(GameId i = 0; (int)i < n; ++i)
+    {
+        if(isRequested(i))
+        {
+            games.append(i);
+        }
+    }
+
+    RefKeeper m(m_database->refCounter());
+    int count = games.count();
+    int chunk = qMax(64, count / (8 * QThread::idealThreadCount()));
+    QFutureSynchronizer<void> synchronizer;
+    for(int start = 0; start < count; start += chunk)
+    {
+        int end = std::min(start + chunk, count);
+#if QT_VERSION < 0x060000
+        QFuture<void> future = QtConcurrent::run(this, &MaterialSearch::searchChunk, start, end, &games, m_matches.data(), &breakFlag);
+#else
+        QFuture<void> future = QtConcurrent::run(&MaterialSearch::searchChunk, this, start, end, &games, m_matches.data(), &breakFlag);
+#endif
+        synchronizer.addFuture(future);
+    }
+    synchronizer.waitForFinished();
+}
+
+int MaterialSearch::matches(GameId index) const
+{
+    return ((int)index < m_matches.count()) ? m_matches.at(index) : 0;
+}
@@ -0,0 +1,74 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef MATERIALSEARCH_H
+#define MATERIALSEARCH_H
+
+#include "search.h"
+#include "piece.h"
+
+#include <QAtomicInt>
+#include <QList>
+#include <QVector>
+
+class BoardX;
+
+/** @ingroup Search
+The MaterialSearch class finds games whose main line passes through positions
+with a given material and piece pattern for a minimum number of plies.
+The games are searched in parallel when the search is prepared. */
+class MaterialSearch : public Search
+{
+    Q_OBJECT
+
+public:
+    /** Standard constructor, any material matches. */
+    explicit MaterialSearch(Database* db);
+    /** Require between @p min and @p max pieces of @p piece (kings are ignored). */
+    void setPieceCount(Piece piece, int min, int max);
+    /** Require exactly the material given as e.g. "KRP-KB", white before the dash.
+        @return false if @p material can not be parsed */
+    bool setMaterial(const QString& material);
+    /** Require white's material minus black's, counted in pawns (Q=9, R=5, B=N=3) */
+    void setBalance(int min, int max);
+    /** Require @p piece on at least one of @p squares, or on none of them if not @p present */
+    void addPattern(Piece piece, quint64 squares, bool present = true);
+    /** Require the material and pattern in at least @p plies consecutive positions */
+    void setMinPlies(int plies);
+
+    virtual void Prepare(volatile bool& breakFlag);
+    /** Return the moveId + 1 of the first position of the matching sequence, 0 if there is none */
+    virtual int matches(GameId index) const;
+
+private:
+    struct Pattern
+    {
+        Piece piece;
+        quint64 squares;
+        bool present;
+    };
+
+    /** @return true if the material signature of the game rules out a match */
+    bool rejectedBySignature(GameId index) const;
+    /** @return true if @p board has the sought material and pattern */
+    bool matchesBoard(const BoardX& board) const;
+    int searchGame(GameId index) const;
+    /** Search the games @p start to @p end of @p games */
+    void searchChunk(int start, int end, const QVector<GameId>* games, int* results, volatile bool* breakFlag);
+
+    /** Minimum and maximum count per piece type, in the order of BitBoard::materialSignature() */
+    int m_min[10];
+    int m_max[10];
+    int m_minBalance;
+    int m_maxBalance;
+    QList<Pattern> m_patterns;
+    int m_minPlies;
+    QVector<int> m_matches;
+    QAtomicInt m_searched;
+};
+
+#endif // MATERIALSEARCH_H
@@ -11,10 +11,19 @@
 #include <QtCore>
 #include <QFileInfo>
 #include <QMutexLocker>
+#include <QSaveFile>
 #include "memorydatabase.h"
+#include "output.h"
 #include "settings.h"
 #include "tags.h"
 
+#if defined(Q_OS_LINUX)
+#include <unistd.h>
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 27))
+#define HAVE_COPY_FILE_RANGE
+#endif
+#endif
+
 using namespace chessx;
 
 #if defined(_MSC_VER) && defined(_DEBUG)
@@ -38,6 +47,9 @@ void MemoryDatabase::clear()
     m_index.clear();
     m_isModified = false;
     m_transaction = false;
+    m_fileGames = 0;
+    m_changedGames.clear();
+    m_allGamesChanged = false;
 
     PgnDatabase::clear();
 }
@@ -53,6 +65,14 @@ bool MemoryDatabase::isModified() const
 }
 
 void MemoryDatabase::setModified(bool b)
+{
+    // Changes made from outside, e.g. tag renames in the index or a rewrite
+    // of the file, leave no trustworthy byte ranges behind
+    m_allGamesChanged = true;
+    setDirty(b);
+}
+
+void MemoryDatabase::setDirty(bool b)
 {
     m_isModified = b;
     if (!m_transaction) emit dirtyChanged(m_isModified);
@@ -73,6 +93,7 @@ bool MemoryDatabase::appendGame(const GameX& game)
     // Add to index
     m_count = m_index.add();
     setTagsToIndex(game, m_count);
+    m_index.setSignature(m_count, GameSignature(game));
 
     // Upate game array
     GameX* newGame = new GameX;
@@ -81,26 +102,31 @@ bool MemoryDatabase::appendGame(const GameX& game)
     newGame->unmountBoard();
     m_games.append(newGame);
     ++m_count;
-    setModified(true);
+    setDirty(true);
     return true;
 }
 
 bool MemoryDatabase::remove(GameId gameId)
 {
     m_index.setDeleted(gameId, true);
-    setModified(true);
+    setDirty(true);
     return true;
 }
 
 bool MemoryDatabase::undelete(GameId gameId)
 {
+    // Deleted games are indexed without their comments
+    clearCommentIndex();
     m_index.setDeleted(gameId, false);
-    setModified(true);
+    // The game may have been dropped from the file by a save
+    setGameChanged(gameId);
     return true;
 }
 
 bool MemoryDatabase::replace(GameId gameId, GameX& game)
 {
+    // Before locking, a comment search may be loading games
+    clearCommentIndex();
     QWriteLocker m(&m_mutex);
     if(gameId >= m_count)
     {
@@ -108,12 +134,13 @@ bool MemoryDatabase::replace(GameId gameId, GameX& game)
     }
     // Update index
     setTagsToIndex(game, gameId);
+    m_index.setSignature(gameId, GameSignature(game));
 
     // Upate game array
     *m_games[gameId] = game;
     m_games[gameId]->clearTags();
     m_games[gameId]->unmountBoard();
-    setModified(true);
+    setGameChanged(gameId);
     return true;
 }
 
@@ -162,6 +189,7 @@ void MemoryDatabase::parseGame()
         game->dbSetStartingBoard(fen, chess960);
     }
     m_index.setValidFlag(m_count - 1, parseMoves(game));
+    m_index.setSignature(m_count - 1, GameSignature(*game));
 
     QString valLength = QString::number((game->plyCount() + 1) / 2);
     m_index.setTag(TagNameLength, valLength, m_count - 1);
@@ -193,5 +221,180 @@ void MemoryDatabase::parseGame()
 bool MemoryDatabase::parseFile()
 {
     bool ok = parseFileIntern();
+    m_fileGames = static_cast<GameId>(m_count);
+    m_changedGames.clear();
+    m_allGamesChanged = false;
     return ok;
 }
+
+void MemoryDatabase::setGameChanged(GameId gameId)
+{
+    if(gameId < m_fileGames)
+    {
+        m_changedGames.insert(gameId);
+    }
+    setDirty(true);
+}
+
+bool MemoryDatabase::isGameChanged(GameId gameId) const
+{
+    return m_allGamesChanged || gameId >= m_fileGames || m_changedGames.contains(gameId);
+}
+
+/** Append @p length bytes of @p source starting at @p from to @p target */
+static bool copyRange(QFile& source, QFileDevice& target, qint64 from, qint64 length)
+{
+#ifdef HAVE_COPY_FILE_RANGE
+    // Let the kernel copy the data, without a round trip through user space
+    if(target.flush())
+    {
+        loff_t in = from;
+        loff_t out = target.pos();
+        while(length > 0)
+        {
+            ssize_t n = copy_file_range(source.handle(), &in, target.handle(), &out, static_cast<size_t>(length), 0);
+            if(n <= 0)
+            {
+                break;
+            }
+            length -= n;
+        }
+        from = in;
+        if(!target.seek(out))
+        {
+            return false;
+        }
+    }
+#endif
+    if(length > 0 && !source.seek(from))
+    {
+        return false;
+    }
+    while(length > 0)
+    {
+        QByteArray buffer = source.read(qMin(length, qint64(1) << 20));
+        if(buffer.isEmpty() || target.write(buffer) != buffer.size())
+        {
+            return false;
+        }
+        length -= buffer.size();
+    }
+    return true;
+}
+
+bool MemoryDatabase::save(Output& output, bool utf8)
+{
+    QSaveFile target(filename());
+    if(!target.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+    QFile source(filename());
+    bool copy = !m_allGamesChanged && source.open(QIODevice::ReadOnly);
+    qint64 sourceSize = copy ? source.size() : 0;
+
+    // Start of each game in the new file
+    QVector<qint64> offsets(static_cast<int>(m_count), -1);
+    // Games waiting to be formatted, and the byte range waiting to be copied
+    QVector<GameId> formatted;
+    qint64 copyFrom = 0;
+    qint64 copyTo = 0;
+    bool ok = true;
+
+    auto flushCopy = [&]()
+    {
+        if(copyTo > copyFrom)
+        {
+            ok = ok && copyRange(source, target, copyFrom, copyTo - copyFrom);
+            char last = '\n';
+            if(ok && copyTo == sourceSize && source.seek(sourceSize - 1) && source.getChar(&last) && last != '\n')
+            {
+                // The last game of the file may lack a line break before the next one
+                target.write("\n\n");
+            }
+        }
+        copyFrom = copyTo = 0;
+    };
+    auto flushFormatted = [&]()
+    {
+        if(!formatted.isEmpty())
+        {
+            QVector<qint64> sizes;
+            qint64 pos = target.pos();
+            output.exportGames(target, *this, formatted, utf8, &sizes);
+            for(int i = 0; i < formatted.count(); ++i)
+            {
+                if(sizes[i])
+                {
+                    offsets[formatted[i]] = pos;
+                    pos += sizes[i];
+                }
+            }
+            formatted.clear();
+        }
+    };
+
+    for(GameId id = 0; id < m_count && ok; ++id)
+    {
+        if(m_index.deleted(id))
+        {
+            continue;
+        }
+        if(copy && !isGameChanged(id))
+        {
+            flushFormatted();
+            qint64 start = offset(id);
+            qint64 end = (id + 1 < m_fileGames) ? offset(id + 1) : sourceSize;
+            if(start != copyTo)
+            {
+                flushCopy();
+                copyFrom = copyTo = start;
+            }
+            offsets[id] = target.pos() + (copyTo - copyFrom);
+            copyTo = end;
+        }
+        else
+        {
+            flushCopy();
+            formatted.append(id);
+        }
+    }
+    flushFormatted();
+    flushCopy();
+
+    if(!ok || target.error() != QFileDevice::NoError)
+    {
+        target.cancelWriting();
+        return false;
+    }
+    qint64 size = target.pos();
+
+    // Some platforms do not replace files which are still open
+    source.close();
+    delete m_file;
+    ok = target.commit();
+    openFile(filename());
+    if(!ok)
+    {
+        return false;
+    }
+
+    // Deleted games were dropped, they get an empty range at the next game
+    for(int i = offsets.count() - 1; i >= 0; --i)
+    {
+        if(offsets[i] < 0)
+        {
+            offsets[i] = size;
+        }
+        else
+        {
+            size = offsets[i];
+        }
+    }
+    setOffsets(offsets);
+    m_fileGames = static_cast<GameId>(m_count);
+    m_changedGames.clear();
+    m_allGamesChanged = false;
+    setDirty(false);
+    return true;
+}
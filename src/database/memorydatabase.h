@@ -12,9 +12,12 @@
 #define MEMORYDATABASE_H__
 
 #include <QMutex>
+#include <QSet>
 #include <QVector>
 #include "pgndatabase.h"
 
+class Output;
+
 /** @ingroup Database
    The MemoryDatabase class provides database access to PGN files.
    Games are stored in memory, and are editable.
@@ -39,7 +42,8 @@ public:
     virtual bool isReadOnly() const;
     /** @return whether the database was modified. */
     virtual bool isModified() const;
-    /** Set database dirty flag */
+    /** Set database dirty flag. Changes made this way are not tracked per game,
+        the next save() formats all games. */
     void setModified(bool b);
     /** Set database dirty flag */
     void startTransaction(bool b);
@@ -58,17 +62,35 @@ public:
     void loadGameMoves(GameId gameId, GameX& game);
     virtual int findPosition(GameId index, const BoardX& position);
 
+    /** Save the database to its file. Games not changed since the file was read
+        are copied from it byte for byte, the others are formatted by @p output.
+        The file is replaced atomically. @return false if the file could not be
+        written, it is left untouched then. */
+    bool save(Output& output, bool utf8);
+    /** @return true if the text of game @p gameId in the file is out of date */
+    bool isGameChanged(GameId gameId) const;
+    /** Record that game @p gameId needs to be formatted on save */
+    virtual void setGameChanged(GameId gameId);
+
 protected:
     virtual void parseGame();
     virtual bool hasIndexFile() const { return false; }
 
 private:
     bool parseFile();
+    /** Set the dirty flag without touching the change tracking */
+    void setDirty(bool b);
 
 private:
     QVector <GameX*> m_games;
     bool m_isModified {false};
     bool m_transaction {false};
+    /** Number of games with a byte range in the file */
+    GameId m_fileGames {0};
+    /** Games read from the file and changed since */
+    QSet<GameId> m_changedGames;
+    /** Set if the file offsets can no longer be trusted */
+    bool m_allGamesChanged {false};
     mutable QReadWriteLock m_mutex;
 };
 
@@ -9,15 +9,20 @@
  ***************************************************************************/
 
 #include <algorithm>
+#include <numeric>
 #include <QDataStream>
+#include <QFuture>
 #include <QMap>
+#include <QQueue>
 #include <QRegularExpression>
 #include <QTextStream>
+#include <QtConcurrent/QtConcurrent>
 #include "board.h"
 #include "output.h"
 #include "settings.h"
 #include "tags.h"
 #include "partialdate.h"
+#include "refcount.h"
 #include "qt6compat.h"
 
 
@@ -37,6 +42,7 @@ QMap<Output::OutputType, QString> Output::m_outputMap;
 Output::Output(OutputType output, BoardRenderingFunc renderer, const QString& pathToTemplateFile)
     : m_renderer(renderer)
     , m_outputType(output)
+    , m_fragmentSalt(0)
 {
     switch(m_outputType)
     {
@@ -489,11 +495,12 @@ QString Output::writeMainLine(MoveId upToNode)
                 {
                     text += m_endTagMap[MarkupColumnStyleMainline];
                 }
+                MoveId branch = m_game.currentMove();
                 for(int i = 0; i < variations.size(); ++i)
                 {
                     // *** Enter variation i, and write the rest of the moves
-                    m_game.dbMoveToId(variations[i]);
-                    text += writeVariation();
+                    text += writeVariationAt(variations[i]);
+                    m_game.dbMoveToId(branch);
                 }
                 if(hasNext && m_options.getOptionAsBool("ColumnStyle"))
                 {
@@ -501,7 +508,6 @@ QString Output::writeMainLine(MoveId upToNode)
                 }
             }
             m_dirtyBlack = true;
-            m_game.dbMoveToId(m_game.parentMove());
         }
         m_game.forward();
     } while(!m_game.atLineEnd());
@@ -553,19 +559,14 @@ QString Output::writeVariation()
                 mustAddStart = true;
             }
             QList<MoveId> variations = m_game.variations();
-            if(!variations.empty())
+            MoveId branch = m_game.currentMove();
+            for(int i = 0; i < variations.size(); ++i)
             {
-                for(int i = 0; i < variations.size(); ++i)
-                {
-                    // *** Enter variation i, and write the rest of the moves
-                    if (m_game.dbMoveToId(variations[i]))
-                    {
-                        text += writeVariation();
-                    }
-                }
+                // *** Enter variation i, and write the rest of the moves
+                text += writeVariationAt(variations[i]);
+                m_game.dbMoveToId(branch);
             }
             m_dirtyBlack = true;
-            m_game.dbMoveToId(m_game.parentMove());
         }
         m_game.forward();
 
@@ -590,6 +591,70 @@ QString Output::writeVariation()
     return text;
 }
 
+QString Output::writeVariationAt(MoveId variation)
+{
+    if(m_outputType != NotationWidget)
+    {
+        return m_game.dbMoveToId(variation) ? writeVariation() : QString();
+    }
+
+    // The text of a variation only depends on its own subtree, the position it
+    // branches from and the nesting level, as writeVariation() always starts
+    // with a fresh move number and restores the level when done.
+    quint64 key = m_fragmentSalt;
+    key = (key ^ m_game.board().getHashValue()) * Q_UINT64_C(0x100000001B3);
+    key = (key ^ static_cast<quint64>(m_currentVariationLevel)) * Q_UINT64_C(0x100000001B3);
+    key = (key ^ variationHash(variation)) * Q_UINT64_C(0x100000001B3);
+
+    auto it = m_fragments.constFind(variation);
+    if(it != m_fragments.constEnd() && it->key == key)
+    {
+        m_nextFragments.insert(variation, *it);
+        return it->text;
+    }
+
+    if(!m_game.dbMoveToId(variation))
+    {
+        return QString();
+    }
+    Fragment fragment;
+    fragment.key = key;
+    fragment.text = writeVariation();
+    m_nextFragments.insert(variation, fragment);
+    return fragment.text;
+}
+
+quint64 Output::variationHash(MoveId variation)
+{
+    auto it = m_variationHashes.constFind(variation);
+    if(it != m_variationHashes.constEnd())
+    {
+        return *it;
+    }
+
+    const GameCursor& cursor = m_game.cursor();
+    quint64 h = Q_UINT64_C(0xCBF29CE484222325);
+    for(MoveId node = variation; node != NO_MOVE; node = cursor.nextMove(node))
+    {
+        // Node ids are part of the rendered anchors, so they are hashed as well
+        h = (h ^ static_cast<quint64>(node)) * Q_UINT64_C(0x100000001B3);
+        h = (h ^ cursor.move(node).rawMove()) * Q_UINT64_C(0x100000001B3);
+        h = (h ^ qHash(m_game.annotation(node, GameX::BeforeMove))) * Q_UINT64_C(0x100000001B3);
+        h = (h ^ qHash(m_game.annotation(node, GameX::AfterMove))) * Q_UINT64_C(0x100000001B3);
+        foreach(Nag nag, m_game.nags(node))
+        {
+            h = (h ^ static_cast<quint64>(nag)) * Q_UINT64_C(0x100000001B3);
+        }
+        foreach(MoveId sub, cursor.variations(node))
+        {
+            h = (h ^ variationHash(sub)) * Q_UINT64_C(0x100000001B3);
+        }
+        h = (h ^ Q_UINT64_C(0xFF)) * Q_UINT64_C(0x100000001B3);
+    }
+    m_variationHashes.insert(variation, h);
+    return h;
+}
+
 QString Output::writeTag(const QString& tagName, const QString& tagValue) const
 {
     QString text = m_startTagMap[MarkupHeaderLine] +
@@ -753,9 +818,10 @@ QString Output::output(const GameX* game, bool upToCurrentMove)
     QString text = m_header;
     postProcessOutput(text);
 
-    text += outputTags(game);
+    m_game = *game;
+    text += writeTags();
 
-    QString gameText = outputGame(game, upToCurrentMove);
+    QString gameText = writeGame(upToCurrentMove);
     postProcessOutput(gameText);
     text += gameText;
 
@@ -768,8 +834,13 @@ QString Output::output(const GameX* game, bool upToCurrentMove)
 
 QString Output::outputTags(const GameX* game)
 {
-    QString text;
     m_game = *game;
+    return writeTags();
+}
+
+QString Output::writeTags() const
+{
+    QString text;
     if(m_options.getOptionAsBool("ShowHeader"))
     {
         text += m_startTagMap[MarkupHeaderBlock];
@@ -786,13 +857,18 @@ QString Output::outputTags(const GameX* game)
     return text;
 }
 
-QString Output::outputGame(const GameX* g, bool upToCurrentMove)
+QString Output::writeGame(bool upToCurrentMove)
 {
     QString text;
-    m_game = *g;
     int id = m_game.currentMove();
     int mainId = upToCurrentMove ? m_game.cursor().mainLineMove() : NO_MOVE;
     m_currentVariationLevel = 0;
+    if(m_outputType == NotationWidget)
+    {
+        m_variationHashes.clear();
+        m_fragmentSalt = static_cast<quint64>(m_game.textFilter2())
+                         | (AppSettings->getValue("/GameText/ShowDiagrams").toBool() ? 0x100 : 0);
+    }
 
     m_game.moveToStart();
     m_dirtyBlack = m_game.board().toMove() == Black;
@@ -815,6 +891,9 @@ QString Output::outputGame(const GameX* g, bool upToCurrentMove)
     text += m_endTagMap[MarkupNotationBlock];
     text += m_startTagMap[MarkupResult] + m_game.tag(TagNameResult) + m_endTagMap[MarkupResult];
 
+    // Keep only the variations still present in the game
+    m_fragments.swap(m_nextFragments);
+    m_nextFragments.clear();
     m_game.dbMoveToId(id);
 
     return text;
@@ -852,72 +931,109 @@ void Output::postProcessOutput(QString& text) const
     }
 }
 
-void Output::outputUtf8(QTextStream& out, FilterX& filter)
+QByteArray Output::exportChunk(Database* database, QVector<GameId> games, bool utf8, qint64* sizes)
 {
-    int percentDone = 0;
-    GameX game;
-    QString header = m_header;
-    postProcessOutput(header);
-    out << header;
-
-    for(int i = 0; i < filter.count(); ++i)
+    QString text;
+    QByteArray bytes;
+    for(int i = 0; i < games.count(); ++i)
     {
-        if(filter.database()->loadGame(i, game))
+        // Load straight into m_game, there is no need for another copy
+        if(database->loadGame(games[i], m_game))
         {
-            QString tagText = outputTags(&game);
-            out << tagText;
+            text += writeTags();
 
-            QString outText = outputGame(&game, false);
-            postProcessOutput(outText);
-            out << outText;
-            out << "\n\n";
+            QString gameText = writeGame(false);
+            postProcessOutput(gameText);
+            text += gameText;
+            text += "\n\n";
         }
-        int percentDone2 = (i + 1) * 100 / filter.count();
-        if(percentDone2 > percentDone)
+        if(sizes)
         {
-            emit progress((percentDone = percentDone2));
+            // Encode game by game to know where each one ends
+            qint64 before = bytes.size();
+            bytes += utf8 ? text.toUtf8() : text.toLatin1();
+            sizes[i] = bytes.size() - before;
+            text.clear();
         }
     }
-
-    QString footer = m_footer;
-    postProcessOutput(footer);
-    out << footer;
+    if(sizes)
+    {
+        return bytes;
+    }
+    return utf8 ? text.toUtf8() : text.toLatin1();
 }
 
-void Output::outputLatin1(QDataStream& out, FilterX& filter)
+void Output::exportGames(QIODevice& device, Database& database, const QVector<GameId>& games, bool utf8, QVector<qint64>* sizes)
 {
-    int percentDone = 0;
-    GameX game;
+    if(sizes)
+    {
+        sizes->fill(0, games.count());
+    }
+
     QString header = m_header;
     postProcessOutput(header);
-    QByteArray b = header.toLatin1();
-    out.writeRawData(b, b.length());
+    device.write(utf8 ? header.toUtf8() : header.toLatin1());
+
+    RefKeeper keeper(database.refCounter());
 
-    for(int i = 0; i < filter.count(); ++i)
+    // PGN output neither renders diagrams nor reads settings, so chunks can be
+    // formatted by private Output objects on worker threads. At most maxChunks
+    // are in flight, they are written in the original order.
+    // A single chunk is formatted right here, saving the setup of the workers.
+    const int chunkSize = 256;
+    const int maxChunks = (m_outputType == Pgn && games.count() > chunkSize) ? 2 * qMax(1, QThread::idealThreadCount()) : 0;
+    QList<Output*> workers;
+    for(int i = 0; i < maxChunks; ++i)
     {
-        if(filter.database()->loadGame(i, game))
-        {
-            QString tagText = outputTags(&game);
-            b = tagText.toLatin1();
-            out.writeRawData(b, b.length());
+        // Options and markup set at runtime are not part of the template
+        Output* worker = new Output(m_outputType, nullptr, m_templateFilename);
+        worker->m_options = m_options;
+        worker->m_startTagMap = m_startTagMap;
+        worker->m_endTagMap = m_endTagMap;
+        worker->m_expandable = m_expandable;
+        workers.append(worker);
+    }
 
-            QString outText = outputGame(&game, false);
-            postProcessOutput(outText);
-            outText.append("\n\n");
-            b = outText.toLatin1();
-            out.writeRawData(b, b.length());
+    QQueue<QFuture<QByteArray> > pending;
+    int percentDone = 0;
+    int next = 0;
+    int written = 0;
+    int chunk = 0;
+    while(written < games.count())
+    {
+        if(workers.isEmpty())
+        {
+            device.write(exportChunk(&database, games.mid(next, chunkSize), utf8, sizes ? sizes->data() + next : nullptr));
+            next += chunkSize;
+        }
+        else
+        {
+            while(next < games.count() && pending.count() < maxChunks)
+            {
+                Output* worker = workers[chunk++ % maxChunks];
+                qint64* chunkSizes = sizes ? sizes->data() + next : nullptr;
+#if QT_VERSION < 0x060000
+                pending.enqueue(QtConcurrent::run(worker, &Output::exportChunk, &database, games.mid(next, chunkSize), utf8, chunkSizes));
+#else
+                pending.enqueue(QtConcurrent::run(&Output::exportChunk, worker, &database, games.mid(next, chunkSize), utf8, chunkSizes));
+#endif
+                next += chunkSize;
+            }
+            device.write(pending.dequeue().result());
         }
-        int percentDone2 = (i + 1) * 100 / filter.count();
+        written = qMin(written + chunkSize, games.count());
+
+        int percentDone2 = static_cast<int>(qint64(written) * 100 / games.count());
         if(percentDone2 > percentDone)
         {
             emit progress((percentDone = percentDone2));
         }
     }
+    qDeleteAll(workers);
 
     QString footer = m_footer;
     postProcessOutput(footer);
-    b = footer.toLatin1();
-    out.writeRawData(b, b.length());
+    device.write(utf8 ? footer.toUtf8() : footer.toLatin1());
 }
 
 void Output::outputUtf8(QTextStream& out, Database& database)
@@ -937,7 +1053,7 @@ void Output::outputUtf8(QTextStream& out, Database& database)
             QString tagText = outputTags(&game);
             out << tagText;
 
-            QString outText = outputGame(&game, false);
+            QString outText = writeGame(false);
             postProcessOutput(outText);
             out << outText;
             out << "\n\n";
@@ -956,44 +1072,6 @@ void Output::outputUtf8(QTextStream& out, Database& database)
     database.setModified(false);
 }
 
-void Output::outputLatin1(QDataStream& out, Database& database)
-{
-    QString header = m_header;
-    postProcessOutput(header);
-    QByteArray b = header.toLatin1();
-    out.writeRawData(b, b.length());
-
-    int percentDone = 0;
-    GameX game;
-    for(int i = 0; i < (int)database.count(); ++i)
-    {
-        if(database.loadGame(i, game))
-        {
-            QString tagText = outputTags(&game);
-            b = tagText.toLatin1();
-            out.writeRawData(b, b.length());
-
-            QString outText = outputGame(&game, false);
-            postProcessOutput(outText);
-            outText.append("\n\n");
-            b = outText.toLatin1();
-            out.writeRawData(b, b.length());
-        }
-        int percentDone2 = (i + 1) * 100 / database.count();
-        if(percentDone2 > percentDone)
-        {
-            emit progress((percentDone = percentDone2));
-        }
-    }
-
-    QString footer = m_footer;
-    postProcessOutput(footer);
-    b = footer.toLatin1();
-    out.writeRawData(b, b.length());
-
-    database.setModified(false);
-}
-
 void Output::output(const QString& filename, const GameX& game)
 {
     QFile f(filename);
@@ -1022,51 +1100,44 @@ void Output::output(const QString& filename, FilterX& filter, bool utf8)
     {
         return;
     }
-    if (utf8)
-    {
-        QTextStream out(&f);
-        outputUtf8(out, filter);
-    }
-    else
+    QVector<GameId> games;
+    games.reserve(filter.count());
+    for(GameId i = 0; i < filter.size(); ++i)
     {
-        QDataStream out(&f);
-        outputLatin1(out, filter);
+        if(filter.contains(i))
+        {
+            games.append(i);
+        }
     }
+    exportGames(f, *filter.database(), games, utf8);
     f.close();
 }
 
 void Output::output(const QString& filename, Database& database)
 {
-    QFile f(filename);
-    if(!f.open(QIODevice::WriteOnly | QIODevice::Text))
-    {
-        return;
-    }
-    if((m_outputType == Html) || (m_outputType == NotationWidget) ||
-       (m_outputType == Pgn && database.isUtf8()))
-    {
-        QTextStream out(&f);
-        outputUtf8(out, database);
-    }
-    else
-    {
-        QDataStream out(&f);
-        outputLatin1(out, database);
-    }
-
-    f.close();
+    bool utf8 = (m_outputType == Html) || (m_outputType == NotationWidget) ||
+                (m_outputType == Pgn && database.isUtf8());
+    output(filename, database, utf8);
 }
 
 void Output::outputLatin1(const QString& filename, Database& database)
+{
+    output(filename, database, false);
+}
+
+void Output::output(const QString& filename, Database& database, bool utf8)
 {
     QFile f(filename);
     if(!f.open(QIODevice::WriteOnly | QIODevice::Text))
     {
         return;
     }
-    QDataStream out(&f);
-    outputLatin1(out, database);
+    QVector<GameId> games(static_cast<int>(database.count()));
+    std::iota(games.begin(), games.end(), GameId(0));
+    exportGames(f, database, games, utf8);
     f.close();
+
+    database.setModified(false);
 }
 
 QString Output::output(Database* database)
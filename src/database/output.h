@@ -134,11 +134,18 @@ public:
      *               after the other, using the output(GameX* game) method */
     void output(const QString& filename, Database& database);
     void outputLatin1(const QString& filename, Database& database);
+    /** Create the output for the given database using the given encoding */
+    void output(const QString& filename, Database& database, bool utf8);
     /** Create the output for the given database
      * @param database A pointer to a database object. All games in the database will be output, one
      *               after the other, using the output(GameX* game) method */
     QString output(Database* database);
 
+    /** Write the games @p games of @p database to @p device.
+     * PGN is formatted in parallel, in chunks of games written in order.
+     * If @p sizes is given, it receives the number of bytes written for each game. */
+    void exportGames(QIODevice& device, Database& database, const QVector<GameId>& games, bool utf8, QVector<qint64>* sizes = nullptr);
+
     /** Append output to a closed file */
     bool append(const QString& filename, GameX& game);
     /** Append a database to a closed file */
@@ -180,6 +187,20 @@ private:
     QString m_newlineChar;
     /** Pointer to the game being exported */
     GameX m_game;
+    /** A rendered variation, valid as long as its key matches */
+    struct Fragment
+    {
+        quint64 key;
+        QString text;
+    };
+    /** Variations rendered by the previous writeGame() call, keyed by first move */
+    QHash<MoveId, Fragment> m_fragments;
+    /** Variations rendered by the running writeGame() call */
+    QHash<MoveId, Fragment> m_nextFragments;
+    /** Content hash of each variation subtree, valid during one writeGame() call */
+    QHash<MoveId, quint64> m_variationHashes;
+    /** Settings outside the template which influence the rendered text */
+    quint64 m_fragmentSalt;
     /** Map containing the different types of outputs available, and a description of each */
     static QMap<OutputType, QString> m_outputMap;
     /** Map containing the start markup tag for each markup type */
@@ -224,21 +245,19 @@ private:
     /** Reload default tag settings */
     void reset();
 
-    /** Create the output for the given filter
-     * @param out A textstream that will be used to write the results to
-     * @param filter A Filter object. All games in the filter will be output, one
-     *               after the other, using the output(GameX* game) method */
-    void outputUtf8(QTextStream& out, FilterX& filter);
-    void outputLatin1(QDataStream& out, FilterX& filter);
     /** Create the output for the given database
      * @param out A textstream that will be used to write the results to
      * @param database A pointer to a database object. All games in the database will be output, one
      *               after the other, using the output(GameX* game) method */
     void outputUtf8(QTextStream& out, Database& database);
-    void outputLatin1(QDataStream& out, Database& database);
+    /** Load and format the games @p games, runs on a worker thread for exportGames().
+     * If @p sizes is given, the number of bytes written for each game is stored there. */
+    QByteArray exportChunk(Database* database, QVector<GameId> games, bool utf8, qint64* sizes);
 
-    /** Output of a single game - requires postProcessing */
-    QString outputGame(const GameX *g, bool upToCurrentMove);
+    /** Output of the game in m_game - requires postProcessing */
+    QString writeGame(bool upToCurrentMove);
+    /** Output of the tags of the game in m_game */
+    QString writeTags() const;
     /** postProcessing of a game output or a dataBase output */
     void postProcessOutput(QString& text) const;
 
@@ -253,6 +272,12 @@ private:
     QString writeMainLine(MoveId upToNode);
     /** Writes a variation, including sub variations */
     QString writeVariation();
+    /** Enters variation @p variation of the current node and writes it, reusing
+     *  the text of the last output if the variation subtree did not change.
+     *  The cursor position after the call is unspecified. */
+    QString writeVariationAt(MoveId variation);
+    /** @return hash of all moves, annotations and nags in the line starting at @p variation */
+    quint64 variationHash(MoveId variation);
     /** Writes a game tag */
     QString writeTag(const QString& tagName, const QString& tagValue) const;
     /** Writes all game tags */
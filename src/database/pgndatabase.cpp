@@ -10,11 +10,14 @@
  *   (at your option) any later version.                                   *
  ***************************************************************************/
 
+#include <climits>
+#include <QCryptographicHash>
 #include <QDir>
 #include <QStringList>
 #include <QtDebug>
 #include <QMutexLocker>
 #include <QRegularExpression>
+#include <QSaveFile>
 #include "board.h"
 #include "nag.h"
 
@@ -24,6 +27,11 @@
 
 using namespace chessx;
 
+/** Written in host byte order, index files from machines with another byte order are rebuilt */
+#define INDEX_BYTE_ORDER_MARK 0x01020304
+/** Size of the indexed data in front of its end which must be unchanged to index appended games only */
+#define INDEX_TAIL_SIZE 0x10000
+
 #if defined(_MSC_VER) && defined(_DEBUG)
 #define DEBUG_NEW new( _NORMAL_BLOCK, __FILE__, __LINE__ )
 #define new DEBUG_NEW
@@ -59,9 +67,9 @@ void PgnDatabase::parseGame()
     skipMoves();
 }
 
-bool PgnDatabase::readIndexFile(QDataStream &in, volatile bool* breakFlag, short version)
+bool PgnDatabase::readIndexFile(QDataStream &in, const QSharedPointer<const FileMapping>& mapping, volatile bool* breakFlag, short version)
 {
-    return (index()->read(in, breakFlag, version));
+    return (index()->read(in, mapping, breakFlag, version));
 }
 
 bool PgnDatabase::writeIndexFile(QDataStream& out) const
@@ -83,7 +91,24 @@ bool PgnDatabase::hasIndexFile() const
     return AppSettings->getValue("/General/useIndexFile").toBool();
 }
 
-bool PgnDatabase::readOffsetFile(const QString& filename, volatile bool *breakFlag, bool& bUpdate)
+/** @return a hash of the last bytes of the first @p size bytes of @p filename, empty on errors */
+static QByteArray tailHash(const QString& filename, qint64 size)
+{
+    QFile file(filename);
+    qint64 start = qMax<qint64>(0, size - INDEX_TAIL_SIZE);
+    if(size <= 0 || !file.open(QIODevice::ReadOnly) || !file.seek(start))
+    {
+        return QByteArray();
+    }
+    QByteArray tail = file.read(size - start);
+    if(tail.size() != size - start)
+    {
+        return QByteArray();
+    }
+    return QCryptographicHash::hash(tail, QCryptographicHash::Sha1);
+}
+
+bool PgnDatabase::readOffsetFile(const QString& filename, volatile bool *breakFlag, bool& bUpdate, bool& bGrown)
 {
     if(!hasIndexFile())
     {
@@ -117,57 +142,87 @@ bool PgnDatabase::readOffsetFile(const QString& filename, volatile bool *breakFl
     QString basefile;
     QDateTime lastModified;
 
+    qint64 indexedSize = -1;
+    QByteArray indexedTail;
+
     in >> basefile;
     in >> lastModified;
+    if(version >= VERSION_INDEX_2_1)
+    {
+        in >> indexedSize;
+        in >> indexedTail;
+    }
 
     if(basefile != fi.completeBaseName())
     {
         return false;
     }
 
+    // A file which only grew is still indexed up to its former end
+    bGrown = false;
     QDateTime lastModifiedStored = fi.lastModified();
     if(lastModified != lastModifiedStored)
+    {
+        if(!canIndexAppendedGames() || indexedSize <= 0 || fi.size() <= indexedSize ||
+           indexedTail.isEmpty() || indexedTail != tailHash(filename, indexedSize))
+        {
+            return false;
+        }
+        bGrown = true;
+    }
+
+    // The offsets and the tag index are used in place from the mapped file
+    QSharedPointer<const FileMapping> mapping = FileMapping::map(file.fileName());
+    quint32 byteOrder = 0;
+    in.readRawData(reinterpret_cast<char*>(&byteOrder), sizeof(byteOrder));
+    if (!mapping || byteOrder != INDEX_BYTE_ORDER_MARK)
     {
         return false;
     }
 
     in >> m_allocated;
     in >> bUse64bit;
+    if(bGrown && !bUse64bit && fi.size() > INT_MAX)
+    {
+        m_allocated = 0;
+        return false;
+    }
 
     emit progress(1);
 
-    in >> m_gameOffsets64;
-    emit progress(5);
-    in >> m_gameOffsets32;
-    emit progress(10);
-
+    bool ok;
     if (bUse64bit)
     {
-        if (m_gameOffsets32.count())
-        {
-            m_allocated     = 0;
-            m_gameOffsets32.clear();
-            m_gameOffsets64.clear();
-            return false;
-        }
+        m_gameOffsets32.clear();
+        ok = readMappedArray(in, mapping, m_gameOffsets64) && (m_gameOffsets64.count() == m_allocated);
     }
     else
     {
-        if (m_gameOffsets64.count())
-        {
-            m_allocated     = 0;
-            m_gameOffsets32.clear();
-            m_gameOffsets64.clear();
-            return false;
-        }
+        m_gameOffsets64.clear();
+        ok = readMappedArray(in, mapping, m_gameOffsets32) && (m_gameOffsets32.count() == m_allocated);
     }
+    if (!ok)
+    {
+        m_allocated     = 0;
+        m_gameOffsets32.clear();
+        m_gameOffsets64.clear();
+        return false;
+    }
+    emit progress(10);
 
     in >> magic;
     if (*breakFlag || (magic != INDEX_FILE_MAGIC)) return false;
 
     emit progress(20);
 
-    readIndexFile(in, breakFlag, version);
+    if (!readIndexFile(in, mapping, breakFlag, version))
+    {
+        m_index.clear();
+        m_gameOffsets32.clear();
+        m_gameOffsets64.clear();
+        m_allocated     = 0;
+        return false;
+    }
     bUpdate = (version < VERSION_INDEX_CURRENT);
 
     emit progress(80);
@@ -193,7 +248,8 @@ bool PgnDatabase::writeOffsetFile(const QString& filename) const
         return false;
     }
 
-    QFile file(offsetFilename(filename));
+    // Written aside and renamed, as the old file may still be mapped
+    QSaveFile file(offsetFilename(filename));
     if(!file.open(QIODevice::WriteOnly))
     {
         return false;
@@ -214,11 +270,22 @@ bool PgnDatabase::writeOffsetFile(const QString& filename) const
 
     out << basefile;
     out << fi.lastModified().toUTC();
+    out << fi.size();
+    out << tailHash(filename, fi.size());
+
+    quint32 byteOrder = INDEX_BYTE_ORDER_MARK;
+    out.writeRawData(reinterpret_cast<const char*>(&byteOrder), sizeof(byteOrder));
 
     out << m_count;
     out << bUse64bit;
-    out << m_gameOffsets64;
-    out << m_gameOffsets32;
+    if (bUse64bit)
+    {
+        writeMappedArray(out, m_gameOffsets64.constData(), int(m_count));
+    }
+    else
+    {
+        writeMappedArray(out, m_gameOffsets32.constData(), int(m_count));
+    }
     out << magic;
 
     writeIndexFile(out);
@@ -226,18 +293,96 @@ bool PgnDatabase::writeOffsetFile(const QString& filename) const
     unsigned short finalMagic = 0x55ec;
     out << finalMagic;
 
-    return true;
+    return (out.status() == QDataStream::Ok) && file.commit();
+}
+
+void PgnDatabase::detachFromOffsetFile()
+{
+    m_gameOffsets32.detach();
+    m_gameOffsets64.detach();
+    m_index.detach();
+}
+
+QString PgnDatabase::commentIndexFilename() const
+{
+    QString name = offsetFilename(m_filename);
+    name.chop(QString(".cxi").length());
+    return name + ".cci";
+}
+
+bool PgnDatabase::readCommentIndex(CommentIndex& commentIndex)
+{
+    if(!hasIndexFile())
+    {
+        return false;
+    }
+
+    QFile file(commentIndexFilename());
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    QDataStream in(&file);
+    QString basefile;
+    QDateTime lastModified;
+    qint64 size;
+    in >> basefile;
+    in >> lastModified;
+    in >> size;
+
+    QFileInfo fi = QFileInfo(m_filename);
+    if(basefile != fi.completeBaseName() || lastModified != fi.lastModified() || size != fi.size())
+    {
+        return false;
+    }
+    return commentIndex.read(in);
+}
+
+void PgnDatabase::writeCommentIndex(const CommentIndex& commentIndex) const
+{
+    if(!hasIndexFile())
+    {
+        return;
+    }
+
+    QSaveFile file(commentIndexFilename());
+    if(!file.open(QIODevice::WriteOnly))
+    {
+        return;
+    }
+
+    QDataStream out(&file);
+    QFileInfo fi = QFileInfo(m_filename);
+    out << fi.completeBaseName();
+    out << fi.lastModified().toUTC();
+    out << fi.size();
+    if(commentIndex.write(out))
+    {
+        file.commit();
+    }
 }
 
 bool PgnDatabase::parseFile()
 {
     bool bUpdate = false;
-    if(readOffsetFile(m_filename, &m_break, bUpdate))
+    bool bGrown = false;
+    if(readOffsetFile(m_filename, &m_break, bUpdate, bGrown))
     {
         m_count = m_allocated;
+        if (bGrown)
+        {
+            detachFromOffsetFile();
+            if (!parseAppendedGames())
+            {
+                return false;
+            }
+            bUpdate = true;
+        }
         emit progress(99);
         if (bUpdate)
         {
+            detachFromOffsetFile();
             writeOffsetFile(m_filename);
         }
         emit progress(100);
@@ -257,16 +402,35 @@ bool PgnDatabase::parseFile()
     return ok;
 }
 
+bool PgnDatabase::parseAppendedGames()
+{
+    // The last indexed game is indexed again, the appended data might continue it
+    IndexBaseType start = 0;
+    if (m_count)
+    {
+        --m_count;
+        start = offset(m_count);
+    }
+    if (!m_file->seek(start))
+    {
+        return false;
+    }
+    m_lineBuffer.clear();
+    m_currentLine.clear();
+    return parseFileIntern();
+}
+
 bool PgnDatabase::parseFileIntern()
 {
-    //indexing game positions in the file, game contents are ignored
+    //indexing game positions in the file from the current position on, game contents are ignored
     qint64 size = m_file->size();
+    qint64 start = m_file->pos();
     int oldFp = -3;
 
     qint64 countDiff = size / 100;
-    qint64 nextDiff = countDiff;
-    percentDone = 0;
-    m_index.reserve(size/1000);
+    percentDone = countDiff ? int(start / countDiff) : 0;
+    qint64 nextDiff = countDiff * (percentDone + 1);
+    m_index.reserve((size - start)/1000);
 
     while(!m_file->atEnd() || !m_currentLine.isEmpty())
     {
@@ -417,6 +581,10 @@ int PgnDatabase::findPosition(GameId index, const BoardX &position)
 {
     GameX g;
     loadGameMoves(index, g);
+    if(!m_index.hasSignature(index))
+    {
+        m_index.setSignature(index, GameSignature(g));
+    }
     return g.cursor().findPosition(position);
 }
 
@@ -816,22 +984,41 @@ void PgnDatabase::parseLine(GameX* game)
     }
 }
 
-inline void PgnDatabase::parseMoveToken(GameX* game, QString token)
+inline void PgnDatabase::parseMoveToken(GameX* game, const QStringRef& token)
 {
-    if (token.startsWith("..."))
+    int start = 0;
+    if (token.length() >= 3 && token.at(0) == '.' && token.at(1) == '.' && token.at(2) == '.')
     {
         white = false;
         found = true;
-        token.remove(0,3);
+        start = 3;
     }
-    else if (token.startsWith("."))
+    else if (token.at(0) == '.')
     {
         white = true;
         found = true;
-        token.remove(0,1);
+        start = 1;
     }
 
-    if (token.isEmpty()) return;
+    int length = token.length() - start;
+    if (length <= 0) return;
+
+    // Hand the move to the parser as bytes, a SAN token fits on the stack
+    char buffer[16];
+    QByteArray longToken;
+    const char* san = buffer;
+    if (length < int(sizeof(buffer)))
+    {
+        for (int i = 0; i < length; ++i)
+        {
+            buffer[i] = token.at(start + i).toLatin1();
+        }
+    }
+    else
+    {
+        longToken = token.mid(start).toLatin1();
+        san = longToken.constData();
+    }
 
     if(m_newVariation)
     {
@@ -847,7 +1034,7 @@ inline void PgnDatabase::parseMoveToken(GameX* game, QString token)
             }
         }
         game->backward();
-        m_variation = game->dbAddSanVariation(token, QString());
+        m_variation = game->dbAddSanVariation(san, size_t(length));
         if(!m_precomment.isEmpty())
         {
             game->dbSetAnnotation(m_precomment, m_variation, GameX::BeforeMove);
@@ -858,7 +1045,7 @@ inline void PgnDatabase::parseMoveToken(GameX* game, QString token)
     }
     else
     {
-        m_variation = game->dbAddSanMove(token, QString());
+        m_variation = game->dbAddSanMove(san, size_t(length));
         if(!m_precomment.isEmpty())
         {
             game->dbSetAnnotation(m_precomment, m_variation, GameX::BeforeMove);
@@ -981,7 +1168,7 @@ void PgnDatabase::parseToken(GameX* game, const QStringRef& token)
             m_gameOver = true;
             break;
         }
-        parseMoveToken(game, token.toString());
+        parseMoveToken(game, token);
         break;
 
     case '0':
@@ -991,7 +1178,7 @@ void PgnDatabase::parseToken(GameX* game, const QStringRef& token)
             m_gameOver = true;
             break;
         }
-        parseMoveToken(game, token.toString());
+        parseMoveToken(game, token);
         break;
 
     case 'Z':
@@ -1001,7 +1188,7 @@ void PgnDatabase::parseToken(GameX* game, const QStringRef& token)
             game->dbAddNag(BlackHasAModerateAdvantage);
             break;
         }
-        parseMoveToken(game, token.toString());
+        parseMoveToken(game, token);
         break;
 
     default:
@@ -1012,7 +1199,7 @@ void PgnDatabase::parseToken(GameX* game, const QStringRef& token)
         }
         else
         {
-            parseMoveToken(game, token.toString());
+            parseMoveToken(game, token);
         }
         break;
     }
@@ -1194,6 +1381,25 @@ IndexBaseType PgnDatabase::offset(GameId gameId) const
     }
 }
 
+void PgnDatabase::setOffsets(const QVector<qint64>& offsets)
+{
+    bUse64bit = !offsets.isEmpty() && offsets.last() > INT_MAX;
+    m_gameOffsets32.clear();
+    m_gameOffsets64.clear();
+    for(qint64 offset : offsets)
+    {
+        if(bUse64bit)
+        {
+            m_gameOffsets64.append(offset);
+        }
+        else
+        {
+            m_gameOffsets32.append(static_cast<quint32>(offset));
+        }
+    }
+    m_allocated = offsets.count();
+}
+
 bool PgnDatabase::get64bit() const
 {
     return bUse64bit;
@@ -1233,11 +1439,11 @@ bool PgnDatabase::addOffset(IndexBaseType offset)
 
     if(bUse64bit)
     {
-        m_gameOffsets64[m_count] = offset;
+        m_gameOffsets64.set(m_count, offset);
     }
     else
     {
-        m_gameOffsets32[m_count] = offset;
+        m_gameOffsets32.set(m_count, offset);
     }
     ++m_count;
     return true;
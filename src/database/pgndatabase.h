@@ -19,6 +19,7 @@
 #include <QVector>
 
 #include "database.h"
+#include "mappedarray.h"
 
 /** @ingroup Database
    The PgnDatabase class provides database access to PGN files.
@@ -71,7 +72,7 @@ protected:
     char peek(QStringRef::const_iterator s);
     void splitTokenList(QVector<QStringRef>& list);
     /** Parses a move token from the file */
-    void parseMoveToken(GameX* game, QString token);
+    void parseMoveToken(GameX* game, const QStringRef& token);
     /** Parses a token from the file */
     void parseToken(GameX* game, const QStringRef &token);
     /** Parses a comment from the file */
@@ -88,16 +89,27 @@ protected:
     void parseTagIntoIndex(const QString &tag, QString value);
 
     bool parseFileIntern();
+    /** Index the games appended to the file since the index file was written */
+    bool parseAppendedGames();
     virtual void parseGame();
 
-    bool readIndexFile(QDataStream& in, volatile  bool *breakFlag, short version);
-    bool writeIndexFile(QDataStream& out) const;
-    QString offsetFilename(const QString& filename) const;
-    bool readOffsetFile(const QString&, volatile bool *breakFlag, bool &bUpdate);
+    virtual bool readIndexFile(QDataStream& in, const QSharedPointer<const FileMapping>& mapping, volatile bool *breakFlag, short version);
+    virtual bool writeIndexFile(QDataStream& out) const;
+    virtual QString offsetFilename(const QString& filename) const;
+    /** @return true if offsets of games appended to the file continue the stored ones */
+    virtual bool canIndexAppendedGames() const { return true; }
+    /** Read the index file, @p bGrown is set if games were appended to the file after it was written */
+    bool readOffsetFile(const QString&, volatile bool *breakFlag, bool &bUpdate, bool &bGrown);
     bool writeOffsetFile(const QString&) const;
+    /** Stop using the index file in place, so that it can be replaced */
+    void detachFromOffsetFile();
+    /** @return the name of the comment index file, next to the index file */
+    QString commentIndexFilename() const;
+    virtual bool readCommentIndex(CommentIndex& commentIndex);
+    virtual void writeCommentIndex(const CommentIndex& commentIndex) const;
 
     // Open a PGN data File
-    bool openFile(const QString& filename);
+    virtual bool openFile(const QString& filename);
 
     bool hasIndexFile() const;
 
@@ -117,6 +129,11 @@ protected:
     void prepareNextLineForMoveParser();
     void prepareNextLine();
 
+    /** @return the file offset at which game @p gameId starts */
+    IndexBaseType offset(GameId gameId) const;
+    /** Replace all game offsets, e.g. after the file was rewritten */
+    void setOffsets(const QVector<qint64>& offsets);
+
 protected:
 	IndexBaseType m_count; // Should actually be a GameId - but cannot be changed due to serialization issues
 	QPointer<QIODevice> m_file;
@@ -126,7 +143,6 @@ private:
 
     /** Adds the current file position as a new offset */
     bool addOffset(IndexBaseType offset);
-    IndexBaseType offset(GameId gameId) const;
 
     //file variables
     QString m_filename;
@@ -144,8 +160,8 @@ private:
 
     //game index
     IndexBaseType m_allocated;
-    QVector<quint32> m_gameOffsets32;
-    QVector<quint64> m_gameOffsets64;
+    MappedArray<quint32> m_gameOffsets32;
+    MappedArray<quint64> m_gameOffsets64;
     QByteArray m_lineBuffer;
     QStack<MoveId> m_variationStack;
     int percentDone;
@@ -12,6 +12,9 @@
 /* Documentation for managing QDataset version, see
 http://doc.trolltech.com/4.0/qdatastream.html
 */
+#include <algorithm>
+#include <cstring>
+#include <QtEndian>
 #include "playerdatabase.h"
 
 #if defined(_MSC_VER) && defined(_DEBUG)
@@ -24,6 +27,44 @@ static quint32 Version = (quint32)100; // file format version
 static QString Mapfile_suffix = QStringLiteral(".cpm");
 static QString Datafile_suffix = QStringLiteral(".cpd");
 
+// Mapped format, all numbers big endian as written by QDataStream
+// map file:  magic, version, number of players,
+//            per player (name hash, name offset, data offset) sorted by hash,
+//            names in sorted order as (quint16 length, utf8)
+// data file: magic, version,
+//            per player first and last elo list index, estimated and peak elo,
+//            qint16 elo for each list from first to last (0 if not rated),
+//            then date of birth, date of death, country, title, photo, biography
+static quint32 MappedVersion = (quint32)200;
+static const int MappedHeaderSize = 12;
+static const int MappedEntrySize = 12;
+static const int MappedRecordEloOffset = 16;
+
+static quint32 nameHash(const QByteArray& name)
+{
+    quint32 hash = 2166136261u; // FNV-1a, must not change between runs
+    for(char c : name)
+    {
+        hash ^= (uchar)c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+PlayerDatabase::PlayerDatabase() :
+    m_nplayers(0),
+    m_npending_adds(0),
+    m_nplayers_offset(0),
+    m_dataFileCurrentPosition(0),
+    m_dirty(false),
+    m_mapped(false),
+    m_mapData(nullptr),
+    m_mapSize(0),
+    m_data(nullptr),
+    m_dataSize(0)
+{
+}
+
 bool PlayerDatabase::create(const QString& fname)
 {
     m_dirty = false;
@@ -88,6 +129,11 @@ bool PlayerDatabase::open(const QString& fname)
         m_mapfile.close();
         return false;
     }
+    if(map_version == MappedVersion)
+    {
+        m_datafile.setFileName(fname + Datafile_suffix);
+        return openMapped();
+    }
 // set QDataset format version to use
     if(map_version == (quint32)100)
     {
@@ -156,6 +202,286 @@ bool PlayerDatabase::open(const QString& fname)
 
 }
 
+bool PlayerDatabase::openMapped()
+{
+    m_mapds.setDevice(nullptr);
+    m_mapSize = m_mapfile.size();
+    m_mapData = m_mapfile.map(0, m_mapSize);
+    if(m_datafile.open(QIODevice::ReadOnly))
+    {
+        m_dataSize = m_datafile.size();
+        m_data = m_datafile.map(0, m_dataSize);
+    }
+    if(!m_mapData || !m_data || m_mapSize < MappedHeaderSize || m_dataSize < 8
+            || qFromBigEndian<quint32>(m_data) != Magic
+            || qFromBigEndian<quint32>(m_data + 4) != MappedVersion)
+    {
+        closeMapped();
+        return false;
+    }
+    m_nplayers = qFromBigEndian<qint32>(m_mapData + 8);
+    if(m_nplayers < 0 || MappedHeaderSize + qint64(m_nplayers) * MappedEntrySize > m_mapSize)
+    {
+        closeMapped();
+        return false;
+    }
+    m_mapped = true;
+    m_mapping.clear();
+    m_npending_adds = 0;
+    return true;
+}
+
+void PlayerDatabase::closeMapped()
+{
+    if(m_mapData)
+    {
+        m_mapfile.unmap(m_mapData);
+    }
+    if(m_data)
+    {
+        m_datafile.unmap(m_data);
+    }
+    m_mapData = nullptr;
+    m_mapSize = 0;
+    m_data = nullptr;
+    m_dataSize = 0;
+    m_mapped = false;
+    m_mapfile.close();
+    m_datafile.close();
+}
+
+bool PlayerDatabase::saveMapped(const QString& fname)
+{
+    QFile mapfile(fname + Mapfile_suffix);
+    QFile datafile(fname + Datafile_suffix);
+    if(mapfile.exists() || datafile.exists())
+    {
+        return false;
+    }
+    if(!mapfile.open(QIODevice::WriteOnly) || !datafile.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+
+    QStringList names = playerNames();
+    names << m_pendingUpdates.keys();
+    if(m_dirty)
+    {
+        names << m_currentPlayerName;
+    }
+    names.sort();
+    names.removeDuplicates();
+
+    QDataStream datads(&datafile);
+    datads.setVersion(6);
+    datads << Magic;
+    datads << MappedVersion;
+
+    QVector<quint32> dataOffsets;
+    dataOffsets.reserve(names.count());
+    foreach(QString name, names)
+    {
+        PlayerData pd = m_pendingUpdates.contains(name) ? m_pendingUpdates.value(name) : readPlayerData(name);
+        if(m_dirty && name == m_currentPlayerName)
+        {
+            pd = m_currentPlayer;
+        }
+        dataOffsets.append((quint32)datafile.pos());
+        int first = pd.firstEloListIndex();
+        int last = pd.lastEloListIndex();
+        datads << (qint32)first;
+        datads << (qint32)last;
+        datads << (qint32)pd.estimatedElo();
+        datads << (qint32)pd.peakElo();
+        for(int i = first; first > 0 && i <= last; ++i)
+        {
+            datads << (qint16)pd.elo(i);
+        }
+        datads << pd.dateOfBirth().asString();
+        datads << pd.dateOfDeath().asString();
+        datads << pd.country();
+        datads << pd.title();
+        datads << pd.photo();
+        datads << pd.biography();
+    }
+
+    QList<QByteArray> utf8Names;
+    QVector<QPair<quint32, int> > entries;
+    QVector<quint32> nameOffsets;
+    quint32 nameOffset = MappedHeaderSize + names.count() * MappedEntrySize;
+    for(int i = 0; i < names.count(); ++i)
+    {
+        QByteArray utf8 = names[i].toUtf8().left(0xFFFF);
+        entries.append(qMakePair(nameHash(utf8), i));
+        nameOffsets.append(nameOffset);
+        nameOffset += 2 + utf8.size();
+        utf8Names.append(utf8);
+    }
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const QPair<quint32, int>& a, const QPair<quint32, int>& b) { return a.first < b.first; });
+
+    QDataStream mapds(&mapfile);
+    mapds.setVersion(6);
+    mapds << Magic;
+    mapds << MappedVersion;
+    mapds << (qint32)names.count();
+    foreach(auto entry, entries)
+    {
+        mapds << entry.first;
+        mapds << nameOffsets[entry.second];
+        mapds << dataOffsets[entry.second];
+    }
+    foreach(QByteArray utf8, utf8Names)
+    {
+        mapds << (quint16)utf8.size();
+        mapds.writeRawData(utf8.constData(), utf8.size());
+    }
+    return mapds.status() == QDataStream::Ok && datads.status() == QDataStream::Ok;
+}
+
+qint64 PlayerDatabase::findMapped(const QString& playername) const
+{
+    QByteArray name = playername.toUtf8();
+    quint32 hash = nameHash(name);
+    const uchar* entries = m_mapData + MappedHeaderSize;
+
+    qint32 lo = 0;
+    qint32 hi = m_nplayers;
+    while(lo < hi)
+    {
+        qint32 mid = lo + (hi - lo) / 2;
+        if(qFromBigEndian<quint32>(entries + mid * MappedEntrySize) < hash)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    for(; lo < m_nplayers; ++lo)
+    {
+        const uchar* entry = entries + lo * MappedEntrySize;
+        if(qFromBigEndian<quint32>(entry) != hash)
+        {
+            break;
+        }
+        quint32 nameOffset = qFromBigEndian<quint32>(entry + 4);
+        if(nameOffset + 2 > m_mapSize)
+        {
+            break;
+        }
+        quint16 length = qFromBigEndian<quint16>(m_mapData + nameOffset);
+        if(length == name.size() && nameOffset + 2 + length <= m_mapSize
+                && memcmp(m_mapData + nameOffset + 2, name.constData(), length) == 0)
+        {
+            return qFromBigEndian<quint32>(entry + 8);
+        }
+    }
+    return -1;
+}
+
+template<class F> void PlayerDatabase::forEachMappedName(F f) const
+{
+    qint64 pos = MappedHeaderSize + qint64(m_nplayers) * MappedEntrySize;
+    for(qint32 i = 0; i < m_nplayers && pos + 2 <= m_mapSize; ++i)
+    {
+        quint16 length = qFromBigEndian<quint16>(m_mapData + pos);
+        if(pos + 2 + length > m_mapSize
+                || !f(QString::fromUtf8(reinterpret_cast<const char*>(m_mapData + pos + 2), length)))
+        {
+            return;
+        }
+        pos += 2 + length;
+    }
+}
+
+PlayerData PlayerDatabase::readMappedPlayerData(qint64 pos) const
+{
+    PlayerData pd;
+    if(pos + MappedRecordEloOffset > m_dataSize)
+    {
+        return pd;
+    }
+    QByteArray record = QByteArray::fromRawData(reinterpret_cast<const char*>(m_data + pos), int(m_dataSize - pos));
+    QDataStream ds(record);
+    ds.setVersion(6);
+
+    qint32 firstEloListIndex;
+    qint32 lastEloListIndex;
+    qint32 estimatedElo;
+    qint32 peakElo;
+    ds >> firstEloListIndex;
+    ds >> lastEloListIndex;
+    ds >> estimatedElo;
+    ds >> peakElo;
+    for(int i = firstEloListIndex; firstEloListIndex > 0 && i <= lastEloListIndex; ++i)
+    {
+        qint16 elo;
+        ds >> elo;
+        if(elo)
+        {
+            pd.setElo(i, elo);
+        }
+    }
+
+    QString birthDate;
+    QString deathDate;
+    QString country;
+    QString title;
+    QImage photo;
+    QString biography;
+    ds >> birthDate;
+    ds >> deathDate;
+    ds >> country;
+    ds >> title;
+    ds >> photo;
+    ds >> biography;
+
+    if(birthDate.contains('.'))
+    {
+        pd.setDateOfBirth(PartialDate(birthDate));
+    }
+    if(deathDate.contains('.'))
+    {
+        pd.setDateOfDeath(PartialDate(deathDate));
+    }
+    pd.setCountry(country);
+    pd.setTitle(title);
+    pd.setFirstEloListIndex((int)firstEloListIndex);
+    pd.setLastEloListIndex((int)lastEloListIndex);
+    pd.setEstimatedElo((int)estimatedElo);
+    pd.setPeakElo((int)peakElo);
+    pd.setPhoto(photo);
+    pd.setBiography(biography);
+    return pd;
+}
+
+int PlayerDatabase::estimatedMappedElo(qint64 pos, int eloListIndex) const
+{
+    if(pos + MappedRecordEloOffset > m_dataSize)
+    {
+        return 0;
+    }
+    const uchar* record = m_data + pos;
+    qint32 first = qFromBigEndian<qint32>(record);
+    qint32 last = qFromBigEndian<qint32>(record + 4);
+    const uchar* elos = record + MappedRecordEloOffset;
+    if(first > 0 && pos + MappedRecordEloOffset + 2 * qint64(last - first + 1) <= m_dataSize)
+    {
+        // the rating of the list or the closest previous one
+        for(int i = qMin(eloListIndex, (int)last); i >= first; --i)
+        {
+            qint16 elo = qFromBigEndian<qint16>(elos + 2 * (i - first));
+            if(elo)
+            {
+                return elo;
+            }
+        }
+    }
+    return qFromBigEndian<qint32>(record + 8);
+}
+
 bool PlayerDatabase::removeDatabase(const QString& fname)
 {
     m_mapfile.setFileName(fname + Mapfile_suffix);
@@ -165,6 +491,12 @@ bool PlayerDatabase::removeDatabase(const QString& fname)
 
 void PlayerDatabase::close()
 {
+    if(m_mapped)
+    {
+        rollback();
+        closeMapped();
+        return;
+    }
     commit();
     m_mapds.setDevice(nullptr);
     m_mapfile.flush();
@@ -183,6 +515,11 @@ void PlayerDatabase::rollback()
 
 void PlayerDatabase::commit()
 {
+    if(m_mapped) // read-only
+    {
+        rollback();
+        return;
+    }
 
     if(m_dirty) //current player was changed
     {
@@ -225,6 +562,15 @@ void PlayerDatabase::commit()
 PlayerData PlayerDatabase::readPlayerData(const QString& playername)
 {
     PlayerData pd;
+    if(m_mapped)
+    {
+        if(m_pendingUpdates.contains(playername))
+        {
+            return m_pendingUpdates.value(playername);
+        }
+        qint64 pos = findMapped(playername);
+        return (pos < 0) ? pd : readMappedPlayerData(pos);
+    }
     QMap<QString, qint32>::Iterator it;
     it = m_mapping.find(playername);
     if(it == m_mapping.end())
@@ -302,7 +648,7 @@ unsigned int PlayerDatabase::count() const
 
 bool PlayerDatabase::add(const QString& playername)
 {
-    if(m_mapping.contains(playername) || m_pendingUpdates.contains(playername))
+    if(m_mapped || m_mapping.contains(playername) || m_pendingUpdates.contains(playername))
     {
         return false;
     }
@@ -339,6 +685,10 @@ void PlayerDatabase::setCurrent(const QString& playername)
 
 bool PlayerDatabase::exists(const QString& playername) const
 {
+    if(m_mapped)
+    {
+        return findMapped(playername) >= 0;
+    }
     if(m_mapping.contains(playername))
     {
         return true;
@@ -430,6 +780,20 @@ int PlayerDatabase::estimatedEloNoCache(const PartialDate& date) const
     return m_currentPlayer.estimatedEloNoCache(eloList(date));
 }
 
+int PlayerDatabase::estimatedElo(const QString& playername, const PartialDate& date)
+{
+    if(playername == m_currentPlayerName)
+    {
+        return m_currentPlayer.estimatedEloNoCache(eloList(date));
+    }
+    if(m_mapped && !m_pendingUpdates.contains(playername))
+    {
+        qint64 pos = findMapped(playername);
+        return (pos < 0) ? 0 : estimatedMappedElo(pos, eloList(date));
+    }
+    return readPlayerData(playername).estimatedEloNoCache(eloList(date));
+}
+
 int PlayerDatabase::estimatedElo() const
 {
     return m_currentPlayer.estimatedElo();
@@ -504,6 +868,15 @@ void PlayerDatabase::appendToBiography(const QString& s)
 QStringList PlayerDatabase::playerNames()
 {
     QStringList result;
+    if(m_mapped)
+    {
+        forEachMappedName([&](const QString& name)
+        {
+            result.push_back(name);
+            return true;
+        });
+        return result;
+    }
     QMap<QString, qint32>::Iterator it;
     for(it = m_mapping.begin(); it != m_mapping.end(); ++it)
     {
@@ -515,6 +888,22 @@ QStringList PlayerDatabase::playerNames()
 QStringList PlayerDatabase::findPlayers(const QString& prefix, const int maxCount, const Qt::CaseSensitivity cs)
 {
     QStringList result;
+    if(m_mapped)
+    {
+        forEachMappedName([&](const QString& name)
+        {
+            if(name.startsWith(prefix, cs))
+            {
+                if(result.count() >= maxCount)
+                {
+                    return false;
+                }
+                result.push_back(name);
+            }
+            return true;
+        });
+        return result;
+    }
     QMap<QString, qint32>::Iterator it;
     int i = 0;
     for(it = m_mapping.begin(); it != m_mapping.end(); ++it)
@@ -26,6 +26,7 @@ class PlayerDatabase
 {
 
 public:
+    PlayerDatabase();
     /**
     create a new player database
     */
@@ -35,6 +36,12 @@ public:
     */
     bool open(const QString& fname);
     /**
+    write all players into a new database in the mapped format.
+    A mapped database is read through memory maps of its files, has a
+    hashed name index and fixed width elo histories. It is read-only.
+    */
+    bool saveMapped(const QString& fname);
+    /**
     remove a player database
     */
     bool removeDatabase(const QString& fname);
@@ -156,6 +163,12 @@ public:
     */
     int estimatedEloNoCache(const PartialDate& date) const;
     /**
+    Like estimatedEloNoCache(const PartialDate&), for the given player.
+    The current player is not changed, so this is suitable for estimating
+    the elos of many players. Returns 0 if the player is unknown.
+    */
+    int estimatedElo(const QString& playername, const PartialDate& date);
+    /**
     highest overall elo achieved by current player
     */
     int highestElo() const;
@@ -231,7 +244,21 @@ private:
     QString m_currentPlayerName;
     PlayerData m_currentPlayer;
     bool m_dirty;
+    // mapped format
+    bool m_mapped;
+    uchar* m_mapData; // whole map file
+    qint64 m_mapSize;
+    uchar* m_data; // whole data file
+    qint64 m_dataSize;
     PlayerData readPlayerData(const QString & playername);
+    bool openMapped();
+    void closeMapped();
+    /** @return the data file position of a player in a mapped database, -1 if not found */
+    qint64 findMapped(const QString& playername) const;
+    /** Calls @p f for each name of a mapped database in sorted order until it returns false */
+    template<class F> void forEachMappedName(F f) const;
+    PlayerData readMappedPlayerData(qint64 pos) const;
+    int estimatedMappedElo(qint64 pos, int eloListIndex) const;
     int eloList(const PartialDate date) const;
     int eloList(const int year, const int index) const;
 
@@ -95,46 +95,43 @@ void PlayerInfo::update()
     // Clean previous statistics
     reset();
 
-    for(int i = 0; i < (int)m_database->count(); ++i)
+    // Only the player's own games, a game against oneself counts for White
+    QVector<GameId> games[2] = { index->gamesWithValue(TagNameWhite, player), index->gamesWithValue(TagNameBlack, player) };
+    for(int k = 0; k < 2; ++k)
     {
-        Color c;
-        if(index->valueIndexFromTag(TagNameWhite, i) == player)
+        Color c = k ? Black : White;
+        foreach(GameId i, games[k])
         {
-            c = White;
-        }
-        else if(index->valueIndexFromTag(TagNameBlack, i) == player)
-        {
-            c = Black;
-        }
-        else
-        {
-            continue;
-        }
-        int res = toResult(index->tagValue(TagNameResult, i));
-        m_result[c][res]++;
-        m_count[c]++;
-        int elo = index->tagValue(c == White ? TagNameWhiteElo : TagNameBlackElo, i).toInt();
-        if(elo)
-        {
-            m_rating[0] = qMin(elo, m_rating[0]);
-            m_rating[1] = qMax(elo, m_rating[1]);
-        }
-        PartialDate date(index->tagValue(TagNameDate, i));
-        if(date.year() > 1000)
-        {
-            m_date[0] = qMin(date, m_date[0]);
-            m_date[1] = qMax(date, m_date[1]);
-        }
-        QString eco = index->tagValue(TagNameECO, i).left(3);
-        if(eco.length() == 3)
-        {
-            openings[c][eco].count++;
-            openings[c][eco].result[res]++;
-        }
-        QString ecoX = index->tagValue(TagNameECO, i).left(4);
-        if(ecoX.length() >= 3)
-        {
-            openingsX[c][ecoX]++;
+            if(c == Black && index->valueIndexFromTag(TagNameWhite, i) == player)
+            {
+                continue;
+            }
+            int res = toResult(index->tagValue(TagNameResult, i));
+            m_result[c][res]++;
+            m_count[c]++;
+            int elo = index->tagValue(c == White ? TagNameWhiteElo : TagNameBlackElo, i).toInt();
+            if(elo)
+            {
+                m_rating[0] = qMin(elo, m_rating[0]);
+                m_rating[1] = qMax(elo, m_rating[1]);
+            }
+            PartialDate date(index->tagValue(TagNameDate, i));
+            if(date.year() > 1000)
+            {
+                m_date[0] = qMin(date, m_date[0]);
+                m_date[1] = qMax(date, m_date[1]);
+            }
+            QString eco = index->tagValue(TagNameECO, i).left(3);
+            if(eco.length() == 3)
+            {
+                openings[c][eco].count++;
+                openings[c][eco].result[res]++;
+            }
+            QString ecoX = index->tagValue(TagNameECO, i).left(4);
+            if(ecoX.length() >= 3)
+            {
+                openingsX[c][ecoX]++;
+            }
         }
     }
 
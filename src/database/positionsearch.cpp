@@ -30,6 +30,10 @@ void PositionSearch::setPosition(const BoardX& position)
 
 int PositionSearch::matches(GameId index) const
 {
+    if(!m_database->index()->canContainPosition(index, m_position))
+    {
+        return 0;
+    }
     return (1+m_database->findPosition(index, m_position)); // so NO_MOVE results in 0
 }
 
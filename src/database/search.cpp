@@ -24,6 +24,7 @@
 Search::Search(Database *db) : m_database(db)
 {
     m_searchOperator = FilterOperator::NullOperator;
+    m_inputOperator = FilterOperator::NullOperator;
 }
 
 Search::~Search()
@@ -58,6 +59,29 @@ void Search::setInputFilter(FilterX *value)
     inputFilter = value;
 }
 
+void Search::setInputOperator(FilterOperator op)
+{
+    m_inputOperator = op;
+}
+
+bool Search::isRequested(GameId index) const
+{
+    if (!inputFilter)
+    {
+        return true;
+    }
+    switch (m_inputOperator)
+    {
+    case FilterOperator::And:
+    case FilterOperator::Remove:
+        return inputFilter->contains(index);
+    case FilterOperator::Or:
+        return !inputFilter->contains(index);
+    default:
+        return true;
+    }
+}
+
 FilterX *Search::getOutputFilter() const
 {
     return outputFilter;
@@ -34,7 +34,7 @@ class Search : public QObject
     Q_OBJECT
 
 public:
-    enum Type { NullSearch, PositionSearch, EloSearch, DateSearch, TagSearch, FilterSearch, NumberSearch, DuplicateSearch, ListSearch};
+    enum Type { NullSearch, PositionSearch, EloSearch, DateSearch, TagSearch, FilterSearch, NumberSearch, DuplicateSearch, ListSearch, MaterialSearch, CommentSearch};
 
     /** Standard constructor. */
     explicit Search(Database* db = nullptr);
@@ -50,6 +50,10 @@ public:
 
     FilterX *getInputFilter() const;
     void setInputFilter(FilterX *value);
+    /** Set the operator combining the results with the input filter */
+    void setInputOperator(FilterOperator op);
+    /** @return false if the result for game @p index is not used by the input filter */
+    bool isRequested(GameId index) const;
 
     FilterX *getOutputFilter() const;
     void setOutputFilter(FilterX *value);
@@ -62,6 +66,7 @@ protected:
     QPointer<FilterX> inputFilter;
     QPointer<FilterX> outputFilter;
     FilterOperator m_searchOperator;
+    FilterOperator m_inputOperator;
 };
 
 /** @ingroup Search
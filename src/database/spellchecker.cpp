@@ -13,14 +13,35 @@
 #include <QFile>
 #include <QRegularExpression>
 
+#include "gamex.h"
+#include "index.h"
 #include "spellchecker.h"
+#include "tags.h"
 
 #if defined(_MSC_VER) && defined(_DEBUG)
 #define DEBUG_NEW new( _NORMAL_BLOCK, __FILE__, __LINE__ )
 #define new DEBUG_NEW
 #endif // _MSC_VER
 
-Spellchecker::Spellchecker()
+namespace {
+
+/** The tags corrected in whole databases and the spelling type of their values */
+const struct
+{
+    const char* tag;
+    Spellchecker::SpellingType type;
+} CorrectedTags[] =
+{
+    { TagNameWhite, Spellchecker::Player },
+    { TagNameBlack, Spellchecker::Player },
+    { TagNameEvent, Spellchecker::Event },
+    { TagNameSite, Spellchecker::Site },
+    { TagNameRound, Spellchecker::Round }
+};
+
+} // namespace
+
+Spellchecker::Spellchecker() : m_compiled(false)
 {}
 
 bool Spellchecker::load(const QString& filename)
@@ -150,39 +171,32 @@ bool Spellchecker::import(const QString& filename)
 QString Spellchecker::correct(const QString& string,
                               SpellingType spellingType) const
 {
+    compile();
     QString corrected = string;
 
-    //apply substitution rules first
-    QMap<QString, QString>::const_iterator iterator;
-
-    //prefixes
-    for(iterator = m_maps[Prefix][spellingType].constBegin();
-            iterator != m_maps[Prefix][spellingType].constEnd(); iterator++)
+    //apply substitution rules first, the first matching prefix and suffix in
+    //map order, and every infix in map order
+    const Automaton& prefixes = m_automata[Prefix][spellingType];
+    int rule = prefixes.findAffix(corrected, false);
+    if(rule != -1)
     {
-        if(corrected.startsWith(iterator.key()))
-        {
-            corrected.replace(0, iterator.key().length(), iterator.value());
-            break;
-        }
+        corrected.replace(0, prefixes.keys[rule].length(), prefixes.values[rule]);
     }
 
-    //infixes
-    for(iterator = m_maps[Infix][spellingType].constBegin();
-            iterator != m_maps[Infix][spellingType].constEnd(); iterator++)
+    const Automaton& infixes = m_automata[Infix][spellingType];
+    rule = infixes.findInfix(corrected, 0);
+    while(rule != -1)
     {
-        corrected.replace(iterator.key(), iterator.value());
+        corrected.replace(infixes.keys[rule], infixes.values[rule]);
+        rule = infixes.findInfix(corrected, rule + 1);
     }
 
-    //suffixes
-    for(iterator = m_maps[Suffix][spellingType].constBegin();
-            iterator != m_maps[Suffix][spellingType].constEnd(); iterator++)
+    const Automaton& suffixes = m_automata[Suffix][spellingType];
+    rule = suffixes.findAffix(corrected, true);
+    if(rule != -1)
     {
-        if(corrected.endsWith(iterator.key()))
-        {
-            corrected.replace(corrected.lastIndexOf(iterator.key()),
-                              iterator.key().length(), iterator.value());
-            break;
-        }
+        corrected.replace(corrected.lastIndexOf(suffixes.keys[rule]),
+                          suffixes.keys[rule].length(), suffixes.values[rule]);
     }
 
     //look for literal match
@@ -243,6 +257,7 @@ void Spellchecker::addRule(const QString incorrect, const QString& correct,
         standardised = standardise(standardised, spellingType);
     }
     m_maps[ruleType][spellingType].insert(standardised, correct);
+    m_compiled = false;
 }
 
 bool Spellchecker::removeRule(const QString& incorrect, RuleType ruleType,
@@ -252,6 +267,7 @@ bool Spellchecker::removeRule(const QString& incorrect, RuleType ruleType,
 
     bool removed = m_maps[ruleType][spellingType].contains(standardised);
     m_maps[ruleType][spellingType].remove(standardised);
+    m_compiled = false;
     return removed;
 }
 
@@ -279,6 +295,172 @@ void Spellchecker::clear()
             m_maps[ruleType][spellingType].clear();
         }
     }
+    m_compiled = false;
+}
+
+int Spellchecker::correct(IndexX& index) const
+{
+    int corrected = 0;
+    for(const auto& column : CorrectedTags)
+    {
+        QHash<QString, QString> corrections;
+        foreach(QString value, index.tagValues(column.tag))
+        {
+            QString correctValue = correct(value, column.type);
+            if(!correctValue.isEmpty() && correctValue != value)
+            {
+                corrections.insert(value, correctValue);
+            }
+        }
+        corrected += corrections.count();
+        index.replaceTagValues(column.tag, corrections);
+    }
+    return corrected;
+}
+
+int Spellchecker::correct(GameX& game) const
+{
+    int corrected = 0;
+    for(const auto& column : CorrectedTags)
+    {
+        QString value = game.tag(column.tag);
+        QString correctValue = correct(value, column.type);
+        if(!correctValue.isEmpty() && correctValue != value)
+        {
+            game.setTag(column.tag, correctValue);
+            ++corrected;
+        }
+    }
+    return corrected;
+}
+
+void Spellchecker::compile() const
+{
+    if(m_compiled)
+    {
+        return;
+    }
+    for(int spellingType = 0; spellingType < SpellingTypeCount; spellingType++)
+    {
+        m_automata[Prefix][spellingType].build(m_maps[Prefix][spellingType], false);
+        m_automata[Infix][spellingType].build(m_maps[Infix][spellingType], false);
+        m_automata[Suffix][spellingType].build(m_maps[Suffix][spellingType], true);
+    }
+    m_compiled = true;
+}
+
+void Spellchecker::Automaton::build(const QMap<QString, QString>& map, bool reversed)
+{
+    nodes.clear();
+    keys = map.keys();
+    values = map.values();
+
+    Node root;
+    root.fail = 0;
+    root.key = -1;
+    root.output = -1;
+    nodes.append(root);
+
+    // keys are added in map order, so a node keeps the lowest index of equal keys
+    for(int i = 0; i < keys.count(); ++i)
+    {
+        const QString& key = keys[i];
+        int node = 0;
+        for(int j = 0; j < key.length(); ++j)
+        {
+            QChar c = reversed ? key[key.length() - 1 - j] : key[j];
+            int child = nodes[node].next.value(c, 0);
+            if(!child)
+            {
+                Node n;
+                n.fail = 0;
+                n.key = -1;
+                n.output = -1;
+                child = nodes.count();
+                nodes.append(n);
+                nodes[node].next.insert(c, child);
+            }
+            node = child;
+        }
+        if(nodes[node].key == -1)
+        {
+            nodes[node].key = i;
+        }
+    }
+
+    // breadth first, so the fail node of a node is always complete before the node
+    QVector<int> queue;
+    queue.append(0);
+    for(int head = 0; head < queue.count(); ++head)
+    {
+        int node = queue[head];
+        for(auto it = nodes[node].next.cbegin(); it != nodes[node].next.cend(); ++it)
+        {
+            int child = it.value();
+            int fail = 0;
+            if(node)
+            {
+                fail = nodes[node].fail;
+                while(fail && !nodes[fail].next.contains(it.key()))
+                {
+                    fail = nodes[fail].fail;
+                }
+                fail = nodes[fail].next.value(it.key(), 0);
+            }
+            nodes[child].fail = fail;
+            nodes[child].output = (nodes[fail].key != -1) ? fail : nodes[fail].output;
+            queue.append(child);
+        }
+    }
+}
+
+int Spellchecker::Automaton::findAffix(const QString& string, bool reversed) const
+{
+    int found = nodes.isEmpty() ? -1 : nodes[0].key;
+    int node = 0;
+    for(int j = 0; j < string.length() && !nodes.isEmpty(); ++j)
+    {
+        QChar c = reversed ? string[string.length() - 1 - j] : string[j];
+        node = nodes[node].next.value(c, 0);
+        if(!node)
+        {
+            break;
+        }
+        int key = nodes[node].key;
+        if(key != -1 && (found == -1 || key < found))
+        {
+            found = key;
+        }
+    }
+    return found;
+}
+
+int Spellchecker::Automaton::findInfix(const QString& string, int from) const
+{
+    if(nodes.isEmpty())
+    {
+        return -1;
+    }
+    int found = (nodes[0].key >= from) ? nodes[0].key : -1;
+    int node = 0;
+    for(int j = 0; j < string.length(); ++j)
+    {
+        QChar c = string[j];
+        while(node && !nodes[node].next.contains(c))
+        {
+            node = nodes[node].fail;
+        }
+        node = nodes[node].next.value(c, 0);
+        for(int match = node; match > 0; match = nodes[match].output)
+        {
+            int key = nodes[match].key;
+            if(key >= from && (found == -1 || key < found))
+            {
+                found = key;
+            }
+        }
+    }
+    return found;
 }
 
 bool Spellchecker::importSection(QTextStream& stream, const QString& section,
@@ -402,7 +584,8 @@ QString Spellchecker::standardise(const QString& string,
 {
     //remove exterraneous characters
     QString standardised = string;
-    standardised.remove(QRegularExpression("[.,\\s-_()]"));
+    static const QRegularExpression extraneous("[.,\\s-_()]");
+    standardised.remove(extraneous);
 
     if(spellingType == Player)
     {
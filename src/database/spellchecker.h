@@ -8,10 +8,15 @@
  *   (at your option) any later version.                                   *
  ***************************************************************************/
 
+#include <QHash>
 #include <QMap>
 #include <QString>
 #include <QStringList>
 #include <QTextStream>
+#include <QVector>
+
+class GameX;
+class IndexX;
 
 /** @ingroup Feature
 	 The Spellchecker class provides spellchecker functionality.
@@ -96,7 +101,46 @@ public:
     /** Removes all spelling rules from the Spellchecker */
     void clear();
 
+    /**
+         Corrects the player, event, site and round names of a whole index
+
+         Each distinct value is corrected once, the games are then updated by
+         replacing value ids. Returns the number of values corrected.
+    */
+    int correct(IndexX& index) const;
+
+    /** Corrects the same tags as correct(IndexX&) in @p game. Returns the number of tags corrected. */
+    int correct(GameX& game) const;
+
 private:
+    /** Keyword trie over the keys of one rule map, with Aho-Corasick links for infixes */
+    struct Automaton
+    {
+        struct Node
+        {
+            QHash<QChar, int> next;
+            /** Node of the longest proper suffix of this node's path */
+            int fail;
+            /** Index of the key ending at this node, -1 if none */
+            int key;
+            /** Nearest node on the fail chain where a key ends, -1 if none */
+            int output;
+        };
+        QVector<Node> nodes;
+        /** Keys and values in map order, so a lower index means a key applied earlier */
+        QStringList keys;
+        QStringList values;
+
+        void build(const QMap<QString, QString>& map, bool reversed);
+        /** @return lowest index of a key matching a prefix (or suffix if reversed) of @p string, -1 if none */
+        int findAffix(const QString& string, bool reversed) const;
+        /** @return lowest index >= @p from of a key found anywhere in @p string, -1 if none */
+        int findInfix(const QString& string, int from) const;
+    };
+
+    /** Build the automata, if any rule changed since the last call */
+    void compile() const;
+
     /** Imports a section from a specially formatted text file */
     bool importSection(QTextStream& stream, const QString& section,
                        SpellingType spellingType);
@@ -105,4 +149,6 @@ private:
     QString standardise(const QString& string, SpellingType spellingType) const;
 
     QMap<QString, QString> m_maps[RuleTypeCount][SpellingTypeCount];
+    mutable Automaton m_automata[RuleTypeCount][SpellingTypeCount];
+    mutable bool m_compiled;
 };
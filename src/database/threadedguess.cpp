@@ -61,10 +61,10 @@ void ThreadedGuess::run()
         b.clearEnPassantSquare();
     }
     Guess::MoveList moveList;
-    Guess::Result sm = Guess::guessMove(qPrintable(b.toFen()),
-                                        b.chess960(), b.castlingRooks(),
-                                        Guess::NULL_SQUARE,
-                                        moveList, thinkTime);
+    Guess::Result sm = m_guesser.guessMove(qPrintable(b.toFen()),
+                                           b.chess960(), b.castlingRooks(),
+                                           Guess::NULL_SQUARE,
+                                           moveList, thinkTime);
     if (!m_dontGuess)
     {
         if (Guess::guessAllowed() && !sm.error)
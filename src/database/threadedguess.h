@@ -47,6 +47,8 @@ private:
     chessx::Square from;
     chessx::Square to;
     BoardX m_board;
+    /** Used by run() only, keeps its hash tables from one guess to the next */
+    Guess::Guesser m_guesser;
 };
 
 #endif // THREADEDGUESS_H
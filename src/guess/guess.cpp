@@ -1,3 +1,5 @@
+#include <QScopedPointer>
+
 #include "guess.h"
 #include "guess_position.h"
 #include "guess_guessengine.h"
@@ -32,7 +34,8 @@ int attackersOnSquare(const char *fen, int target)
     return whiteDefenders-blackDefenders;
 }
 
-Result guessMove(const char* fen, bool chess960, quint64 castlingRooks, squareT square, MoveList& mlist, int thinkTime)
+// Guess with engine, or with a temporary engine if it is null
+static Result guessMove(Engine* engine, const char* fen, bool chess960, quint64 castlingRooks, squareT square, MoveList& mlist, int thinkTime)
 {
     Result r;
 
@@ -57,10 +60,15 @@ Result guessMove(const char* fen, bool chess960, quint64 castlingRooks, squareT
             mlist.clear();
             return r;
         }
-        Engine engine;
-        engine.SetSearchTime(thinkTime);
-        engine.SetPosition(&pos);
-        r.score = engine.Think(&mlist);
+        QScopedPointer<Engine> temporaryEngine;
+        if (!engine)
+        {
+            temporaryEngine.reset(new Engine);
+            engine = temporaryEngine.data();
+        }
+        engine->SetSearchTime(thinkTime);
+        engine->SetPosition(&pos);
+        r.score = engine->Think(&mlist);
     }
 
     const simpleMoveT& sm = mlist.at(0);
@@ -72,6 +80,11 @@ Result guessMove(const char* fen, bool chess960, quint64 castlingRooks, squareT
     return r;
 }
 
+Result guessMove(const char* fen, bool chess960, quint64 castlingRooks, squareT square, MoveList& mlist, int thinkTime)
+{
+    return guessMove(nullptr, fen, chess960, castlingRooks, square, mlist, thinkTime);
+}
+
 Result evalPos(const char* fen, bool chess960, quint64 castlingRooks, int thinkTime)
 {
     Result r;
@@ -146,5 +159,18 @@ bool guessAllowed()
     return s_guessAllowed;
 }
 
+Guesser::Guesser() : m_engine(new Engine)
+{
+}
+
+Guesser::~Guesser()
+{
+    delete m_engine;
 }
 
+Result Guesser::guessMove(const char* fen, bool chess960, quint64 castlingRooks, squareT square, MoveList& mlist, int thinkTime)
+{
+    return Guess::guessMove(m_engine, fen, chess960, castlingRooks, square, mlist, thinkTime);
+}
+
+}
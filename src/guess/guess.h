@@ -5,6 +5,8 @@
 
 namespace Guess
 {
+class Engine;
+
 typedef struct Result
 {
     int error;
@@ -27,6 +29,23 @@ Result evalPos(const char* fen, bool chess960, quint64 castlingRooks, int thinkT
 int pickBest(const char* fen, bool chess960, quint64 castlingRooks, squareT from1, squareT to1, squareT from2, squareT to2, int ms);
 void setGuessAllowed(bool allow);
 bool guessAllowed();
+
+// A guess engine which keeps its hash tables from one call to the next,
+//  so that guesses for related positions profit from earlier searches.
+//  An instance must only be used by one thread at a time.
+class Guesser
+{
+public:
+    Guesser();
+    ~Guesser();
+
+    Result guessMove(const char* fen, bool chess960, quint64 castlingRooks, squareT square, MoveList& mlist, int thinkTime = 50);
+
+private:
+    Q_DISABLE_COPY(Guesser)
+
+    Engine* m_engine;
+};
 }
 
 #endif
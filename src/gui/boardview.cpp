@@ -65,6 +65,9 @@ BoardView::BoardView(QWidget* parent, int flags) : QWidget(parent),
 
     connect(&m_threatGuess, SIGNAL(guessFoundForBoard(Guess::Result,BoardX)),
             this, SLOT(showThreat(Guess::Result,BoardX)),Qt::QueuedConnection);
+    m_guessService = GuessService::acquire();
+    connect(m_guessService, SIGNAL(guessFound(int)),
+            this, SLOT(showGuessFound(int)), Qt::QueuedConnection);
 
     setAcceptDrops(true);
 }
@@ -73,6 +76,7 @@ BoardView::~BoardView()
 {
     removeEventFilter(this);
     m_threatGuess.cancel();
+    GuessService::release();
     delete lastMoveEvent;
 }
 
@@ -116,6 +120,11 @@ void BoardView::setBoard(const BoardX& value, Square from, Square to, bool atLin
     m_alertSquare = value.kingInCheck();
     m_targets.clear();
     m_bestGuess.setNullMove();
+    if((m_guessMove || m_showTargets) && !(m_flags & SuppressGuessMove) && Guess::guessAllowed())
+    {
+        // Guess all squares in the background, hovering them is a lookup then
+        m_guessService->setBoard(value);
+    }
     if(underMouse())
     {
         updateGuess(m_hoverSquare);
@@ -551,10 +560,9 @@ bool BoardView::showGuess(Square s)
         removeGuess();
         m_hoverSquare = s;
 
-        if (s != InvalidSquare)
+        Guess::Result sm;
+        if (s != InvalidSquare && m_guessService->guess(m_board, s, sm, m_moveList))
         {
-            Guess::Result sm = Guess::guessMove(qPrintable(m_board.toFen()), m_board.chess960(), m_board.castlingRooks(),
-                                                static_cast<Guess::squareT>(s), m_moveList);
             if(!sm.error)
             {
                 if (m_guessMove)
@@ -584,6 +592,15 @@ bool BoardView::showGuess(Square s)
     return false;
 }
 
+void BoardView::showGuessFound(int square)
+{
+    // The service is shared, only the board under the mouse asked for the square
+    if (underMouse() && Square(square) == m_hoverSquare && m_hiFrom == InvalidSquare && m_targets.isEmpty())
+    {
+        updateGuess(m_hoverSquare);
+    }
+}
+
 void BoardView::updateGuess(Square s)
 {
     // Invalidate any currently displayed guess to allow new guess to show
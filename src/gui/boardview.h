@@ -20,6 +20,7 @@
 #include "board.h"
 #include "boardtheme.h"
 #include "guess.h"
+#include "guessservice.h"
 #include "threadedguess.h"
 
 #include <QWidget>
@@ -174,6 +175,8 @@ protected: //Drag'n'Drop Support
     void checkCursor(Qt::KeyboardModifiers modifiers);
 protected slots:
     void showThreat(Guess::Result sm, BoardX b);
+    /** Show the guess for @p square if it is still hovered */
+    void showGuessFound(int square);
 private:
     /** Resizes pieces for new board size. */
     void resizeBoard(QSize size);
@@ -264,6 +267,7 @@ private:
     int m_showMoveIndicatorMode;
     QPointer<QObject> m_DbIndex;
     ThreadedGuess m_threatGuess;
+    GuessService* m_guessService;
     Move m_bestGuess;
     QList<Move> m_variations;
     Color m_showAttacks;
@@ -15,6 +15,7 @@
  ***************************************************************************/
 
 #include "database.h"
+#include "datesearch.h"
 #include "filter.h"
 #include "filtermodel.h"
 #include "gamelist.h"
@@ -423,9 +424,26 @@ void GameList::simpleSearch(int tagid)
         if ((list.size() > 1) && (dlg.tag() != 9)) // Tag 9 is the Result
         {
             // Filter a range
-            Search* ts = (dlg.tag() == 11) ? // Tag 11 is number of moves
-                    new TagSearch(m_model->filter()->database(), tag, list.at(0).toInt(), list.at(1).toInt()) :
-                    new TagSearch(m_model->filter()->database(), tag, list.at(0), list.at(1));
+            PartialDate minDate(list.at(0));
+            PartialDate maxDate(list.at(1));
+            Search* ts;
+            if (dlg.tag() == 11) // Tag 11 is number of moves
+            {
+                ts = new TagSearch(m_model->filter()->database(), tag, list.at(0).toInt(), list.at(1).toInt());
+            }
+            else if (tag == TagNameDate && minDate.isValid() && maxDate.isValid())
+            {
+                // Dates compare by their parts, not as text
+                if (maxDate < minDate)
+                {
+                    std::swap(minDate, maxDate);
+                }
+                ts = new DateSearch(m_model->filter()->database(), minDate, maxDate);
+            }
+            else
+            {
+                ts = new TagSearch(m_model->filter()->database(), tag, list.at(0), list.at(1));
+            }
             if(dlg.mode())
             {
                 m_model->executeSearch(ts, FilterOperator(dlg.mode()));
@@ -2,7 +2,9 @@
 *   Copyright (C) 2019 by Jens Nissen jens-chessx@gmx.net                   *
 ****************************************************************************/
 
+#include "database.h"
 #include "filter.h"
+#include "filtermodel.h"
 #include "gamelistsortmodel.h"
 
 #if defined(_MSC_VER) && defined(_DEBUG)
@@ -19,7 +21,58 @@ bool GameListSortModel::filterAcceptsRow(int source_row, const QModelIndex & /*s
     return false;
 }
 
+bool GameListSortModel::lessThan(const QModelIndex &source_left, const QModelIndex &source_right) const
+{
+    int column = source_left.column();
+    if (column == 0)
+    {
+        return source_left.row() < source_right.row();
+    }
+
+    FilterModel* model = qobject_cast<FilterModel*>(sourceModel());
+    if (m_filter && model && column < model->columnCount())
+    {
+        if (m_rankColumn != column)
+        {
+            QString tag = model->GetColumnTags().at(column);
+            m_ranks = m_filter->database()->index()->sortRanks(tag, FilterModel::isNumericColumn(column));
+            m_rankColumn = column;
+        }
+        if (source_left.row() < m_ranks.count() && source_right.row() < m_ranks.count())
+        {
+            return m_ranks[source_left.row()] < m_ranks[source_right.row()];
+        }
+    }
+    return QSortFilterProxyModel::lessThan(source_left, source_right);
+}
+
 void GameListSortModel::setFilter(FilterX* filter)
 {
     m_filter = filter;
+    invalidateRanks();
+}
+
+void GameListSortModel::setSourceModel(QAbstractItemModel *sourceModel)
+{
+    foreach(QMetaObject::Connection connection, m_connections)
+    {
+        disconnect(connection);
+    }
+    m_connections.clear();
+    invalidateRanks();
+    if (sourceModel)
+    {
+        // Connect before the proxy does, so the ranks are dropped before it sorts again
+        auto invalidate = [this]() { invalidateRanks(); };
+        m_connections << connect(sourceModel, &QAbstractItemModel::dataChanged, this, invalidate);
+        m_connections << connect(sourceModel, &QAbstractItemModel::modelAboutToBeReset, this, invalidate);
+        m_connections << connect(sourceModel, &QAbstractItemModel::rowsInserted, this, invalidate);
+    }
+    QSortFilterProxyModel::setSourceModel(sourceModel);
+}
+
+void GameListSortModel::invalidateRanks()
+{
+    m_ranks.clear();
+    m_rankColumn = -1;
 }
@@ -6,6 +6,7 @@
 #define GAMELISTSORTMODEL_H
 
 #include <QSortFilterProxyModel>
+#include <QVector>
 
 class FilterX;
 
@@ -14,14 +15,24 @@ class GameListSortModel : public QSortFilterProxyModel
 public:
     explicit GameListSortModel(QObject *parent = nullptr) :
         QSortFilterProxyModel(parent),
-        m_filter(nullptr)
+        m_filter(nullptr),
+        m_rankColumn(-1)
     {}
     void setFilter(FilterX* filter);
+    void setSourceModel(QAbstractItemModel *sourceModel);
 protected:
     bool filterAcceptsRow(int source_row, const QModelIndex &source_parent) const;
+    /** Compare by the sort ranks of the index instead of the tag texts */
+    bool lessThan(const QModelIndex &source_left, const QModelIndex &source_right) const;
 
 private:
+    void invalidateRanks();
+
     FilterX* m_filter;
+    /** Sort rank of each game in the column m_rankColumn, -1 if not yet fetched */
+    mutable QVector<quint32> m_ranks;
+    mutable int m_rankColumn;
+    QList<QMetaObject::Connection> m_connections;
 };
 
 #endif // GAMELISTSORTMODEL_H
@@ -56,7 +56,12 @@ QString GameNotationWidget::generateText(const GameX &game, bool trainingMode)
 void GameNotationWidget::reload(const GameX& game, bool trainingMode)
 {
     auto text = m_output->output(&game, trainingMode);
-    m_browser->setText(text);
+    // Navigation does not change the notation, so keep the document and its layout
+    if (text != m_text)
+    {
+        m_text = text;
+        m_browser->setText(text);
+    }
     m_browser->showMove(game.currentMove());
 }
 
@@ -89,6 +94,7 @@ void GameNotationWidget::slotReconfigure()
 
     delete m_output;
     m_output = new Output(Output::NotationWidget, &BoardView::renderImageForBoard);
+    m_text.clear();
 }
 
 void GameNotationWidget::showMove(int id)
@@ -49,6 +49,8 @@ private:
 
     ChessBrowser *m_browser;
     Output* m_output;
+    /** Notation currently shown in m_browser */
+    QString m_text;
 };
 
 #endif
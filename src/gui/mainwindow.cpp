@@ -11,6 +11,7 @@
 #include "analysiswidget.h"
 #include "annotation.h"
 #include "annotationwidget.h"
+#include "archivedatabase.h"
 #include "boardview.h"
 #include "boardviewex.h"
 #include "chessxsettings.h"
@@ -79,6 +80,7 @@
 #endif
 #include <QTimer>
 #include <QToolBar>
+#include <QToolButton>
 #include "qt6compat.h"
 
 template< typename T, std::size_t N >
@@ -489,6 +491,10 @@ MainWindow::MainWindow() : QMainWindow(),
     statusBar()->setFixedHeight(statusBar()->height());
     statusBar()->setSizeGripEnabled(true);
     m_progressBar = new QProgressBar();
+    m_cancelTransforms = new QToolButton();
+    m_cancelTransforms->setText(tr("Cancel"));
+    m_cancelTransforms->setToolTip(tr("Stop transforming the games of the database"));
+    connect(m_cancelTransforms, SIGNAL(clicked()), SLOT(slotCancelTransforms()));
 
     /* Very late as this will update other widgets */
     connect(this, SIGNAL(databaseModified()), SLOT(slotDatabaseModified()));
@@ -590,6 +596,7 @@ MainWindow::~MainWindow()
     }
     delete m_registry;
     delete m_progressBar;
+    delete m_cancelTransforms;
     delete m_gameList;
 
     delete autoGroup;
@@ -1169,7 +1176,7 @@ void MainWindow::openFICS()
 
 void MainWindow::copyDatabaseArchive(QString fname, QString destination)
 {
-    if(DatabaseInfo::IsLocalDatabase(fname))
+    if(DatabaseInfo::IsLocalDatabase(fname) || ArchiveDatabase::canOpen(fname))
     {
         copyDatabase(destination, fname);
     }
@@ -1221,8 +1228,9 @@ void MainWindow::copyDatabaseArchive(QString fname, QString destination)
 
 void MainWindow::openDatabaseArchive(QString fname, bool utf8)
 {
-    if(DatabaseInfo::IsLocalDatabase(fname))
+    if(DatabaseInfo::IsLocalDatabase(fname) || ArchiveDatabase::canOpen(fname))
     {
+        // gzipped PGN and zip archives with a single PGN file are read in place
         openDatabaseFile(fname, utf8);
     }
     else
@@ -2008,6 +2016,14 @@ void MainWindow::setupActions()
     connect(this, SIGNAL(signalCurrentDBhasGames(bool)), actionFindBoard, SLOT(setEnabled(bool)));
     search->addAction(actionFindBoard);
 
+    QAction* actionFindMaterial = createAction(tr("Find material..."), SLOT(slotSearchMaterial()));
+    connect(this, SIGNAL(signalCurrentDBhasGames(bool)), actionFindMaterial, SLOT(setEnabled(bool)));
+    search->addAction(actionFindMaterial);
+
+    QAction* actionFindComment = createAction(tr("Find comment..."), SLOT(slotSearchComment()));
+    connect(this, SIGNAL(signalCurrentDBhasGames(bool)), actionFindComment, SLOT(setEnabled(bool)));
+    search->addAction(actionFindComment);
+
     search->addSeparator();
 
     QAction* duplicates = createAction(tr("Filter duplicate games"), SLOT(slotDatabaseFilterDuplicateGames()));
@@ -2020,6 +2036,9 @@ void MainWindow::setupActions()
     duplicates = createAction(tr("Filter duplicate headers"), SLOT(slotDatabaseFilterDuplicateTags()));
     search->addAction(duplicates);
     connect(this, SIGNAL(signalCurrentDBhasGames(bool)), duplicates, SLOT(setEnabled(bool)));
+    QAction* similars = createAction(tr("Filter similar games"), SLOT(slotDatabaseFilterSimilarGames()));
+    search->addAction(similars);
+    connect(this, SIGNAL(signalCurrentDBhasGames(bool)), similars, SLOT(setEnabled(bool)));
 
     search->addSeparator();
 
@@ -2044,6 +2063,7 @@ void MainWindow::setupActions()
     refactorMenu2->addAction(createAction(refactorMenu2, tr("Remove Variations"), SLOT(slotDatabaseRemoveVariations())));
     refactorMenu2->addAction(createAction(refactorMenu2, tr("Prune null moves"), SLOT(slotDatabaseRemoveNullLines())));
     refactorMenu2->addAction(createAction(refactorMenu2, tr("Edit tag"), SLOT(slotDatabaseEditTag())));
+    refactorMenu2->addAction(createAction(refactorMenu2, tr("Correct spelling..."), SLOT(slotDatabaseCorrectSpelling())));
     menuDatabase->addSeparator();
     menuDatabase->addAction(createAction(tr("Clear clipboard"), SLOT(slotDatabaseClearClipboard())));
 
@@ -2119,6 +2139,9 @@ bool MainWindow::confirmQuit()
     if (!m_scratchPad->saveDocument())
         return false;
 
+    // The games transformed so far can be saved below
+    cancelGameTransformers();
+
     const auto dbs = m_registry->databases();
     for (auto dbi: dbs)
     {
@@ -2144,12 +2167,11 @@ bool MainWindow::confirmQuit()
         }
         if(response == MessageDialog::Yes)
         {
-            Output output(Output::Pgn, &BoardView::renderImageForBoard);
             for (auto dbi: dbs)
             {
-                if (dbi->database()->isModified())
+                if (dbi->isValid() && !dbi->isClipboard())
                 {
-                    output.outputLatin1(dbi->database()->filename(), *(dbi->database()));
+                    saveDatabase(dbi);
                 }
             }
         }
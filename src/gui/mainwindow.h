@@ -13,6 +13,7 @@
 #include "historylist.h"
 #include "output.h"
 #include "engineparameter.h"
+#include "gametransformer.h"
 
 #include <QtGui>
 #include <QAction>
@@ -62,6 +63,7 @@ class QSplitter;
 class TextEdit;
 class QTimer;
 class QToolBar;
+class QToolButton;
 class SaveDialog;
 class TranslatingSlider;
 class PolyglotWriter;
@@ -273,6 +275,8 @@ protected:
     void slotGameRemoveVariations();
     /** Remove all variations from all games. */
     void slotDatabaseRemoveVariations();
+    /** Correct player, event, site and round names of all games from a spelling file. */
+    void slotDatabaseCorrectSpelling();
     /** Remove all lines consisting only of a null move */
     void slotGameRemoveNullLines();
     /** Set a annotation into the current game (w/o Undo) */
@@ -324,6 +328,10 @@ protected:
     void slotSearchTag();
     /** Find current position */
     void slotSearchBoard();
+    /** Find games reaching a given material */
+    void slotSearchMaterial();
+    /** Find the games with comments containing some words */
+    void slotSearchComment();
     /** Receives the signal of a search board operation started */
     void slotBoardSearchStarted();
     /** Receives the signal of a search board operation end */
@@ -378,6 +386,8 @@ protected:
     void slotDatabaseFilterIdenticalGames();
     /** Filter out games with duoplicate headers from a complete database. */
     void slotDatabaseFilterDuplicateTags();
+    /** Filter out games which are near copies of other games, like games with misspelt names */
+    void slotDatabaseFilterSimilarGames();
     /** Clear the clipboard database */
     void slotDatabaseClearClipboard();
     /** Set the list into the filter and add all duplicates */
@@ -413,6 +423,10 @@ protected:
     void slotBookDone(QString path, PolyglotWriter* writer);
     /** Show a path in finder */
     void slotBookBuildError(QString path, PolyglotWriter *writer);
+    /** A database wide game transformation has finished or was cancelled */
+    void slotTransformDone(GameTransformer* transformer);
+    /** Stop the running database wide game transformations */
+    void slotCancelTransforms();
     /** Merge the clipboard into the current game */
     void slotEditMergePGN();
     /** Create a QImage from the current Board position */
@@ -511,6 +525,7 @@ protected slots:
     void slotShowUnderprotectedWhite();
     void slotShowUnderprotectedBlack();
     void cancelPolyglotWriters();
+    void cancelGameTransformers(Database* db = nullptr);
     void slotReadAhead();
 #ifdef USE_SPEECH
     void speechStateChanged(QTextToSpeech::State state);
@@ -629,6 +644,10 @@ private:
     void finishOperation(const QString& msg);
     /** Cancel operation with progress reporting. Hides progress bar. */
     void cancelOperation(const QString& msg);
+    /** Apply @p transformation to all games of the current database except the current one in the background */
+    void transformDatabase(GameTransformer::Transformation transformation, const QString& msg);
+    /** @return true, after telling the user, if the games of @p db are being transformed */
+    bool isTransforming(Database* db);
     /** Restore the list of recent files */
     void restoreRecentFiles();
     /** Load additional files at startup */
@@ -699,6 +718,7 @@ private:
     GameNotationWidget* m_gameView;
     OpeningTreeWidget* m_openingTreeWidget;
     QPointer<QProgressBar> m_progressBar;
+    QPointer<QToolButton> m_cancelTransforms;
     QPointer<TranslatingSlider> m_sliderSpeed;
     QLabel* m_sliderText;
     QPointer<QComboBox> m_comboEngine;
@@ -771,6 +791,7 @@ private:
     EngineParameter m_matchParameter;
     bool m_bEvalRequested;
     QList<PolyglotWriter*> m_polyglotWriters;
+    QList<GameTransformer*> m_gameTransformers;
     QMap<QUrl, QString> m_mapDatabaseToDroppedUrl;
     bool m_lastMessageWasHint;
 #ifdef USE_SPEECH
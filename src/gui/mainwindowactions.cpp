@@ -18,6 +18,7 @@
 #include "boardview.h"
 #include "boardviewex.h"
 #include "chessxsettings.h"
+#include "commentsearch.h"
 #include "copydialog.h"
 #include "guess_compileeco.h"
 #include "databaseinfo.h"
@@ -34,6 +35,7 @@
 #include "ficsclient.h"
 #include "ficsconsole.h"
 #include "ficsdatabase.h"
+#include "filter.h"
 #include "gamex.h"
 #include "gameid.h"
 #include "gamelist.h"
@@ -44,6 +46,7 @@
 #include "historylabel.h"
 #include "mainwindow.h"
 #include "matchparameterdlg.h"
+#include "materialsearch.h"
 #include "messagedialog.h"
 #include "memorydatabase.h"
 #include "openingtreewidget.h"
@@ -56,6 +59,7 @@
 #include "recipientaddressdialog.h"
 #include "renametagdialog.h"
 #include "shellhelper.h"
+#include "spellchecker.h"
 #include "settings.h"
 #include "streamdatabase.h"
 #include "tablebase.h"
@@ -78,6 +82,7 @@
 #ifdef USE_SPEECH
 #include <QTextToSpeech>
 #endif
+#include <QToolButton>
 
 #ifdef Q_OS_WIN
 #include <windows.h>
@@ -117,6 +122,7 @@ void MainWindow::slotFileOpen()
 {
     QStringList filters;
     filters << tr("PGN databases (*.pgn)")
+            << tr("Compressed PGN databases (*.pgn.gz *.gz *.zip)")
 #ifdef USE_SCID
            << tr("Scid databases (*.si4)")
 #endif
@@ -162,14 +168,24 @@ void MainWindow::slotFileOpenRecent()
 
 void MainWindow::saveDatabase(DatabaseInfo* dbInfo)
 {
-    if(!dbInfo->database()->isReadOnly() && dbInfo->database()->isModified())
+    if(!dbInfo->database()->isReadOnly() && dbInfo->database()->isModified() && !isTransforming(dbInfo->database()))
     {
         Database* db = dbInfo->database();
         QMutexLocker m(db->mutex());
         startOperation(tr("Saving %1...").arg(db->name()));
         Output output(Output::Pgn, &BoardView::renderImageForBoard);
         connect(&output, SIGNAL(progress(int)), SLOT(slotOperationProgress(int)));
-        output.outputLatin1(db->filename(), *db);
+        MemoryDatabase* memoryDb = qobject_cast<MemoryDatabase*>(db);
+        if(!memoryDb)
+        {
+            output.outputLatin1(db->filename(), *db);
+        }
+        else if(!memoryDb->save(output, db->isUtf8()))
+        {
+            cancelOperation(tr("Cannot save %1").arg(db->name()));
+            MessageDialog::error(tr("Cannot write file %1").arg(db->filename()));
+            return;
+        }
         finishOperation(tr("%1 saved").arg(db->name()));
     }
 }
@@ -220,6 +236,7 @@ bool MainWindow::closeDatabaseInfo(DatabaseInfo* aboutToClose, bool dontAsk)
     // Don't remove Clipboard
     if(!aboutToClose->isClipboard() && aboutToClose->IsLoaded())
     {
+        cancelGameTransformers(aboutToClose->database());
         if(dontAsk || QuerySaveDatabase(aboutToClose))
         {
             autoGroup->untrigger();
@@ -1605,7 +1622,7 @@ void MainWindow::slotGameNew()
 
 void MainWindow::saveGame(DatabaseInfo* dbInfo)
 {
-    if(!dbInfo->database()->isReadOnly())
+    if(!dbInfo->database()->isReadOnly() && !isTransforming(dbInfo->database()))
     {
         // TODO: Das Filtermodel muss vorher verstaendigt werden
         if (dbInfo->saveGame())
@@ -2079,92 +2096,128 @@ void MainWindow::slotGameRemoveNullLines()
 
 void MainWindow::slotDatabaseUncomment()
 {
+    if (isTransforming(database()))
+    {
+        return;
+    }
     if (MessageDialog::yesNo(tr("Delete all comments from all games?"), databaseInfo()->database()->name()))
     {
         game().removeCommentsDb();
         slotGameChanged(true);
         SimpleSaveGame();
-        GameX g;
-        for (GameId i=0, sz = static_cast<GameId>(database()->index()->count()); i < sz; ++i)
-        {
-            if(i != databaseInfo()->currentIndex())
-            {
-                if(database()->loadGame(i, g))
-                {
-                    g.removeCommentsDb();
-                    database()->replace(i, g);
-                }
-            }
-        }
+        transformDatabase([](GameX& g) { g.removeCommentsDb(); }, tr("Removing comments..."));
     }
 }
 
 void MainWindow::slotDatabaseRemoveTime()
 {
+    if (isTransforming(database()))
+    {
+        return;
+    }
     if (MessageDialog::yesNo(tr("Delete all time annotations from all games?"), databaseInfo()->database()->name()))
     {
         game().removeTimeCommentsDb();
         slotGameChanged(true);
         SimpleSaveGame();
-        GameX g;
-        for (GameId i = 0, sz = static_cast<GameId>(database()->index()->count()); i < sz; ++i)
-        {
-            if(i != databaseInfo()->currentIndex())
-            {
-                if(database()->loadGame(i, g))
-                {
-                    g.removeTimeCommentsDb();
-                    database()->replace(i, g);
-                }
-            }
-        }
+        transformDatabase([](GameX& g) { g.removeTimeCommentsDb(); }, tr("Removing time annotations..."));
     }
 }
 
 void MainWindow::slotDatabaseRemoveNullLines()
 {
+    if (isTransforming(database()))
+    {
+        return;
+    }
     if (MessageDialog::yesNo(tr("Prune null moves from all games?"), databaseInfo()->database()->name()))
     {
         game().removeNullLinesDb();
         slotGameChanged(true);
         SimpleSaveGame();
-        GameX g;
-        for (GameId i = 0, sz = static_cast<GameId>(database()->index()->count()); i < sz; ++i)
-        {
-            if(i != databaseInfo()->currentIndex())
-            {
-                if(database()->loadGame(i, g))
-                {
-                    g.removeNullLinesDb();
-                    database()->replace(i, g);
-                }
-            }
-        }
+        transformDatabase([](GameX& g) { g.removeNullLinesDb(); }, tr("Pruning null moves..."));
     }
 }
 
 void MainWindow::slotDatabaseRemoveVariations()
 {
+    if (isTransforming(database()))
+    {
+        return;
+    }
     if (MessageDialog::yesNo(tr("Delete all variations from all games?"), databaseInfo()->database()->name()))
     {
         game().removeVariationsDb();
         slotGameChanged(true);
         SimpleSaveGame();
-        GameX g;
-        for (GameId i = 0, sz = static_cast<GameId>(database()->index()->count()); i < sz; ++i)
+        transformDatabase([](GameX& g) { g.removeVariationsDb(); }, tr("Removing variations..."));
+    }
+}
+
+void MainWindow::transformDatabase(GameTransformer::Transformation transformation, const QString& msg)
+{
+    GameTransformer* transformer = new GameTransformer(this);
+    connect(transformer, SIGNAL(transformFinished(GameTransformer*)), SLOT(slotTransformDone(GameTransformer*)), Qt::QueuedConnection);
+    connect(transformer, SIGNAL(progress(int)), SLOT(slotOperationProgress(int)), Qt::QueuedConnection);
+    startOperation(msg);
+    m_gameTransformers.append(transformer);
+    statusBar()->insertPermanentWidget(1, m_cancelTransforms);
+    m_cancelTransforms->show();
+    FilterX allGames(database());
+    transformer->transformGames(&allGames, transformation, databaseInfo()->currentIndex());
+}
+
+void MainWindow::cancelGameTransformers(Database* db)
+{
+    foreach (GameTransformer* transformer, m_gameTransformers)
+    {
+        if (!db || transformer->database() == db)
         {
-            if(i != databaseInfo()->currentIndex())
-            {
-                if(database()->loadGame(i, g))
-                {
-                    g.removeVariationsDb();
-                    database()->replace(i, g);
-                }
-            }
+            transformer->cancel();
+            transformer->wait();
         }
     }
 }
 
+void MainWindow::slotTransformDone(GameTransformer* transformer)
+{
+    if (transformer->wasCancelled())
+    {
+        cancelOperation(tr("Operation cancelled after %n game(s)", "", transformer->transformedCount()));
+    }
+    else
+    {
+        finishOperation(tr("%n game(s) changed", "", transformer->transformedCount()));
+    }
+    m_gameTransformers.removeOne(transformer);
+    if (m_gameTransformers.isEmpty())
+    {
+        statusBar()->removeWidget(m_cancelTransforms);
+    }
+}
+
+void MainWindow::slotCancelTransforms()
+{
+    foreach (GameTransformer* transformer, m_gameTransformers)
+    {
+        transformer->cancel();
+    }
+}
+
+bool MainWindow::isTransforming(Database* db)
+{
+    // Jobs and edits would replace the same games, one overwriting the other
+    foreach (GameTransformer* transformer, m_gameTransformers)
+    {
+        if (transformer->database() == db)
+        {
+            MessageDialog::information(tr("The games of %1 are being transformed. Wait for it to finish or cancel it.").arg(db->name()));
+            return true;
+        }
+    }
+    return false;
+}
+
 void MainWindow::slotDatabaseEditTag()
 {
     QStringList list = database()->index()->tagNames();
@@ -2182,6 +2235,36 @@ void MainWindow::slotDatabaseEditTag()
     }
 }
 
+void MainWindow::slotDatabaseCorrectSpelling()
+{
+    QString filename = QFileDialog::getOpenFileName(this, tr("Correct spelling"), QString(),
+                                                    tr("Spelling files (*.ssp);;All Files(*.*)"));
+    if (filename.isEmpty())
+    {
+        return;
+    }
+    Spellchecker spellchecker;
+    if (!spellchecker.import(filename))
+    {
+        MessageDialog::error(tr("Cannot read spelling file %1").arg(filename));
+        return;
+    }
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    int corrected = spellchecker.correct(*database()->index());
+    QApplication::restoreOverrideCursor();
+    if (corrected)
+    {
+        // The loaded game keeps its own tags, they would be saved back otherwise
+        spellchecker.correct(game());
+        database()->setModified(true);
+        m_eventList->setDatabase(databaseInfo());
+        m_playerList->setDatabase(databaseInfo());
+        emit signalGameModified(false);
+        UpdateBoardInformation();
+    }
+    slotStatusMessage(tr("%n name(s) corrected", "", corrected));
+}
+
 void MainWindow::slotGameSetComment(QString annotation)
 {
     if (databaseInfo())
@@ -3039,7 +3122,7 @@ void MainWindow::gameChangeTag(GameId id, QString tag)
     if (databaseInfo()->currentIndex()==id)
     {
         game().setTag(tag, database()->index()->tagValue(tag, id));
-        database()->setModified(true);
+        database()->setGameChanged(id);
         m_eventList->setDatabase(databaseInfo());
         m_playerList->setDatabase(databaseInfo());
         emit signalGameModified(false);
@@ -3325,6 +3408,11 @@ void MainWindow::slotDatabaseFilterDuplicateTags()
     filterDuplicates(DuplicateSearch::DS_Tags);
 }
 
+void MainWindow::slotDatabaseFilterSimilarGames()
+{
+    filterDuplicates(DuplicateSearch::DS_Similar);
+}
+
 void MainWindow::copyFromDatabase(int preselect, QList<GameId> gameIndexList)
 {
     QStringList db;
@@ -3590,6 +3678,52 @@ void MainWindow::slotSearchBoard()
     }
 }
 
+void MainWindow::slotSearchMaterial()
+{
+    bool ok;
+    QString material = QInputDialog::getText(this, tr("Find material"),
+                                             tr("Material of white and black, e.g. KRP-KB:"),
+                                             QLineEdit::Normal, QString(), &ok);
+    if (!ok || material.isEmpty())
+    {
+        return;
+    }
+    int plies = QInputDialog::getInt(this, tr("Find material"), tr("Minimum number of plies:"), 1, 1, 999, 1, &ok);
+    if (!ok)
+    {
+        return;
+    }
+
+    MaterialSearch* ms = new MaterialSearch(databaseInfo()->filter()->database());
+    if (!ms->setMaterial(material))
+    {
+        delete ms;
+        MessageDialog::error(tr("Cannot parse material %1").arg(material));
+        return;
+    }
+    ms->setMinPlies(plies);
+    m_openingTreeWidget->cancel();
+    slotBoardSearchStarted();
+    m_gameList->executeSearch(ms);
+}
+
+void MainWindow::slotSearchComment()
+{
+    bool ok;
+    QString query = QInputDialog::getText(this, tr("Find comment"),
+                                          tr("Words in the comments, \"words in a row\", prefix*:"),
+                                          QLineEdit::Normal, QString(), &ok);
+    if (!ok || query.trimmed().isEmpty())
+    {
+        return;
+    }
+
+    CommentSearch* cs = new CommentSearch(databaseInfo()->filter()->database(), query);
+    m_openingTreeWidget->cancel();
+    slotBoardSearchStarted();
+    m_gameList->executeSearch(cs);
+}
+
 void MainWindow::slotBoardSearchUpdate(int progress)
 {
     slotFilterChanged(false);
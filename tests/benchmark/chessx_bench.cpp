@@ -0,0 +1,424 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/**
+Micro benchmarks for the board, PGN and search code.
+
+All data is generated from a fixed seed, so two runs on the same machine
+measure the same work. Results are written as JSON, one record per
+benchmark with the minimum and median of the repeated runs, and a checksum
+of the computed values which must not change between runs or versions.
+
+Usage: chessx_bench [--games N] [--repeat N] [--only name[,name...]] [--output file.json]
+*/
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QVector>
+
+#include <algorithm>
+#include <functional>
+
+#include "board.h"
+#include "filter.h"
+#include "gamex.h"
+#include "pgndatabase.h"
+#include "polyglotdatabase.h"
+#include "positionsearch.h"
+#include "settings.h"
+#include "tagsearch.h"
+
+using namespace chessx;
+
+namespace {
+
+/** Small deterministic generator, independent of the C library */
+class Random
+{
+public:
+    explicit Random(quint64 seed) : m_state(seed) {}
+    quint64 next()
+    {
+        m_state ^= m_state >> 12;
+        m_state ^= m_state << 25;
+        m_state ^= m_state >> 27;
+        return m_state * 2685821657736338717ULL;
+    }
+    int bounded(int n)
+    {
+        return static_cast<int>(next() % static_cast<quint64>(n));
+    }
+private:
+    quint64 m_state;
+};
+
+/** A position with one of its legal moves, used for move level benchmarks */
+struct PositionMove
+{
+    BoardX board;
+    Move move;
+    QString san;
+};
+
+/** Return the legal moves of @p board */
+Move::List legalMoves(const BoardX& board)
+{
+    Move::List moves(board.generateMoves());
+    Move::List legal;
+    for(int i = 0; i < moves.size(); ++i)
+    {
+        BoardX next(board);
+        next.doMove(moves[i]);
+        if(!next.isAttackedBy(next.toMove(), next.kingSquare(board.toMove())))
+        {
+            legal.append(moves[i]);
+        }
+    }
+    return legal;
+}
+
+/** Write @p count random games to @p filename. The first plies are drawn from
+    a few candidates only, so the games share openings like a real database. */
+bool generatePgn(const QString& filename, int count, QVector<PositionMove>& samples)
+{
+    QFile file(filename);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        return false;
+    }
+    QTextStream out(&file);
+    Random random(20061216);
+    static const char* results[] = { "1-0", "0-1", "1/2-1/2", "*" };
+    for(int game = 0; game < count; ++game)
+    {
+        const char* result = results[random.bounded(4)];
+        out << "[Event \"Benchmark " << (game % 20) << "\"]\n";
+        out << "[Site \"Generated\"]\n";
+        out << "[Date \"" << 1990 + game % 30 << "." << QString::number(1 + game % 12).rightJustified(2, '0') << ".01\"]\n";
+        out << "[Round \"" << 1 + game % 9 << "\"]\n";
+        out << "[White \"Player " << random.bounded(50) << "\"]\n";
+        out << "[Black \"Player " << random.bounded(50) << "\"]\n";
+        out << "[Result \"" << result << "\"]\n\n";
+
+        BoardX board;
+        board.setStandardPosition();
+        int plies = 40 + random.bounded(80);
+        for(int ply = 0; ply < plies; ++ply)
+        {
+            Move::List moves = legalMoves(board);
+            if(moves.isEmpty())
+            {
+                break;
+            }
+            int choice = ply < 8 ? random.bounded(std::min(3, moves.size())) : random.bounded(moves.size());
+            Move move = moves[choice];
+            QString san = board.moveToSan(move);
+            if(ply % 2 == 0)
+            {
+                out << (ply / 2 + 1) << ". ";
+            }
+            out << san << ((ply % 12 == 11) ? "\n" : " ");
+            if(samples.size() < 20000 && ply % 3 == 0)
+            {
+                PositionMove sample;
+                sample.board = board;
+                sample.move = move;
+                sample.san = san;
+                samples.append(sample);
+            }
+            board.doMove(move);
+        }
+        out << result << "\n\n";
+    }
+    return file.error() == QFile::NoError;
+}
+
+/** Keep the JSON on stdout clean, the library reports progress with qDebug */
+void quietMessageHandler(QtMsgType type, const QMessageLogContext&, const QString& msg)
+{
+    if(type != QtDebugMsg && type != QtInfoMsg)
+    {
+        QTextStream(stderr) << msg << '\n';
+    }
+}
+
+class BenchmarkRunner
+{
+public:
+    BenchmarkRunner(int repeat, const QStringList& only) : m_repeat(repeat), m_only(only) {}
+
+    /** Run @p work m_repeat times. @p work returns a checksum of its result,
+        @p items is the number of operations one run performs. */
+    void run(const QString& name, qint64 items, const std::function<quint64()>& work)
+    {
+        if(!m_only.isEmpty() && !m_only.contains(name))
+        {
+            return;
+        }
+        QTextStream(stderr) << name << "...\n";
+        QVector<qint64> times;
+        quint64 checksum = 0;
+        for(int i = 0; i < m_repeat; ++i)
+        {
+            QElapsedTimer timer;
+            timer.start();
+            quint64 sum = work();
+            times.append(timer.nsecsElapsed());
+            if(i > 0 && sum != checksum)
+            {
+                QTextStream(stderr) << name << ": checksum differs between runs\n";
+                m_failed = true;
+            }
+            checksum = sum;
+        }
+        std::sort(times.begin(), times.end());
+        qint64 median = times[times.size() / 2];
+
+        QJsonObject result;
+        result["name"] = name;
+        result["items"] = items;
+        result["repeat"] = m_repeat;
+        result["min_ns"] = double(times.first());
+        result["median_ns"] = double(median);
+        result["ns_per_item"] = items ? double(median) / items : 0.0;
+        result["checksum"] = QString::number(checksum, 16);
+        m_results.append(result);
+    }
+
+    QJsonArray results() const { return m_results; }
+    bool failed() const { return m_failed; }
+
+private:
+    int m_repeat;
+    QStringList m_only;
+    QJsonArray m_results;
+    bool m_failed = false;
+};
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    qInstallMessageHandler(quietMessageHandler);
+
+    int gameCount = 2000;
+    int repeat = 5;
+    QStringList only;
+    QString outputFile;
+    QStringList args = app.arguments();
+    for(int i = 1; i < args.size(); ++i)
+    {
+        bool hasValue = i + 1 < args.size();
+        if(args[i] == "--games" && hasValue)
+        {
+            gameCount = qMax(1, args[++i].toInt());
+        }
+        else if(args[i] == "--repeat" && hasValue)
+        {
+            repeat = qMax(1, args[++i].toInt());
+        }
+        else if(args[i] == "--only" && hasValue)
+        {
+            only = args[++i].split(',');
+        }
+        else if(args[i] == "--output" && hasValue)
+        {
+            outputFile = args[++i];
+        }
+        else
+        {
+            QTextStream(stderr) << "Usage: chessx_bench [--games N] [--repeat N] [--only name[,name...]] [--output file.json]\n";
+            return 1;
+        }
+    }
+
+    QTemporaryDir dir;
+    if(!dir.isValid())
+    {
+        QTextStream(stderr) << "Cannot create a temporary directory\n";
+        return 1;
+    }
+    // required by PgnDatabase::open() to check if indexing is enabled
+    AppSettings = new Settings(dir.filePath("chessx_bench.ini"));
+    AppSettings->setValue("/General/useIndexFile", false);
+
+    QString pgnFile = dir.filePath("bench.pgn");
+    QVector<PositionMove> samples;
+    if(!generatePgn(pgnFile, gameCount, samples))
+    {
+        QTextStream(stderr) << "Cannot write " << pgnFile << '\n';
+        return 1;
+    }
+
+    BenchmarkRunner bench(repeat, only);
+
+    // Move generation
+    BoardX start;
+    start.setStandardPosition();
+    BoardX kiwipete;
+    kiwipete.fromFen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    bench.run("perft_start_4", 197281, [&]() { return start.perft(4); });
+    bench.run("perft_kiwipete_3", 97862, [&]() { return kiwipete.perft(3); });
+
+    // SAN reading and writing
+    bench.run("san_parse", samples.size(), [&]()
+    {
+        quint64 sum = 0;
+        for(const PositionMove& sample : samples)
+        {
+            sum += sample.board.parseMove(sample.san).rawMove();
+        }
+        return sum;
+    });
+    bench.run("san_write", samples.size(), [&]()
+    {
+        quint64 sum = 0;
+        for(const PositionMove& sample : samples)
+        {
+            sum += qHash(sample.board.moveToSan(sample.move));
+        }
+        return sum;
+    });
+
+    // PGN database
+    bench.run("pgn_open_index", gameCount, [&]()
+    {
+        PgnDatabase db;
+        db.open(pgnFile, false);
+        db.parseFile();
+        return db.count();
+    });
+
+    PgnDatabase db;
+    if(!db.open(pgnFile, false) || !db.parseFile())
+    {
+        QTextStream(stderr) << "Cannot open " << pgnFile << '\n';
+        return 1;
+    }
+    int count = static_cast<int>(db.count());
+
+    bench.run("pgn_load_game", count, [&]()
+    {
+        quint64 sum = 0;
+        GameX game;
+        for(GameId id = 0; id < GameId(count); ++id)
+        {
+            db.loadGame(id, game);
+            game.moveToEnd();
+            sum += game.board().getHashValue();
+        }
+        return sum;
+    });
+
+    BoardX afterFirstMove(start);
+    afterFirstMove.doMove(legalMoves(start).first());
+    bench.run("pgn_find_position", count, [&]()
+    {
+        quint64 sum = 0;
+        for(GameId id = 0; id < GameId(count); ++id)
+        {
+            sum += quint64(db.findPosition(id, afterFirstMove) + 1);
+        }
+        return sum;
+    });
+
+    // Opening tree refresh, batched the same way as OpeningTreeThread
+    bench.run("opening_tree", count, [&]()
+    {
+        QMap<Move, MoveData> moves;
+        QList<GameId> games;
+        QList<MoveId> found;
+        quint64 sum = 0;
+        for(int first = 0; first < count; first += 100)
+        {
+            games.clear();
+            found.clear();
+            for(int id = first; id < qMin(count, first + 100); ++id)
+            {
+                games.append(GameId(id));
+            }
+            db.findPosition(afterFirstMove, Database::PositionSearch_Default, games, found, moves);
+            foreach(MoveId moveId, found)
+            {
+                sum += (moveId != NO_MOVE);
+            }
+        }
+        return sum * 1000 + quint64(moves.count());
+    });
+
+    // Filter searches, run synchronously in this thread
+    bench.run("filter_tag_search", count, [&]()
+    {
+        FilterX filter(&db);
+        TagSearch search(&db, TagNameWhite, "Player 7");
+        filter.runSingleSearch(&search, FilterOperator::NullOperator);
+        return quint64(filter.count());
+    });
+    bench.run("filter_position_search", count, [&]()
+    {
+        FilterX filter(&db);
+        PositionSearch search(&db, afterFirstMove);
+        filter.runSingleSearch(&search, FilterOperator::NullOperator);
+        return quint64(filter.count());
+    });
+
+    // Polyglot book built from the generated games
+    QString bookFile = dir.filePath("bench.bin");
+    {
+        volatile bool breakFlag = false;
+        PolyglotDatabase writer;
+        if(writer.openForWriting(bookFile, 20, 1, false, 0, 0))
+        {
+            writer.book_make(db, breakFlag);
+        }
+    }
+    PolyglotDatabase book;
+    if(book.open(bookFile, false))
+    {
+        bench.run("polyglot_lookup", samples.size(), [&]()
+        {
+            quint64 sum = 0;
+            QMap<Move, MoveData> moves;
+            for(const PositionMove& sample : samples)
+            {
+                sum += book.getMoveMapForBoard(sample.board, moves);
+            }
+            return sum;
+        });
+    }
+
+    QJsonObject report;
+    report["benchmark"] = QString("chessx_bench");
+    report["qt"] = QString(qVersion());
+    report["games"] = count;
+    report["pext"] = bb_UsePext;
+    report["results"] = bench.results();
+    QByteArray json = QJsonDocument(report).toJson();
+
+    if(outputFile.isEmpty())
+    {
+        QTextStream(stdout) << json;
+    }
+    else
+    {
+        QFile file(outputFile);
+        if(!file.open(QIODevice::WriteOnly) || file.write(json) != json.size())
+        {
+            QTextStream(stderr) << "Cannot write " << outputFile << '\n';
+            return 1;
+        }
+    }
+    delete AppSettings;
+    return bench.failed() ? 2 : 0;
+}
@@ -1,8 +0,0 @@
-#include "game.h"
-
-int main(int argc, char* argv[])
-{
-    Game::loadEcoFile("../../data/chessx.eco");
-    qDebug("Done");
-    return 0;
-}
\ No newline at end of file
@@ -318,6 +318,61 @@ void BoardTest::testCreateHash()
     QVERIFY(board1 == board2);
 }
 
+// Count the legal move tree of well known positions, any error in the
+// sliding attack lookup or in doMove/undoMove shows up as a wrong count
+void BoardTest::testPerft_data()
+{
+    QTest::addColumn<QString>("fen");
+    QTest::addColumn<int>("depth");
+    QTest::addColumn<quint64>("nodes");
+
+    const QString start("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    const QString kiwipete("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    const QString endgame("8/2p5/3p4/KP5r/1R3p2/8/8/8 w - - 0 1");
+
+    QTest::newRow("start 1") << start << 1 << quint64(20);
+    QTest::newRow("start 2") << start << 2 << quint64(400);
+    QTest::newRow("start 3") << start << 3 << quint64(8902);
+    QTest::newRow("start 4") << start << 4 << quint64(197281);
+    QTest::newRow("kiwipete 1") << kiwipete << 1 << quint64(48);
+    QTest::newRow("kiwipete 2") << kiwipete << 2 << quint64(2039);
+    QTest::newRow("endgame 1") << endgame << 1 << quint64(14);
+    QTest::newRow("endgame 2") << endgame << 2 << quint64(191);
+    QTest::newRow("endgame 3") << endgame << 3 << quint64(2812);
+}
+
+void BoardTest::testPerft()
+{
+    QFETCH(QString, fen);
+    QFETCH(int, depth);
+    QFETCH(quint64, nodes);
+
+    BoardX board;
+    QVERIFY(board.fromFen(fen));
+    QCOMPARE(board.perft(depth), nodes);
+}
+
+// The byte parser must stop at the given length and agree with the QString one
+void BoardTest::testParseMoveBytes()
+{
+    BoardX board;
+    QVERIFY(board.fromFen("r3k3/1P6/8/8/8/8/8/R3K1N1 w Qq - 0 1"));
+
+    const char* text = "Nf3 b8=Q bxa8=N O-O-O Kf1";
+    QCOMPARE(board.parseMove(text, 3), board.parseMove(QString("Nf3")));
+    QVERIFY(board.parseMove(text, 3).isLegal());
+    QCOMPARE(board.parseMove(text + 4, 4), board.parseMove(QString("b8=Q")));
+    QCOMPARE(board.parseMove(text + 4, 4).promotedPiece(), WhiteQueen);
+    QCOMPARE(board.parseMove(text + 9, 6).promotedPiece(), WhiteKnight);
+    QVERIFY(board.parseMove(text + 16, 5).isCastling());
+    QVERIFY(board.parseMove(text + 22, 3).isLegal());
+
+    // Cut short, the move is incomplete
+    QVERIFY(!board.parseMove(text, 2).isLegal());
+    QVERIFY(!board.parseMove(text + 16, 4).isLegal());
+    QVERIFY(board.parseMove("--", 2).isNullMove());
+}
+
 // FIXME -- Add setAt hash testing
 // FIXME -- Validate forward and backward hashing match
 // FIXME -- Add tests for bad moves.. and bad parsing strings
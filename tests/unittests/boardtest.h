@@ -35,6 +35,9 @@ private slots:
     void testValidate_data();
     void testReversableHash();
     void testReversableHash_data();
+    void testPerft();
+    void testParseMoveBytes();
+    void testPerft_data();
 };
 
 #endif
@@ -32,4 +32,12 @@ void DatabaseConversionTest::testConvertDatabase()
 
     DatabaseConversion converter;
     QVERIFY(converter.playerDatabaseFromScidRatings(RESOURCE_PATH "small/ratings.ssp", tmpDir.path() + "/converted", tmpDir.path() + "photos"));
+
+    // Written in the mapped format, the intermediate database is gone
+    PlayerDatabase pdb;
+    QVERIFY(pdb.open(tmpDir.path() + "/converted"));
+    QVERIFY(pdb.count() > 0);
+    QVERIFY(!pdb.add("TRUSDFEADFA, WSDFASDF"));
+    pdb.close();
+    QCOMPARE(QDir(tmpDir.path()).entryList(QStringList() << "converted.tmp*"), QStringList());
 }
@@ -389,3 +389,152 @@ void GameTest::testVariationManipulation()
     m_game->truncateVariation();
     m_game->moveToId(44);
 }
+
+// Variations are chained through their first nodes, check that reordering,
+// promoting and removing keep the chain intact, and that copies are separate
+void GameTest::testVariationLinks()
+{
+    GameX game;
+    MoveId e4 = game.addMove("e4");
+    game.backward();
+    MoveId d4 = game.addVariation("d4");
+    game.backward();
+    MoveId c4 = game.addVariation("c4");
+    game.backward();
+    MoveId nf3 = game.addVariation("Nf3");
+    game.moveToStart();
+    QCOMPARE(game.variations(), QList<MoveId>() << d4 << c4 << nf3);
+    QCOMPARE(game.cursor().variationCount(ROOT_NODE), 3);
+
+    game.moveToId(c4);
+    game.moveVariationUp(c4);
+    QCOMPARE(game.cursor().variations(ROOT_NODE), QList<MoveId>() << c4 << d4 << nf3);
+    game.moveVariationDown(c4);
+    QCOMPARE(game.cursor().variations(ROOT_NODE), QList<MoveId>() << d4 << c4 << nf3);
+
+    GameX copy(game);
+    QVERIFY(copy.removeVariation(c4));
+    // Removing a variation compacts the move tree, so node ids may be renumbered
+    QStringList remaining;
+    for (MoveId id: copy.cursor().variations(ROOT_NODE))
+    {
+        remaining << copy.moveToSan(GameX::MoveOnly, GameX::PreviousMove, id);
+    }
+    QCOMPARE(remaining, QStringList() << "d4" << "Nf3");
+    QCOMPARE(game.cursor().variations(ROOT_NODE), QList<MoveId>() << d4 << c4 << nf3);
+
+    game.promoteVariation(nf3);
+    QCOMPARE(game.cursor().nextMove(ROOT_NODE), nf3);
+    QCOMPARE(game.cursor().variations(ROOT_NODE), QList<MoveId>() << d4 << c4 << e4);
+    QVERIFY(game.isMainline(nf3));
+    QVERIFY(!game.isMainline(e4));
+}
+
+void GameTest::testUndoDelta()
+{
+    GameX before;
+    before.addMove("e4");
+    before.addMove("e5");
+    MoveId nf3 = before.addMove("Nf3");
+    before.backward();
+    before.addVariation("Bc4");
+    before.setTag("White", "Alice");
+    before.moveToId(nf3);
+
+    // annotations only, no node is recorded
+    GameX annotated(before);
+    annotated.setAnnotation("Main line");
+    annotated.addNag(GoodMove);
+    annotated.setTag("White", "Bob");
+    GameX::Delta delta = GameX::diff(before, annotated);
+    QCOMPARE(delta.moves.nodes.count(), 0);
+    QCOMPARE(delta.annotations.count(), 1);
+    QCOMPARE(delta.nags.count(), 1);
+    QCOMPARE(delta.tags.count(), 1);
+
+    // move tree changes, including a compaction which renumbers nodes
+    GameX after(annotated);
+    after.moveToId(nf3);
+    after.addMove("Nc6");
+    after.moveToId(nf3);
+    after.backward();
+    after.removeVariation(after.variations().first());
+    GameX::Delta treeDelta = GameX::diff(annotated, after);
+
+    GameX game(after);
+    game.applyDelta(treeDelta, true);
+    QVERIFY(game.isEqual(annotated));
+    QCOMPARE(game.cursor().capacity(), annotated.cursor().capacity());
+    QCOMPARE(game.currentMove(), annotated.currentMove());
+    QCOMPARE(game.toFen(), annotated.toFen());
+
+    game.applyDelta(delta, true);
+    QVERIFY(game.isEqual(before));
+    QCOMPARE(game.tag("White"), QString("Alice"));
+    QVERIFY(game.annotation(nf3).isEmpty());
+
+    game.applyDelta(delta);
+    game.applyDelta(treeDelta);
+    QVERIFY(game.isEqual(after));
+    QCOMPARE(game.cursor().variations(game.cursor().prevMove(nf3)), after.cursor().variations(after.cursor().prevMove(nf3)));
+    QCOMPARE(game.toFen(), after.toFen());
+
+    // merged deltas span both edits
+    GameX::mergeDelta(delta, treeDelta);
+    game.applyDelta(delta, true);
+    QVERIFY(game.isEqual(before));
+    QCOMPARE(game.cursor().capacity(), before.cursor().capacity());
+    game.applyDelta(delta);
+    QVERIFY(game.isEqual(after));
+    QCOMPARE(game.tag("White"), QString("Bob"));
+}
+
+void GameTest::testAnnotationCommands()
+{
+    GameX game;
+    MoveId e4 = game.addMove("e4");
+    game.dbSetAnnotation("Good [%eval 0.35] [%clk 1:59:58] [%csl Gd4,Re5] [%cal Ge2e4]", e4);
+    MoveId e5 = game.addMove("e5");
+    game.dbSetAnnotation("[%eval -1.5]", e5);
+    game.addMove("Nf3");
+
+    QCOMPARE(game.squareAnnotation(e4), QString("Gd4,Re5"));
+    QCOMPARE(game.arrowAnnotation(e4), QString("Ge2e4"));
+    QCOMPARE(game.timeAnnotation(e4), QString("1:59:58"));
+    QCOMPARE(game.specAnnotations(e4), QString("[%csl Gd4,Re5][%cal Ge2e4][%eval 0.35]"));
+
+    QList<double> evaluations;
+    game.scoreEvaluations(evaluations);
+    QCOMPARE(evaluations, QList<double>() << 0.0 << 0.35 << -1.5 << -1.5);
+    QList<double> material;
+    game.scoreMaterial(material);
+    QCOMPARE(material.count(), 4);
+
+    // changed comments are parsed again
+    game.dbSetAnnotation("[%eval 2.00]", e5);
+    game.scoreEvaluations(evaluations);
+    QCOMPARE(evaluations.at(2), 2.0);
+    game.dbSetAnnotation("No commands", e4);
+    QVERIFY(game.squareAnnotation(e4).isEmpty());
+    QVERIFY(game.timeAnnotation(e4).isEmpty());
+}
+
+void GameTest::testFingerprint()
+{
+    GameX game;
+    MoveId e4 = game.addMove("e4");
+    game.addMove("e5");
+    game.dbSetAnnotation("Good", e4);
+
+    GameX copy(game);
+    QCOMPARE(copy.fingerprint(), game.fingerprint());
+
+    copy.dbSetAnnotation("Better", e4);
+    QVERIFY(copy.fingerprint() != game.fingerprint());
+    QCOMPARE(copy.fingerprint(false), game.fingerprint(false));
+
+    GameX other;
+    other.addMove("e4");
+    other.addMove("c5");
+    QVERIFY(other.fingerprint(false) != game.fingerprint(false));
+}
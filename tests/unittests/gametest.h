@@ -50,6 +50,10 @@ private slots:
     void testTags();
     void testCounters();
     void testVariationManipulation();
+    void testVariationLinks();
+    void testUndoDelta();
+    void testAnnotationCommands();
+    void testFingerprint();
 
     void testTags_data();
     //void testName();
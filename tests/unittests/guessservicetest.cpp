@@ -0,0 +1,53 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "guessservicetest.h"
+
+#include <QSignalSpy>
+
+#include "board.h"
+#include "guessservice.h"
+
+using namespace chessx;
+
+void GuessServiceTest::testGuess()
+{
+    GuessService service;
+    QSignalSpy spy(&service, SIGNAL(guessFound(int)));
+    BoardX board;
+    board.setStandardPosition();
+    service.setBoard(board);
+
+    // The squares of the side to move are guessed without being asked for
+    Guess::Result result;
+    Guess::MoveList moves;
+    QTRY_VERIFY_WITH_TIMEOUT(service.guess(board, e2, result, moves), 10000);
+    QVERIFY(!result.error);
+    QCOMPARE(Square(result.from), e2);
+    QVERIFY(!spy.isEmpty());
+
+    // Other squares only when they are asked for
+    QVERIFY(!service.guess(board, e7, result, moves));
+    QTRY_VERIFY_WITH_TIMEOUT(spy.contains(QList<QVariant>() << int(e7)), 10000);
+    QVERIFY(service.guess(board, e7, result, moves));
+
+    // A new board drops the guesses of the previous one
+    board.doMove(board.parseMove("e4"));
+    QVERIFY(!service.guess(board, g1, result, moves));
+    service.stop();
+}
+
+void GuessServiceTest::testSharedService()
+{
+    GuessService* service = GuessService::acquire();
+    QCOMPARE(GuessService::acquire(), service);
+    GuessService::release();
+    GuessService::release();
+    GuessService* other = GuessService::acquire();
+    QVERIFY(other);
+    GuessService::release();
+}
@@ -0,0 +1,25 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+/**
+Unit tests for the GuessService class
+*/
+
+#ifndef GUESSSERVICETEST_H
+#define GUESSSERVICETEST_H
+
+#include <QtTest/QtTest>
+
+class GuessServiceTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testGuess();
+    void testSharedService();
+};
+
+#endif
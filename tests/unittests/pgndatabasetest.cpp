@@ -19,14 +19,22 @@ Unit tests for the PgnDatabase class.
 */
 
 #include "pgndatabasetest.h"
+#include <QPointer>
 #include <QTemporaryDir>
 
 #include "resourcepath.h"
 
+#include "archivedatabase.h"
 #include "pgndatabase.h"
 #include "memorydatabase.h"
+#include "quagzipfile.h"
+#include "quazip.h"
+#include "quazipfile.h"
 #include "gamex.h"
 #include "filter.h"
+#include "filtermodel.h"
+#include "gametransformer.h"
+#include "output.h"
 #include "search.h"
 #include "settings.h"
 
@@ -99,6 +107,352 @@ void PgnDatabaseTest::testCopyGameIntoNewDB()
     delete src;
 }
 
+void PgnDatabaseTest::testTransformGames()
+{
+    QTemporaryDir tmpDir;
+    const QString path = tmpDir.path() + "/transform.pgn";
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Text));
+    for (int i = 0; i < 600; ++i)
+    {
+        file.write("[Event \"Transform\"]\n[Result \"*\"]\n\n1. e4 {a comment} e5 2. Nf3 (2. Nc3 {another}) Nc6 *\n\n");
+    }
+    file.close();
+
+    Database* db = new MemoryDatabase();
+    QVERIFY(db->open(path, false));
+    QVERIFY(db->parseFile());
+    QCOMPARE(db->count(), quint64(600));
+
+    FilterX filter(db);
+    filter.set(3, 0);
+    QPointer<GameTransformer> transformer = new GameTransformer;
+    transformer->transformGames(&filter, [](GameX& g) { g.removeCommentsDb(); }, 0);
+    QVERIFY(transformer->wait(60000));
+    QCOMPARE(transformer->transformedCount(), 598);
+    QVERIFY(!transformer->wasCancelled());
+    // run() ends with deleteLater(), deliver it as there is no event loop here
+    QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+    QVERIFY(transformer.isNull());
+
+    GameX game;
+    for (GameId i = 0; i < 600; ++i)
+    {
+        QVERIFY(db->loadGame(i, game));
+        game.moveToStart();
+        game.forward();
+        bool untouched = (i == 0 || i == 3);
+        QCOMPARE(game.annotation().isEmpty(), !untouched);
+        QCOMPARE(game.plyCount(), 4);
+    }
+    QVERIFY(db->isModified());
+    delete db;
+}
+
+void PgnDatabaseTest::testIncrementalSave()
+{
+    QTemporaryDir tmpDir;
+    const QString path = tmpDir.path() + "/save.pgn";
+    const QByteArray first = "[Event \"One\"]\n[Result \"*\"]\n\n1.e4   e5 {kept   as is} *\n\n";
+    const QByteArray second = "[Event \"Two\"]\n[Result \"*\"]\n\n1.d4 d5 *\n\n";
+    const QByteArray third = "[Event \"Three\"]\n[Result \"*\"]\n\n1.c4  c5 *";
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(first + second + third);
+    file.close();
+
+    MemoryDatabase* db = new MemoryDatabase();
+    QVERIFY(db->open(path, false));
+    QVERIFY(static_cast<Database*>(db)->parseFile()); // MemoryDatabase hides it
+    QCOMPARE(db->count(), quint64(3));
+
+    GameX game;
+    QVERIFY(db->loadGame(1, game));
+    game.moveToEnd();
+    game.addMove("Nf3");
+    QVERIFY(db->replace(1, game));
+    QVERIFY(db->appendGame(game));
+    QVERIFY(!db->isGameChanged(0));
+    QVERIFY(db->isGameChanged(1));
+    QVERIFY(!db->isGameChanged(2));
+    QVERIFY(db->isGameChanged(3));
+
+    Output output(Output::Pgn);
+    QVERIFY(db->save(output, false));
+    QVERIFY(!db->isModified());
+    QVERIFY(!db->isGameChanged(1));
+    QVERIFY(!db->isGameChanged(3));
+
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QByteArray text = file.readAll();
+    file.close();
+    QVERIFY(text.startsWith(first));
+    QVERIFY(!text.contains(second));
+    QVERIFY(text.contains(third + "\n\n[Event"));
+
+    // The offsets of the first save are used by the second one
+    db->remove(0);
+    QVERIFY(db->save(output, false));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    text = file.readAll();
+    file.close();
+    QVERIFY(!text.contains(first));
+    QVERIFY(text.contains(third));
+    delete db;
+
+    db = new MemoryDatabase();
+    QVERIFY(db->open(path, false));
+    QVERIFY(static_cast<Database*>(db)->parseFile()); // MemoryDatabase hides it
+    QCOMPARE(db->count(), quint64(3));
+    QVERIFY(db->loadGame(0, game));
+    QCOMPARE(game.tag("Event"), QString("Two"));
+    QCOMPARE(game.plyCount(), 3);
+    QVERIFY(db->loadGame(1, game));
+    QCOMPARE(game.tag("Event"), QString("Three"));
+    QVERIFY(db->loadGame(2, game));
+    QCOMPARE(game.plyCount(), 3);
+    delete db;
+}
+
+void PgnDatabaseTest::testSaveEditedTag()
+{
+    QTemporaryDir tmpDir;
+    const QString path = tmpDir.path() + "/tags.pgn";
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("[Event \"One\"]\n[Result \"*\"]\n\n1.e4 e5 *\n\n"
+               "[Event \"Two\"]\n[Result \"*\"]\n\n1.d4 d5 *\n\n");
+    file.close();
+
+    MemoryDatabase* db = new MemoryDatabase();
+    QVERIFY(db->open(path, false));
+    QVERIFY(static_cast<Database*>(db)->parseFile()); // MemoryDatabase hides it
+
+    // Edited in the game list, the game is not loaded
+    FilterX filter(db);
+    FilterModel model(&filter);
+    model.updateColumns();
+    const int eventColumn = 5;
+    QCOMPARE(model.headerData(eventColumn, Qt::Horizontal).toString(), QString("Event"));
+    QVERIFY(model.setData(model.index(1, eventColumn), "Renamed", Qt::EditRole));
+    QVERIFY(db->isModified());
+    QVERIFY(!db->isGameChanged(0));
+    QVERIFY(db->isGameChanged(1));
+
+    Output output(Output::Pgn);
+    QVERIFY(db->save(output, false));
+    delete db;
+
+    db = new MemoryDatabase();
+    QVERIFY(db->open(path, false));
+    QVERIFY(static_cast<Database*>(db)->parseFile()); // MemoryDatabase hides it
+    QCOMPARE(db->count(), quint64(2));
+    GameX game;
+    QVERIFY(db->loadGame(0, game));
+    QCOMPARE(game.tag("Event"), QString("One"));
+    QVERIFY(db->loadGame(1, game));
+    QCOMPARE(game.tag("Event"), QString("Renamed"));
+    QCOMPARE(game.plyCount(), 2);
+    delete db;
+}
+
+void PgnDatabaseTest::testParallelExport()
+{
+    QFile source(RESOURCE_PATH "game1.pgn");
+    QVERIFY(source.open(QIODevice::ReadOnly));
+    const QByteArray games = source.readAll();
+    source.close();
+    QTemporaryDir tmpDir;
+    const QString path = tmpDir.path() + "/export.pgn";
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    for (int i = 0; i < 300; ++i)
+    {
+        file.write(games + "\n");
+    }
+    file.close();
+
+    PgnDatabase* db = new PgnDatabase(false);
+    QVERIFY(db->open(path, false));
+    QVERIFY(db->parseFile());
+    QVector<GameId> ids;
+    for (GameId i = 0; i < db->count(); ++i)
+    {
+        ids.append(i);
+    }
+    QCOMPARE(ids.count(), 600);
+
+    // Enough games for worker threads, which must use the changed option as well
+    Output output(Output::Pgn);
+    QVERIFY(output.setOption("TextWidth", 20));
+    QBuffer parallel;
+    QVERIFY(parallel.open(QIODevice::WriteOnly));
+    output.exportGames(parallel, *db, ids, false);
+
+    // Small exports are formatted without workers
+    QBuffer serial;
+    QVERIFY(serial.open(QIODevice::WriteOnly));
+    for (int i = 0; i < ids.count(); i += 100)
+    {
+        output.exportGames(serial, *db, ids.mid(i, 100), false);
+    }
+    QCOMPARE(parallel.data(), serial.data());
+
+    Output defaults(Output::Pgn);
+    QBuffer unchanged;
+    QVERIFY(unchanged.open(QIODevice::WriteOnly));
+    defaults.exportGames(unchanged, *db, ids, false);
+    QVERIFY(unchanged.data() != parallel.data());
+    delete db;
+}
+
+namespace {
+
+/** Open the archive @p path and compare its games with the two games of game1.pgn */
+void checkArchive(const QString& path, int count, const GameX* expected)
+{
+    ArchiveDatabase* db = new ArchiveDatabase();
+    QVERIFY(db->open(path, false));
+    QVERIFY(db->parseFile());
+    QCOMPARE(db->count(), quint64(count));
+
+    // A game from the middle first, it is reached by seeking to an access point
+    GameX game;
+    QVERIFY(db->loadGame(count / 2 + 1, game));
+    QCOMPARE(game.plyCount(), expected[1].plyCount());
+
+    // Backwards, so that every game is found through an access point
+    for (GameId i = count; i-- > 0;)
+    {
+        QVERIFY(db->loadGame(i, game));
+        QCOMPARE(game.plyCount(), expected[i % 2].plyCount());
+        QCOMPARE(game.tag("White"), expected[i % 2].tag("White"));
+    }
+    delete db;
+}
+
+/** Append @p text as a gzip member of its own to @p file */
+void writeGzipMember(QFile& file, const QByteArray& text)
+{
+    QTemporaryDir tmpDir;
+    QuaGzipFile member(tmpDir.path() + "/member.gz");
+    QVERIFY(member.open(QIODevice::WriteOnly));
+    member.write(text);
+    member.close();
+    QFile compressed(member.getFileName());
+    QVERIFY(compressed.open(QIODevice::ReadOnly));
+    file.write(compressed.readAll());
+}
+
+} // namespace
+
+void PgnDatabaseTest::testArchiveDatabase()
+{
+    QFile source(RESOURCE_PATH "game1.pgn");
+    QVERIFY(source.open(QIODevice::ReadOnly));
+    const QByteArray games = source.readAll();
+    source.close();
+    QByteArray text;
+    for (int i = 0; i < 400; ++i)
+    {
+        text += games + "\n";
+    }
+
+    // The index files go to the temporary directory
+    QTemporaryDir tmpDir;
+    const QVariant dataPath = AppSettings->value("/General/DefaultDataPath");
+    const QVariant useIndexFile = AppSettings->value("/General/useIndexFile");
+    AppSettings->setValue("/General/DefaultDataPath", tmpDir.path());
+    AppSettings->setValue("/General/useIndexFile", true);
+    QVERIFY(QDir().mkpath(AppSettings->indexPath()));
+
+    // Large enough for several access points
+    const QString path = tmpDir.path() + "/games.zip";
+    QuaZip zip(path);
+    QVERIFY(zip.open(QuaZip::mdCreate));
+    QuaZipFile entry(&zip);
+    QVERIFY(entry.open(QIODevice::WriteOnly, QuaZipNewInfo("games.pgn")));
+    entry.write(text);
+    entry.close();
+    zip.close();
+
+    // Two gzip members, as written by concatenating gzip files
+    const QString gzipPath = tmpDir.path() + "/games.pgn.gz";
+    QFile gzip(gzipPath);
+    QVERIFY(gzip.open(QIODevice::WriteOnly));
+    writeGzipMember(gzip, text);
+    writeGzipMember(gzip, text);
+    gzip.close();
+
+    QVERIFY(ArchiveDatabase::canOpen(path));
+    QVERIFY(ArchiveDatabase::canOpen(gzipPath));
+    QVERIFY(!ArchiveDatabase::canOpen(RESOURCE_PATH "game1.pgn"));
+
+    PgnDatabase* plain = new PgnDatabase();
+    QVERIFY(plain->open(RESOURCE_PATH "game1.pgn", false));
+    QVERIFY(plain->parseFile());
+    GameX expected[2];
+    QVERIFY(plain->loadGame(0, expected[0]));
+    QVERIFY(plain->loadGame(1, expected[1]));
+    delete plain;
+
+    checkArchive(path, 800, expected);
+    checkArchive(gzipPath, 1600, expected);
+
+    // Opened again, the offsets and the access points come from the index files
+    const QString zipIndex = AppSettings->indexPath() + QDir::separator() + "games.zip.cxi";
+    const QString gzipIndex = AppSettings->indexPath() + QDir::separator() + "games.pgn.gz.cxi";
+    QVERIFY(QFile::exists(zipIndex));
+    QVERIFY(QFile::exists(gzipIndex));
+    QDateTime zipIndexTime = QFileInfo(zipIndex).lastModified();
+    QDateTime gzipIndexTime = QFileInfo(gzipIndex).lastModified();
+    checkArchive(path, 800, expected);
+    checkArchive(gzipPath, 1600, expected);
+    QCOMPARE(QFileInfo(zipIndex).lastModified(), zipIndexTime);
+    QCOMPARE(QFileInfo(gzipIndex).lastModified(), gzipIndexTime);
+
+    AppSettings->setValue("/General/DefaultDataPath", dataPath);
+    AppSettings->setValue("/General/useIndexFile", useIndexFile);
+}
+
+void PgnDatabaseTest::testAppendedGames()
+{
+    QTemporaryDir tmpDir;
+    const QString path = tmpDir.path() + "/append.pgn";
+    const QByteArray first = "[Event \"One\"]\n[Result \"*\"]\n\n1.e4 e5 *\n\n";
+    const QByteArray second = "[Event \"Two\"]\n[Result \"*\"]\n\n1.d4 d5";
+    const QByteArray appended = " 2.c4 *\n\n[Event \"Three\"]\n[Result \"*\"]\n\n1.c4 c5 *\n";
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(first + second);
+    file.close();
+
+    PgnDatabase* db = new PgnDatabase();
+    QVERIFY(db->open(path, false));
+    QVERIFY(db->parseFile());
+    QCOMPARE(db->count(), quint64(2));
+    delete db;
+
+    // The appended data continues the last game and adds another one
+    QVERIFY(file.open(QIODevice::Append));
+    file.write(appended);
+    QVERIFY(file.setFileTime(QDateTime::currentDateTime().addSecs(60), QFileDevice::FileModificationTime));
+    file.close();
+
+    db = new PgnDatabase();
+    QVERIFY(db->open(path, false));
+    QVERIFY(db->parseFile());
+    QCOMPARE(db->count(), quint64(3));
+    GameX game;
+    QVERIFY(db->loadGame(1, game));
+    QCOMPARE(game.tag("Event"), QString("Two"));
+    QCOMPARE(game.plyCount(), 3);
+    QVERIFY(db->loadGame(2, game));
+    QCOMPARE(game.tag("Event"), QString("Three"));
+    QCOMPARE(game.plyCount(), 2);
+    delete db;
+}
+
 // void PgnDatabaseTest::testExecuteSearch() {
 //     PgnDatabase* db = new PgnDatabase();
 //     db->open( QString( "./data/game1.pgn" ));
@@ -132,5 +486,3 @@ void PgnDatabaseTest::testCopyGameIntoNewDB()
 //     delete dbNew;
 //     delete db;
 // }
-
-
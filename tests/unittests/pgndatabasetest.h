@@ -36,6 +36,12 @@ private slots:
     void testCreateDatabase();
     void testLoad();
     void testCopyGameIntoNewDB();
+    void testTransformGames();
+    void testIncrementalSave();
+    void testSaveEditedTag();
+    void testParallelExport();
+    void testArchiveDatabase();
+    void testAppendedGames();
     //  void testExecuteSearch();
     //  void testSave();
 };
@@ -52,3 +52,45 @@ void PlayerDatabaseTest::testCreate()
     pdb.close();
     QVERIFY(pdb.removeDatabase(path));
 }
+
+void PlayerDatabaseTest::testMapped()
+{
+    QTemporaryDir tmpDir;
+    auto path = tmpDir.path() + "/playerdatabase_mapped";
+
+    PlayerDatabase pdb;
+    QVERIFY(pdb.open(RESOURCE_PATH "small/players"));
+    QVERIFY(pdb.saveMapped(path));
+
+    PlayerDatabase mapped;
+    QVERIFY(mapped.open(path));
+    QCOMPARE(mapped.count(), pdb.count());
+    QCOMPARE(mapped.playerNames(), pdb.playerNames());
+    QCOMPARE(mapped.findPlayers("T"), pdb.findPlayers("T"));
+    QVERIFY(mapped.exists("Thal, Olaf"));
+    QVERIFY(!mapped.exists("TRUSDFEADFA, WSDFASDF"));
+    QVERIFY(!mapped.add("TRUSDFEADFA, WSDFASDF"));
+
+    const PartialDate dates[] = { PartialDate(1965, 1, 1), PartialDate(1985, 8, 1), PartialDate(2005, 5, 1) };
+    foreach(QString name, pdb.playerNames())
+    {
+        for(const PartialDate& date : dates)
+        {
+            QCOMPARE(mapped.estimatedElo(name, date), pdb.estimatedElo(name, date));
+        }
+        pdb.setCurrent(name);
+        mapped.setCurrent(name);
+        QCOMPARE(mapped.country(), pdb.country());
+        QCOMPARE(mapped.title(), pdb.title());
+        QCOMPARE(mapped.highestElo(), pdb.highestElo());
+        QCOMPARE(mapped.estimatedElo(), pdb.estimatedElo());
+        for(const PartialDate& date : dates)
+        {
+            QCOMPARE(mapped.elo(date), pdb.elo(date));
+        }
+    }
+
+    mapped.close();
+    pdb.close();
+    QVERIFY(pdb.removeDatabase(path));
+}
@@ -31,6 +31,7 @@ class PlayerDatabaseTest: public QObject
 private slots:
     void testBasics();
     void testCreate();
+    void testMapped();
 };
 
 #endif
@@ -6,6 +6,9 @@
 #include "pgndatabase.h"
 #include "settings.h"
 #include "positionsearch.h"
+#include "materialsearch.h"
+#include "duplicatesearch.h"
+#include "filter.h"
 
 void PositionSearchTest::testSearch()
 {
@@ -41,3 +44,83 @@ void PositionSearchTest::testSearch()
     QCOMPARE(posSearch.matches(0), 0);
 }
 
+void PositionSearchTest::testMaterialSearch()
+{
+    if (!AppSettings)
+    {
+        AppSettings = new Settings;
+    }
+    PgnDatabase db { false };
+    QVERIFY(db.open(RESOURCE_PATH "t1.pgn", false));
+    QVERIFY(db.parseFile());
+    volatile bool breakFlag = false;
+
+    // 1. f3 e6 2. g4 Qh4# captures nothing
+    MaterialSearch full(&db);
+    QVERIFY(full.setMaterial("KQRRBBNNPPPPPPPP-KQRRBBNNPPPPPPPP"));
+    full.Prepare(breakFlag);
+    QCOMPARE(full.matches(0), 1);
+
+    MaterialSearch pawnDown(&db);
+    QVERIFY(pawnDown.setMaterial("KQRRBBNNPPPPPPP-KQRRBBNNPPPPPPPP"));
+    pawnDown.Prepare(breakFlag);
+    QCOMPARE(pawnDown.matches(0), 0);
+    QVERIFY(!pawnDown.setMaterial("KX-K"));
+
+    // white pawn on g4 after 2. g4, for the last two positions
+    MaterialSearch pattern(&db);
+    pattern.addPattern(WhitePawn, 1ULL << 30);
+    pattern.setMinPlies(2);
+    pattern.Prepare(breakFlag);
+    QCOMPARE(pattern.matches(0), 4);
+
+    // black queen on h4 only in the final position
+    MaterialSearch queen(&db);
+    queen.addPattern(BlackQueen, 1ULL << 31);
+    queen.setMinPlies(2);
+    queen.Prepare(breakFlag);
+    QCOMPARE(queen.matches(0), 0);
+
+    // games the filter does not ask for are not searched
+    FilterX filter(&db);
+    filter.setAll(0);
+    MaterialSearch filtered(&db);
+    QVERIFY(filtered.setMaterial("KQRRBBNNPPPPPPPP-KQRRBBNNPPPPPPPP"));
+    filtered.setInputFilter(&filter);
+    filtered.setInputOperator(FilterOperator::And);
+    filtered.Prepare(breakFlag);
+    QCOMPARE(filtered.matches(0), 0);
+    filtered.setInputOperator(FilterOperator::Or);
+    filtered.Prepare(breakFlag);
+    QCOMPARE(filtered.matches(0), 1);
+}
+
+void PositionSearchTest::testSimilarSearch()
+{
+    QCOMPARE(DuplicateSearch::normalizedName("Ljubojević,  Ljubomir."), QString("ljubojevic ljubomir"));
+    QCOMPARE(DuplicateSearch::nameSimilarity("Carlsen, Magnus", "Magnus Carlsen"), 1.0);
+    QCOMPARE(DuplicateSearch::nameSimilarity("Carlsen, Magnus", "Carlsen, M."), 0.9);
+    QVERIFY(DuplicateSearch::nameSimilarity("Kasparov, Garry", "Kasparov, Gary") > 0.9);
+    QVERIFY(DuplicateSearch::nameSimilarity("Carlsen, Magnus", "Kramnik, Vladimir") < 0.3);
+
+    if (!AppSettings)
+    {
+        AppSettings = new Settings;
+    }
+    PgnDatabase db { false };
+    QVERIFY(db.open(RESOURCE_PATH "similar.pgn", false));
+    QVERIFY(db.parseFile());
+    volatile bool breakFlag = false;
+
+    // the truncated copy with abbreviated names is found, the longer game is kept
+    DuplicateSearch search(&db, DuplicateSearch::DS_Similar);
+    search.Prepare(breakFlag);
+    QCOMPARE(search.matches(0), 0);
+    QCOMPARE(search.matches(1), 1);
+    // other moves, another player
+    QCOMPARE(search.matches(2), 0);
+    QCOMPARE(search.matches(3), 0);
+    // a copy truncated before the opening moves of the blocks is found as well
+    QCOMPARE(search.matches(4), 0);
+    QCOMPARE(search.matches(5), 1);
+}
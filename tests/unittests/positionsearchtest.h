@@ -29,6 +29,8 @@ class PositionSearchTest : public QObject
 
 private slots:
     void testSearch();
+    void testMaterialSearch();
+    void testSimilarSearch();
 };
 
 #endif
@@ -0,0 +1,211 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "searchtest.h"
+
+#include <QTemporaryDir>
+
+#include "resourcepath.h"
+
+#include "commentsearch.h"
+#include "datesearch.h"
+#include "filter.h"
+#include "gamex.h"
+#include "memorydatabase.h"
+#include "pgndatabase.h"
+#include "settings.h"
+
+namespace {
+
+int findComment(Database* db, const QString& query, GameId game)
+{
+    volatile bool breakFlag = false;
+    CommentSearch search(db, query);
+    search.Prepare(breakFlag);
+    return search.matches(game);
+}
+
+void writeFile(const QString& path, const QByteArray& text)
+{
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(text);
+}
+
+/** Changes a setting for its lifetime */
+class SettingGuard
+{
+public:
+    SettingGuard(const QString& key, const QVariant& value) : m_key(key), m_value(AppSettings->value(key))
+    {
+        AppSettings->setValue(key, value);
+    }
+    ~SettingGuard()
+    {
+        if (m_value.isValid())
+        {
+            AppSettings->setValue(m_key, m_value);
+        }
+        else
+        {
+            AppSettings->remove(m_key);
+        }
+    }
+
+private:
+    QString m_key;
+    QVariant m_value;
+};
+
+} // namespace
+
+void SearchTest::initTestCase()
+{
+    // required by PgnDatabase::open() to check if indexing is enabled
+    if (!AppSettings)
+    {
+        AppSettings = new Settings;
+    }
+}
+
+void SearchTest::testDateSearch_data()
+{
+    QTest::addColumn<QString>("minDate");
+    QTest::addColumn<QString>("maxDate");
+    QTest::addColumn<QString>("expected");
+
+    // games: 2001.??.??, 2001.05.12, no date, 2003.01.01, ????.??.??
+    QTest::newRow("full dates") << "2001.01.01" << "2002.12.31" << "01000";
+    QTest::newRow("partial bounds") << "2001.??.??" << "2001.05.12" << "11000";
+    QTest::newRow("missing dates") << "????.??.??" << "2001.??.??" << "10101";
+    QTest::newRow("all") << "????.??.??" << "2003.01.01" << "11111";
+    QTest::newRow("none") << "2004.01.01" << "2005.01.01" << "00000";
+    QTest::newRow("single day") << "2001.05.12" << "2001.05.12" << "01000";
+}
+
+void SearchTest::testDateSearch()
+{
+    QFETCH(QString, minDate);
+    QFETCH(QString, maxDate);
+    QFETCH(QString, expected);
+
+    PgnDatabase db { false };
+    QVERIFY(db.open(RESOURCE_PATH "dates.pgn", false));
+    QVERIFY(db.parseFile());
+    QCOMPARE(int(db.count()), expected.length());
+
+    volatile bool breakFlag = false;
+    DateSearch search(&db, PartialDate(minDate), PartialDate(maxDate));
+    search.Prepare(breakFlag);
+    for (int i = 0; i < expected.length(); ++i)
+    {
+        // The result of comparing the Date tag of each game, as the search did before the value index
+        GameX game;
+        db.loadGameHeaders(i, game);
+        PartialDate date(game.tag("Date"));
+        int loaded = (date >= PartialDate(minDate) && date <= PartialDate(maxDate));
+
+        QCOMPARE(search.matches(i), loaded);
+        QCOMPARE(search.matches(i), expected.at(i) == '1' ? 1 : 0);
+    }
+
+    // As run by the range search of the game list
+    FilterX filter(&db);
+    filter.executeSearch(new DateSearch(&db, PartialDate(minDate), PartialDate(maxDate)));
+    filter.wait();
+    for (int i = 0; i < expected.length(); ++i)
+    {
+        QCOMPARE(filter.contains(i), expected.at(i) == '1');
+    }
+}
+
+void SearchTest::testCommentSearch()
+{
+    QTemporaryDir tmpDir;
+    const QString path = tmpDir.path() + "/comments.pgn";
+    const QByteArray games =
+        "[Event \"One\"]\n[Result \"*\"]\n\n1. e4 {a fine opening move} e5 *\n\n"
+        "[Event \"Two\"]\n[Result \"*\"]\n\n1. d4 {the queen pawn} d5 {fine reply} *\n\n"
+        "[Event \"Three\"]\n[Result \"*\"]\n\n1. c4 c5 *\n\n";
+    writeFile(path, games);
+
+    // The comment index is kept next to the game index, in the temporary directory
+    SettingGuard dataPath("/General/DefaultDataPath", tmpDir.path());
+    SettingGuard useIndexFile("/General/useIndexFile", true);
+    QVERIFY(QDir().mkpath(AppSettings->indexPath()));
+    const QString commentIndex = AppSettings->indexPath() + QDir::separator() + "comments.cci";
+
+    {
+        PgnDatabase db { false };
+        QVERIFY(db.open(path, false));
+        QVERIFY(db.parseFile());
+        // moveId + 1 of the first matching comment
+        QCOMPARE(findComment(&db, "fine", 0), 2);
+        QCOMPARE(findComment(&db, "fine", 1), 3);
+        QCOMPARE(findComment(&db, "fine", 2), 0);
+        QCOMPARE(findComment(&db, "\"queen pawn\"", 1), 2);
+        QCOMPARE(findComment(&db, "\"pawn queen\"", 1), 0);
+        QCOMPARE(findComment(&db, "que*", 1), 2);
+        QVERIFY(QFile::exists(commentIndex));
+    }
+
+    // A file of the same size and time is answered from the stored index
+    QDateTime lastModified = QFileInfo(path).lastModified();
+    QByteArray changed = games;
+    changed.replace("fine opening", "good opening");
+    writeFile(path, changed);
+    {
+        QFile file(path);
+        QVERIFY(file.open(QIODevice::ReadWrite));
+        QVERIFY(file.setFileTime(lastModified, QFileDevice::FileModificationTime));
+    }
+    {
+        PgnDatabase db { false };
+        QVERIFY(db.open(path, false));
+        QVERIFY(db.parseFile());
+        QCOMPARE(findComment(&db, "fine", 0), 2);
+        QCOMPARE(findComment(&db, "good", 0), 0);
+    }
+
+    // A changed file is indexed again
+    writeFile(path, changed + "[Event \"Four\"]\n[Result \"*\"]\n\n1. g3 {good} g6 *\n\n");
+    {
+        PgnDatabase db { false };
+        QVERIFY(db.open(path, false));
+        QVERIFY(db.parseFile());
+        QCOMPARE(findComment(&db, "good", 0), 2);
+        QCOMPARE(findComment(&db, "good", 3), 2);
+        QCOMPARE(findComment(&db, "fine", 0), 0);
+    }
+
+    // Replacing a game drops the index of a memory database
+    {
+        MemoryDatabase db;
+        QVERIFY(db.open(path, false));
+        QVERIFY(static_cast<Database*>(&db)->parseFile()); // MemoryDatabase hides it
+        QCOMPARE(findComment(&db, "good", 0), 2);
+
+        GameX game;
+        QVERIFY(db.loadGame(0, game));
+        game.dbSetAnnotation("plain", 1);
+        QVERIFY(db.replace(0, game));
+        QCOMPARE(findComment(&db, "good", 0), 0);
+        QCOMPARE(findComment(&db, "plain", 0), 2);
+        QCOMPARE(findComment(&db, "good", 3), 2);
+    }
+
+    // The comments of an undeleted game are found again
+    {
+        MemoryDatabase db;
+        QVERIFY(db.open(path, false));
+        QVERIFY(static_cast<Database*>(&db)->parseFile()); // MemoryDatabase hides it
+        QVERIFY(db.remove(3));
+        QCOMPARE(findComment(&db, "good", 3), 0);
+        QVERIFY(db.undelete(3));
+        QCOMPARE(findComment(&db, "good", 3), 2);
+    }
+}
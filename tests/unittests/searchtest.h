@@ -0,0 +1,27 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+/**
+Unit tests for the searches on the tags and comments of a database
+*/
+
+#ifndef SEARCHTEST_H
+#define SEARCHTEST_H
+
+#include <QtTest/QtTest>
+
+class SearchTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void testDateSearch();
+    void testDateSearch_data();
+    void testCommentSearch();
+};
+
+#endif
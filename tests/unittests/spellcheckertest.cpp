@@ -21,7 +21,10 @@
 #include "spellcheckertest.h"
 
 #include "resourcepath.h"
+#include "gamex.h"
+#include "index.h"
 #include "spellchecker.h"
+#include "tags.h"
 
 //void SpellCheckerTest::testNoRule()
 //{
@@ -246,3 +249,72 @@ void SpellCheckerTest::testImport()
         QCOMPARE(checker.correct(mistake, Spellchecker::Round), correct);
     }
 }
+
+void SpellCheckerTest::testSubstitutions()
+{
+    Spellchecker checker;
+    checker.addRule("Dr.", "", Spellchecker::Prefix, Spellchecker::Player);
+    checker.addRule("Dr. ", "", Spellchecker::Prefix, Spellchecker::Player);
+    checker.addRule("Int.", "International", Spellchecker::Infix, Spellchecker::Event);
+    checker.addRule("ional op", "ional Open", Spellchecker::Infix, Spellchecker::Event);
+    checker.addRule("ch.", "Championship", Spellchecker::Infix, Spellchecker::Event);
+    checker.addRule(" jr", " Jr", Spellchecker::Suffix, Spellchecker::Player);
+    checker.addRule("r", "R", Spellchecker::Suffix, Spellchecker::Player);
+
+    // first prefix and suffix in rule order only
+    QCOMPARE(checker.correct("Dr. Lasker, Emanuel", Spellchecker::Player), QString(" Lasker, Emanuel"));
+    QCOMPARE(checker.correct("Marshall, Frank jr", Spellchecker::Player), QString("Marshall, Frank Jr"));
+    QCOMPARE(checker.correct("Spielmann, Rudolf", Spellchecker::Player), QString("Spielmann, Rudolf"));
+
+    // infixes are applied in rule order, each on the result of the previous ones
+    QCOMPARE(checker.correct("Int. op", Spellchecker::Event), QString("International Open"));
+    QCOMPARE(checker.correct("Int. ch.", Spellchecker::Event), QString("International Championship"));
+
+    // rules added after a correction are taken into account
+    checker.addRule("Open", "Op", Spellchecker::Infix, Spellchecker::Event);
+    QCOMPARE(checker.correct("Int. Open", Spellchecker::Event), QString("International Op"));
+}
+
+void SpellCheckerTest::testCorrectIndex()
+{
+    Spellchecker checker;
+    checker.addRule("Karpow, Anatoly", "Karpov, Anatoly", Spellchecker::Literal, Spellchecker::Player);
+    checker.addRule("Moskau", "Moscow RUS", Spellchecker::Literal, Spellchecker::Site);
+
+    IndexX index;
+    index.setTag(TagNameWhite, "Karpow, Anatoly", 0);
+    index.setTag(TagNameBlack, "Kasparov, Garry", 0);
+    index.setTag(TagNameEvent, "Moskau", 0);
+    index.setTag(TagNameSite, "Moskau", 0);
+    index.setTag("Annotator", "Karpow, Anatoly", 0);
+    index.setTag(TagNameWhite, "Kasparov, Garry", 1);
+    index.setTag(TagNameBlack, "Karpow, Anatoly", 1);
+    index.setTag(TagNameEvent, "Match", 1);
+    index.setTag(TagNameSite, "Linares", 1);
+    index.setTag("Annotator", "Karpow, Anatoly", 1);
+
+    // One player name for both colors and one site
+    QCOMPARE(checker.correct(index), 3);
+    QCOMPARE(index.tagValue(TagNameWhite, 0), QString("Karpov, Anatoly"));
+    QCOMPARE(index.tagValue(TagNameBlack, 1), QString("Karpov, Anatoly"));
+    QCOMPARE(index.tagValue(TagNameSite, 0), QString("Moscow RUS"));
+
+    // Other values and columns are untouched, even if they hold the same value
+    QCOMPARE(index.tagValue(TagNameBlack, 0), QString("Kasparov, Garry"));
+    QCOMPARE(index.tagValue(TagNameWhite, 1), QString("Kasparov, Garry"));
+    QCOMPARE(index.tagValue(TagNameEvent, 0), QString("Moskau"));
+    QCOMPARE(index.tagValue(TagNameEvent, 1), QString("Match"));
+    QCOMPARE(index.tagValue(TagNameSite, 1), QString("Linares"));
+    QCOMPARE(index.tagValue("Annotator", 0), QString("Karpow, Anatoly"));
+    QCOMPARE(index.tagValue("Annotator", 1), QString("Karpow, Anatoly"));
+
+    // The same tags of a single game
+    GameX game;
+    game.setTag(TagNameWhite, "Karpow, Anatoly");
+    game.setTag(TagNameEvent, "Moskau");
+    game.setTag(TagNameSite, "Moskau");
+    QCOMPARE(checker.correct(game), 2);
+    QCOMPARE(game.tag(TagNameWhite), QString("Karpov, Anatoly"));
+    QCOMPARE(game.tag(TagNameEvent), QString("Moskau"));
+    QCOMPARE(game.tag(TagNameSite), QString("Moscow RUS"));
+}
@@ -33,6 +33,8 @@ private slots:
     void testBasics();
     void testBasics_data();
     void testImport();
+    void testSubstitutions();
+    void testCorrectIndex();
 };
 
 
@@ -0,0 +1,74 @@
+
+#include "doctest.h"
+
+#include "commentindex.h"
+#include "gamex.h"
+
+namespace {
+
+GameX annotatedGame(const QString& gameComment, const QString& e4Comment, const QString& e5Comment)
+{
+    GameX game;
+    game.dbSetAnnotation(gameComment, 0);
+    MoveId e4 = game.addMove("e4");
+    game.dbSetAnnotation(e4Comment, e4);
+    MoveId e5 = game.addMove("e5");
+    game.dbSetAnnotation(e5Comment, e5);
+    return game;
+}
+
+} // namespace
+
+TEST_CASE("testing CommentIndex words")
+{
+    QStringList words = CommentIndex::words("The Queen's Gambit [%clk 0:10:00] is, after all, Declined.");
+    QStringList expected = { "the", "queen", "s", "gambit", "is", "after", "all", "declined" };
+    CHECK_EQ(words, expected);
+}
+
+TEST_CASE("testing CommentIndex queries")
+{
+    CommentIndex index;
+    index.addGame(annotatedGame("Training game", "A sharp opening", "Black equalizes"));
+    index.addGame(GameX());
+    index.addGame(annotatedGame("", "Sharp play [%eval 0.30]", "The opening is sharp"));
+    REQUIRE_EQ(index.gameCount(), GameId(3));
+
+    // words, case insensitive, the first matching comment is reported
+    QVector<int> sharp = index.find("SHARP");
+    REQUIRE_EQ(sharp.count(), 3);
+    CHECK_EQ(sharp[0], 2);
+    CHECK_EQ(sharp[1], 0);
+    CHECK_EQ(sharp[2], 2);
+
+    // all words must occur in a game
+    QVector<int> both = index.find("sharp training");
+    CHECK_GT(both[0], 0);
+    CHECK_EQ(both[2], 0);
+
+    // phrases must follow each other in one comment
+    QVector<int> phrase = index.find("\"sharp opening\"");
+    CHECK_GT(phrase[0], 0);
+    CHECK_EQ(phrase[2], 0);
+
+    // prefixes
+    QVector<int> prefix = index.find("equal*");
+    CHECK_GT(prefix[0], 0);
+    CHECK_EQ(prefix[2], 0);
+    CHECK_EQ(index.find("eval")[2], 0);
+
+    // the index survives being stored
+    QByteArray data;
+    {
+        QDataStream out(&data, QIODevice::WriteOnly);
+        REQUIRE(index.write(out));
+    }
+    CommentIndex restored;
+    QDataStream in(data);
+    REQUIRE(restored.read(in));
+    CHECK_EQ(restored.find("\"sharp opening\""), phrase);
+
+    // and can be extended
+    restored.addGame(annotatedGame("", "", "Equality"));
+    CHECK_GT(restored.find("equal*")[3], 0);
+}
@@ -8,6 +8,8 @@
 
 #include "settings.h"
 
+#include <QTemporaryFile>
+
 TEST_CASE("testing Index class")
 {
     IndexX index;
@@ -97,3 +99,189 @@ TEST_CASE("testing Index read from PGN database")
 
     AppSettings = nullptr;
 }
+
+TEST_CASE("testing Index sort ranks")
+{
+    IndexX index;
+
+    index.setTag("White", "Tal, Mikhail", 0);
+    index.setTag("White", "Alekhine, Alexander A", 1);
+    index.setTag("White", "?", 2);
+    index.setTag("White", "Tal, Mikhail", 3);
+    index.setTag("WhiteElo", "2600", 0);
+    index.setTag("WhiteElo", "900", 1);
+    index.setTag("WhiteElo", "?", 2);
+    index.setTag("WhiteElo", "2600", 3);
+
+    QVector<quint32> names = index.sortRanks(TagNameWhite, false);
+    REQUIRE_EQ(names.count(), 4);
+    CHECK_LT(names[2], names[1]);
+    CHECK_LT(names[1], names[0]);
+    CHECK_EQ(names[0], names[3]);
+
+    QVector<quint32> elos = index.sortRanks(TagNameWhiteElo, true);
+    REQUIRE_EQ(elos.count(), 4);
+    CHECK_LT(elos[2], elos[1]);
+    CHECK_LT(elos[1], elos[0]);
+    CHECK_EQ(elos[0], elos[3]);
+
+    // a known value is updated in place, a new value forces a rebuild
+    index.setTag("White", "Alekhine, Alexander A", 3);
+    index.setTag("White", "Botvinnik, Mikhail", 4);
+    names = index.sortRanks(TagNameWhite, false);
+    REQUIRE_EQ(names.count(), 5);
+    CHECK_EQ(names[1], names[3]);
+    CHECK_LT(names[3], names[4]);
+    CHECK_LT(names[4], names[0]);
+}
+
+TEST_CASE("testing Index games by value")
+{
+    IndexX index;
+
+    index.setTag("White", "Tal, Mikhail", 0);
+    index.setTag("White", "Alekhine, Alexander A", 1);
+    index.setTag("White", "Tal, Mikhail", 2);
+    index.setTag("Black", "Tal, Mikhail", 1);
+
+    ValueIndex tal = index.getValueIndex("Tal, Mikhail");
+    CHECK_EQ(index.gamesWithValue(TagNameWhite, tal), QVector<GameId>({ 0, 2 }));
+    CHECK_EQ(index.gamesWithValue(TagNameBlack, tal), QVector<GameId>({ 1 }));
+    CHECK(index.gamesWithValue(TagNameEvent, tal).isEmpty());
+    CHECK(index.gamesWithValue(TagNameWhite, index.getValueIndex("Unknown player")).isEmpty());
+
+    // the lists follow appended, replaced and removed values
+    index.setTag("White", "Tal, Mikhail", 3);
+    index.setTag("White", "Tal, Mikhail", 1);
+    index.setTag("White", "Alekhine, Alexander A", 0);
+    index.removeTag("Black", 1);
+    CHECK_EQ(index.gamesWithValue(TagNameWhite, tal), QVector<GameId>({ 1, 2, 3 }));
+    CHECK_EQ(index.gamesWithValue(TagNameWhite, index.getValueIndex("Alekhine, Alexander A")), QVector<GameId>({ 0 }));
+    CHECK(index.gamesWithValue(TagNameBlack, tal).isEmpty());
+}
+
+TEST_CASE("testing Index game signatures")
+{
+    GameX game;
+    QList<BoardX> positions;
+    positions << game.board();
+    for (auto san : { "e4", "e5", "Nf3", "Nc6", "Bb5", "a6", "Bxc6", "dxc6", "O-O", "f6" })
+    {
+        REQUIRE_NE(game.addMove(san), NO_MOVE);
+        positions << game.board();
+    }
+
+    IndexX index;
+    index.add();
+    CHECK(!index.hasSignature(0));
+    index.setSignature(0, GameSignature(game));
+    CHECK(index.hasSignature(0));
+
+    // every position of the main line passes
+    for (const auto& position : positions)
+    {
+        CHECK(index.canContainPosition(0, position));
+    }
+
+    // the pawns left their squares in a different order
+    BoardX board;
+    board.setStandardPosition();
+    for (auto san : { "d4", "d5" })
+    {
+        board.doMove(board.parseMove(san));
+    }
+    CHECK(!index.canContainPosition(0, board));
+
+    // more material was captured than in the final position
+    board.fromFen("rnbqkbnr/pppp1ppp/8/4p3/4P3/8/PPPP1PPP/RNBQKB1R w KQkq - 0 3");
+    CHECK(!index.canContainPosition(0, board));
+
+    // games without a signature are never ruled out
+    CHECK(index.canContainPosition(1, board));
+}
+
+TEST_CASE("testing Index used in place from a mapped file")
+{
+    IndexX written;
+    written.setTag("White", "Tal, Mikhail", 0);
+    written.setTag("Black", "Botvinnik, Mikhail", 0);
+    written.setTag("White", "Botvinnik, Mikhail", 1);
+    written.setTag("Black", "Tal, Mikhail", 1);
+    written.setTag("Annotator", "Tal, Mikhail", 1);
+
+    QTemporaryFile file;
+    REQUIRE(file.open());
+    {
+        QDataStream out(&file);
+        REQUIRE(written.write(out));
+    }
+    file.flush();
+
+    QSharedPointer<const FileMapping> mapping = FileMapping::map(file.fileName());
+    REQUIRE(mapping);
+    file.seek(0);
+    QDataStream in(&file);
+    IndexX index;
+    volatile bool breakFlag = false;
+    REQUIRE(index.read(in, mapping, &breakFlag, VERSION_INDEX_CURRENT));
+
+    CHECK_EQ(index.tagValue(TagNameWhite, 0), QString("Tal, Mikhail"));
+    CHECK_EQ(index.tagValue(TagNameBlack, 1), QString("Tal, Mikhail"));
+    CHECK_EQ(index.tagValue(TagNameWhite, 1), QString("Botvinnik, Mikhail"));
+    CHECK_EQ(index.tagValue("Annotator", 0), QString());
+    CHECK_EQ(index.getValueIndex("Tal, Mikhail"), index.valueIndexFromTag(TagNameWhite, 0));
+    CHECK_EQ(index.getValueIndex("Spassky, Boris"), ValueNoIndex);
+
+    // changes go to memory, the mapped file stays as written
+    index.setTag("White", "Spassky, Boris", 0);
+    CHECK_EQ(index.tagValue(TagNameWhite, 0), QString("Spassky, Boris"));
+    CHECK_EQ(index.tagValue(TagNameBlack, 0), QString("Botvinnik, Mikhail"));
+}
+
+TEST_CASE("testing Index tag predicates")
+{
+    IndexX index;
+    index.setTag("White", "Tal, Mikhail", 0);
+    index.setTag("White", "Alekhine, Alexander A", 1);
+    index.setTag("White", "Tal, Mikhail", 2);
+    index.setTag("WhiteElo", "2600", 0);
+    index.setTag("WhiteElo", "2400", 2);
+    index.setTag("White", "Botvinnik, Mikhail", 3);
+
+    QBitArray tal = index.listPartialValue("White", "tal");
+    REQUIRE_EQ(tal.count(), 4);
+    CHECK(tal.at(0));
+    CHECK(!tal.at(1));
+    CHECK(tal.at(2));
+    CHECK(!tal.at(3));
+
+    QBitArray set = index.listInSet("White", QSet<QString>() << "alekhine" << "botvinnik");
+    CHECK(!set.at(0));
+    CHECK(set.at(1));
+    CHECK(!set.at(2));
+    CHECK(set.at(3));
+
+    // games without the tag compare like an empty value
+    QBitArray elo = index.listInRange("WhiteElo", 0, 2500);
+    CHECK(!elo.at(0));
+    CHECK(elo.at(1));
+    CHECK(elo.at(2));
+    CHECK(elo.at(3));
+
+    QBitArray names = index.listInRange("White", QString("B"), QString("U"));
+    CHECK(names.at(0));
+    CHECK(!names.at(1));
+    CHECK(names.at(3));
+
+    CHECK_EQ(index.listPartialValue("Annotator", "x").count(true), 0);
+
+    // each distinct value is tested once
+    int calls = 0;
+    QBitArray mikhail = index.listMatching("White", [&calls](const QString& value)
+    {
+        ++calls;
+        return value.endsWith("Mikhail");
+    });
+    CHECK_EQ(mikhail.count(true), 3);
+    CHECK_EQ(calls, 3);
+}
@@ -32,7 +32,6 @@ SOURCES += compileeco.cpp \
     ../src/database/openingtree.cpp \
     ../src/database/nag.cpp \
     ../src/database/memorydatabase.cpp \
-    ../src/database/indexitem.cpp \
     ../src/database/index.cpp \
     ../src/database/historylist.cpp \
     ../src/database/game.cpp \
@@ -46,6 +45,7 @@ SOURCES += compileeco.cpp \
     ../src/database/databaseconversion.cpp \
     ../src/database/database.cpp \
     ../src/database/common.cpp \
+    ../src/database/commentindex.cpp \
     ../src/database/board.cpp \
     ../src/database/bitboard.cpp \
     ../src/database/analysis.cpp \
@@ -77,6 +77,7 @@ HEADERS += ../src/database/board.h \
         ../src/database/search.h \
         ../src/database/query.h \
         ../src/database/database.h \
+        ../src/database/commentindex.h \
         ../src/database/pgndatabase.h \
         ../src/database/memorydatabase.h \
         ../src/database/filter.h \
@@ -89,6 +90,7 @@ HEADERS += ../src/database/board.h \
         ../src/database/outputoptions.h \
         ../src/database/databaseinfo.h \
         ../src/database/indexitem.h \
+        ../src/database/mappedarray.h \
         ../src/database/index.h \
         ../src/database/filtermodel.h \
         ../src/database/tablebase.h \